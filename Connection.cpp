@@ -22,8 +22,11 @@ typedef int ssize_t;
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <netinet/ip.h>
+#include <netinet/tcp.h>
 #include <unistd.h>
 #include <netdb.h>
+#include <fcntl.h>
+#include <poll.h>
 
 #define closesocket close
 
@@ -47,11 +50,120 @@ typedef int ssize_t;
 
 void Connection::close() {
 	if (socket != InvalidSocket) {
-		::closesocket(socket);
+		if (owns_socket) ::closesocket(socket);
 		socket = InvalidSocket;
 	}
 }
 
+void Connection::mark_droppable(size_t begin) {
+	assert(begin <= send_buffer.size());
+	assert(droppable.empty() || droppable.back().second <= begin);
+	if (begin == send_buffer.size()) return; //empty frame, nothing to drop later
+	droppable.emplace_back(begin, send_buffer.size());
+}
+
+size_t Connection::drop_stale(size_t keep) {
+	if (droppable.size() <= keep) return 0;
+	size_t drop_count = droppable.size() - keep;
+
+	//slide everything that isn't a dropped frame toward the front of send_buffer:
+	size_t write = droppable[0].first;
+	size_t read = droppable[0].first;
+	for (size_t i = 0; i < drop_count; ++i) {
+		auto const &[begin, end] = droppable[i];
+		std::copy(send_buffer.begin() + read, send_buffer.begin() + begin, send_buffer.begin() + write);
+		write += begin - read;
+		read = end;
+	}
+	std::copy(send_buffer.begin() + read, send_buffer.end(), send_buffer.begin() + write);
+	size_t dropped = read - write;
+	send_buffer.resize(send_buffer.size() - dropped);
+
+	//kept frames all come after the dropped ones, so they shift uniformly:
+	droppable.erase(droppable.begin(), droppable.begin() + drop_count);
+	for (auto &range : droppable) {
+		range.first -= dropped;
+		range.second -= dropped;
+	}
+
+	stats.dropped_frames += drop_count;
+	stats.dropped_bytes += dropped;
+	return dropped;
+}
+
+//remove the first 'count' (already transmitted) bytes from the send buffer:
+static void consume_sent(Connection &c, size_t count) {
+	c.send_buffer.erase(c.send_buffer.begin(), c.send_buffer.begin() + count);
+	c.stats.sent_bytes += count;
+
+	//frames that have started transmitting can no longer be dropped:
+	size_t started = 0;
+	while (started < c.droppable.size() && c.droppable[started].first < count) ++started;
+	c.droppable.erase(c.droppable.begin(), c.droppable.begin() + started);
+	for (auto &range : c.droppable) {
+		range.first -= count;
+		range.second -= count;
+	}
+}
+
+//---------------------------------
+//Socket option helpers:
+
+static bool set_socket_option(Socket s, int level, int name, int value) {
+	#ifdef _WIN32
+	return 0 == setsockopt(s, level, name, reinterpret_cast< const char * >(&value), sizeof(value));
+	#else
+	return 0 == setsockopt(s, level, name, &value, sizeof(value));
+	#endif
+}
+
+//options that matter for sockets carrying data (connected or accepted):
+static void apply_connection_options(char const *where, Socket s, SocketOptions const &options) {
+	if (options.no_delay && !set_socket_option(s, IPPROTO_TCP, TCP_NODELAY, 1)) {
+		std::cerr << "[" << where << "] note: couldn't set TCP_NODELAY (" << strerror(errno) << ")" << std::endl;
+	}
+	if (options.send_buffer_bytes > 0 && !set_socket_option(s, SOL_SOCKET, SO_SNDBUF, options.send_buffer_bytes)) {
+		std::cerr << "[" << where << "] note: couldn't set SO_SNDBUF (" << strerror(errno) << ")" << std::endl;
+	}
+	if (options.recv_buffer_bytes > 0 && !set_socket_option(s, SOL_SOCKET, SO_RCVBUF, options.recv_buffer_bytes)) {
+		std::cerr << "[" << where << "] note: couldn't set SO_RCVBUF (" << strerror(errno) << ")" << std::endl;
+	}
+	if (options.busy_poll_us > 0) {
+		#ifdef SO_BUSY_POLL
+		if (!set_socket_option(s, SOL_SOCKET, SO_BUSY_POLL, options.busy_poll_us)) {
+			std::cerr << "[" << where << "] note: couldn't set SO_BUSY_POLL (" << strerror(errno) << ")" << std::endl;
+		}
+		#else
+		std::cerr << "[" << where << "] note: SO_BUSY_POLL isn't supported on this platform." << std::endl;
+		#endif
+	}
+}
+
+//---------------------------------
+//poll() wrapper (select() can't watch sockets numbered past FD_SETSIZE, which a busy server will have):
+
+#ifdef _WIN32
+typedef WSAPOLLFD PollFD;
+static int poll_sockets(PollFD *fds, size_t count, int timeout_ms) {
+	return WSAPoll(fds, ULONG(count), timeout_ms);
+}
+#else
+typedef struct pollfd PollFD;
+static int poll_sockets(PollFD *fds, size_t count, int timeout_ms) {
+	return ::poll(fds, nfds_t(count), timeout_ms);
+}
+#endif
+
+static bool set_nonblocking(Socket s) {
+	#ifdef _WIN32
+	unsigned long one = 1;
+	return 0 == ioctlsocket(s, FIONBIO, &one);
+	#else
+	int flags = fcntl(s, F_GETFL, 0);
+	return flags >= 0 && 0 == fcntl(s, F_SETFL, flags | O_NONBLOCK);
+	#endif
+}
+
 //---------------------------------
 //Polling helper used by both server and client:
 void poll_connections(
@@ -59,63 +171,65 @@ void poll_connections(
 	std::list< Connection > &connections,
 	std::function< void(Connection *, Connection::Event event) > const &on_event,
 	double timeout,
-	Socket listen_socket = InvalidSocket) {
-
-	fd_set read_fds, write_fds;
-	FD_ZERO(&read_fds);
-	FD_ZERO(&write_fds);
+	Socket listen_socket = InvalidSocket,
+	SocketOptions const *accept_options = nullptr) {
 
-	int max = 0;
+	//one entry per socket to watch, with 'watched[i]' the connection for 'fds[i]':
+	// (listen_socket, if any, has entry 0 and a null connection)
+	static thread_local std::vector< PollFD > fds;
+	static thread_local std::vector< Connection * > watched;
+	fds.clear();
+	watched.clear();
 
-	//add listen_socket to fd_set if needed:
 	if (listen_socket != InvalidSocket) {
-		max = std::max(max, int(listen_socket));
-		FD_SET(listen_socket, &read_fds);
+		fds.emplace_back();
+		fds.back().fd = listen_socket;
+		fds.back().events = POLLIN;
+		watched.emplace_back(nullptr);
 	}
 
-	//add each connection's socket to read (and possibly write) sets:
-	for (auto c : connections) {
-		if (c.socket != InvalidSocket) {
-			max = std::max(max, int(c.socket));
-			FD_SET(c.socket, &read_fds);
-			if (!c.send_buffer.empty()) {
-				FD_SET(c.socket, &write_fds);
-			}
-		}
+	for (auto &c : connections) {
+		if (c.socket == InvalidSocket) continue;
+		fds.emplace_back();
+		fds.back().fd = c.socket;
+		fds.back().events = POLLIN;
+		if (!c.send_buffer.empty()) fds.back().events |= POLLOUT;
+		watched.emplace_back(&c);
 	}
 
 	{ //wait (until timeout) for sockets' data to become available:
-		struct timeval tv;
-		tv.tv_sec = std::lround(std::floor(timeout));
-		tv.tv_usec = std::lround((timeout - std::floor(timeout)) * 1e6);
-		//NOTE: on windows nfds is ignored -- https://msdn.microsoft.com/en-us/library/windows/desktop/ms740141(v=vs.85).aspx
-		int ret = select(max + 1, &read_fds, &write_fds, NULL, &tv);
+		//(rounding up, so a caller waiting out the rest of a tick doesn't spin on a zero timeout)
+		int timeout_ms = int(std::ceil(std::max(0.0, timeout) * 1000.0));
+		int ret = poll_sockets(fds.data(), fds.size(), timeout_ms);
 
 		if (ret < 0) {
-			std::cerr << "[" << where << "] Select returned an error; will attempt to read/write anyway." << std::endl;
+			std::cerr << "[" << where << "] poll returned an error; will attempt to read/write anyway." << std::endl;
+			for (auto &fd : fds) fd.revents = fd.events;
 		} else if (ret == 0) {
 			//nothing to read or write.
 			return;
 		}
 	}
 
+	//readable includes hangups/errors, so that recv() gets a chance to report them:
+	auto readable = [](PollFD const &fd) { return (fd.revents & (POLLIN | POLLHUP | POLLERR)) != 0; };
+
 	//add new connections as needed:
-	if (listen_socket != InvalidSocket && FD_ISSET(listen_socket, &read_fds)) {
-		Socket got = accept(listen_socket, NULL, NULL);
-		if (got == InvalidSocket) {
-			//oh well.
-		} else {
-			#ifdef _WIN32
-			unsigned long one = 1;
-			if (0 == ioctlsocket(got, FIONBIO, &one)) {
-			#else
-			{
-			#endif
-				connections.emplace_back();
-				connections.back().socket = got;
-				std::cerr << "[" << where << "] client connected on " << connections.back().socket << "." << std::endl; //INFO
-				if (on_event) on_event(&connections.back(), Connection::OnOpen);
+	// (accept everything that's waiting -- after a restart, a whole crowd of clients reconnects at once)
+	if (listen_socket != InvalidSocket && readable(fds[0])) {
+		while (true) {
+			Socket got = accept(listen_socket, NULL, NULL);
+			if (got == InvalidSocket) break; //(EAGAIN -- nobody else waiting -- or some transient error; try again next poll)
+			if (!set_nonblocking(got)) {
+				std::cerr << "[" << where << "] couldn't make accepted socket non-blocking, closing it." << std::endl;
+				closesocket(got);
+				continue;
 			}
+			if (accept_options) apply_connection_options(where, got, *accept_options);
+			connections.emplace_back();
+			connections.back().socket = got;
+			std::cerr << "[" << where << "] client connected on " << connections.back().socket << "." << std::endl; //INFO
+			if (on_event) on_event(&connections.back(), Connection::OnOpen);
 		}
 	}
 
@@ -123,9 +237,12 @@ void poll_connections(
 	static thread_local char *buffer = new char[BufferSize];
 
 	//process requests:
-	for (auto &c : connections) {
+	// (connections accepted above aren't in 'fds' yet; they get polled next time)
+	for (size_t i = 0; i < fds.size(); ++i) {
+		if (!watched[i]) continue;
+		Connection &c = *watched[i];
 		//only read from valid sockets marked readable:
-		if (c.socket == InvalidSocket || !FD_ISSET(c.socket, &read_fds)) continue;
+		if (c.socket == InvalidSocket || !readable(fds[i])) continue;
 
 		while (true) { //read until more data left to read
 			ssize_t ret = recv(c.socket, buffer, BufferSize, MSG_DONTWAIT);
@@ -147,15 +264,18 @@ void poll_connections(
 			} else { //ret > 0
 				c.recv_buffer.insert(c.recv_buffer.end(), buffer, buffer + ret);
 				if (on_event) on_event(&c, Connection::OnRecv);
+				if (c.socket == InvalidSocket) break; //callback closed the connection (e.g. ShardedServer's backlog limit)
 				if (ret < BufferSize) break; //ran out of data before buffer: no more data left to read
 			}
 		}
 	}
 
 	//process responses:
-	for (auto &c : connections) {
+	for (size_t i = 0; i < fds.size(); ++i) {
+		if (!watched[i]) continue;
+		Connection &c = *watched[i];
 		//don't bother with connections unless they are valid, have something to send, and are marked writable:
-		if (c.socket == InvalidSocket || c.send_buffer.empty() || !FD_ISSET(c.socket, &write_fds)) continue;
+		if (c.socket == InvalidSocket || c.send_buffer.empty() || !(fds[i].revents & POLLOUT)) continue;
 		
 		#ifdef _WIN32
 		ssize_t ret = send(c.socket, reinterpret_cast< char const * >(c.send_buffer.data()), int(c.send_buffer.size()), MSG_DONTWAIT);
@@ -163,8 +283,8 @@ void poll_connections(
 		ssize_t ret = send(c.socket, reinterpret_cast< char const * >(c.send_buffer.data()), c.send_buffer.size(), MSG_DONTWAIT);
 		#endif 
 		if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
-			//~no problem~, but don't keep trying
-			break;
+			//~no problem~, but don't keep trying on this connection (others may still have room):
+			continue;
 		} else if (ret <= 0 || ret > (ssize_t)c.send_buffer.size()) {
 			if (ret < 0) {
 				std::cerr << "[" << where << "] send() returned error " << errno << ", disconnecting." << std::endl;
@@ -174,7 +294,7 @@ void poll_connections(
 			c.close();
 			if (on_event) on_event(&c, Connection::OnClose);
 		} else { //ret seems reasonable
-			c.send_buffer.erase(c.send_buffer.begin(), c.send_buffer.begin() + ret);
+			consume_sent(c, size_t(ret));
 		}
 	}
 
@@ -184,7 +304,7 @@ void poll_connections(
 //---------------------------------
 
 
-Server::Server(std::string const &port) {
+Server::Server(std::string const &port, SocketOptions const &options) : socket_options(options) {
 
 	#ifdef _WIN32
 	{ //init winsock:
@@ -247,9 +367,25 @@ Server::Server(std::string const &port) {
 				}
 			}
 
+			if (socket_options.reuse_port) { //share port with other listeners:
+				#ifdef SO_REUSEPORT
+				if (!set_socket_option(s, SOL_SOCKET, SO_REUSEPORT, 1)) {
+					std::cout << "[note: couldn't set SO_REUSEPORT] " << std::endl;
+				}
+				#else
+				std::cout << "[note: SO_REUSEPORT not supported on this platform] " << std::endl;
+				#endif
+			}
+
+			//(buffer sizes set on the listening socket are inherited by accepted sockets on most platforms,
+			// and some only respect SO_RCVBUF set before listen(); they get re-applied after accept as well)
+			if (socket_options.recv_buffer_bytes > 0) set_socket_option(s, SOL_SOCKET, SO_RCVBUF, socket_options.recv_buffer_bytes);
+			if (socket_options.send_buffer_bytes > 0) set_socket_option(s, SOL_SOCKET, SO_SNDBUF, socket_options.send_buffer_bytes);
+
 			int ret = bind(s, info->ai_addr, int(info->ai_addrlen));
 			if (ret < 0) {
 				std::cout << "(failed to bind: " << strerror(errno) << ")" << std::endl;
+				closesocket(s);
 				continue;
 			}
 			std::cout << "success!" << std::endl;
@@ -266,16 +402,63 @@ Server::Server(std::string const &port) {
 	}
 
 	{ //listen on socket
-		int ret = ::listen(listen_socket, 5);
+		//(a deep backlog, so a reconnect storm queues in the kernel instead of being refused)
+		int ret = ::listen(listen_socket, SOMAXCONN);
 		if (ret < 0) {
 			closesocket(listen_socket);
 			throw std::system_error(errno, std::system_category(), "failed to listen on socket");
 		}
 	}
+
+	//non-blocking, so poll() can accept() until the backlog is empty:
+	if (!set_nonblocking(listen_socket)) {
+		closesocket(listen_socket);
+		throw std::system_error(errno, std::system_category(), "failed to make listen socket non-blocking");
+	}
+}
+
+//Apply send queue limits to every connection (closing the ones that are hopelessly behind):
+static void enforce_send_limits(
+	char const *where,
+	std::list< Connection > &connections,
+	Server::SendLimits const &limits,
+	Server::Stats &stats,
+	std::function< void(Connection *, Connection::Event event) > const &on_event) {
+
+	stats.queued_bytes = 0;
+	for (auto &c : connections) {
+		if (c.socket == InvalidSocket) continue;
+
+		if (limits.high_water != 0 && c.send_buffer.size() > limits.high_water) {
+			if (limits.policy == Server::SendLimits::DropStale) {
+				uint64_t frames_before = c.stats.dropped_frames;
+				size_t dropped = c.drop_stale(1);
+				stats.dropped_frames += c.stats.dropped_frames - frames_before;
+				stats.dropped_bytes += dropped;
+			}
+		}
+
+		bool over_hard = (limits.hard_limit != 0 && c.send_buffer.size() > limits.hard_limit);
+		bool over_high = (limits.high_water != 0 && c.send_buffer.size() > limits.high_water);
+		if (over_hard || (over_high && limits.policy == Server::SendLimits::Disconnect)) {
+			std::cerr << "[" << where << "] connection " << c.socket << " has " << c.send_buffer.size() << " bytes queued (limit " << (over_hard ? limits.hard_limit : limits.high_water) << "), disconnecting." << std::endl;
+			stats.limit_disconnects += 1;
+			c.close();
+			if (on_event) on_event(&c, Connection::OnClose);
+			continue;
+		}
+
+		c.stats.peak_queued_bytes = std::max(c.stats.peak_queued_bytes, c.send_buffer.size());
+		stats.peak_queued_bytes = std::max(stats.peak_queued_bytes, c.send_buffer.size());
+		stats.queued_bytes += c.send_buffer.size();
+	}
 }
 
 void Server::poll(std::function< void(Connection *, Connection::Event event) > const &on_event, double timeout) {
-	poll_connections("Server::poll", connections, on_event, timeout, listen_socket);
+	//data queued since the last poll (e.g. this tick's state) may have pushed a connection past its limits:
+	enforce_send_limits("Server::poll", connections, send_limits, stats, on_event);
+
+	poll_connections("Server::poll", connections, on_event, timeout, listen_socket, &socket_options);
 
 	//reap closed clients:
 	for (auto connection = connections.begin(); connection != connections.end(); /*later*/) {
@@ -287,7 +470,7 @@ void Server::poll(std::function< void(Connection *, Connection::Event event) > c
 	}
 }
 
-Client::Client(std::string const &host, std::string const &port) : connections(1), connection(connections.front()) {
+Client::Client(std::string const &host, std::string const &port, SocketOptions const &options) : connections(1), connection(connections.front()), socket_options(options) {
 	#ifdef _WIN32
 	{ //init winsock:
 		WSADATA info;
@@ -335,9 +518,12 @@ Client::Client(std::string const &host, std::string const &port) : connections(1
 				std::cout << "(failed to create socket: " << strerror(errno) << ")" << std::endl;
 				continue;
 			}
+			//(before connect() so buffer sizes can affect the window negotiated in the handshake)
+			apply_connection_options("Client::Client", s, socket_options);
 			int ret = connect(s, info->ai_addr, int(info->ai_addrlen));
 			if (ret < 0) {
 				std::cout << "(failed to connect: " << strerror(errno) << ")" << std::endl;
+				closesocket(s);
 				continue;
 			}
 			std::cout << "success!" << std::endl;
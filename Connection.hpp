@@ -81,6 +81,15 @@ struct Connection {
 	//Call 'close' to mark a connection for discard:
 	void close();
 
+	//Mark send_buffer[begin, end) as a droppable frame.
+	// Droppable frames (e.g. full state snapshots) are superseded by any later droppable frame,
+	// so they may be discarded from the queue if the peer isn't keeping up (see Server::SendLimits):
+	void mark_droppable(size_t begin);
+
+	//Discard queued droppable frames that haven't started transmitting yet, keeping the newest 'keep':
+	// returns the number of bytes discarded.
+	size_t drop_stale(size_t keep = 1);
+
 	//so you can if(connection) ... to check for validity:
 	explicit operator bool() { return socket != InvalidSocket; }
 
@@ -89,8 +98,20 @@ struct Connection {
 	//When the connection receives data, it is appended to recv_buffer:
 	std::vector< uint8_t > recv_buffer;
 
+	//Send queue bookkeeping, useful for spotting slow peers:
+	struct Stats {
+		size_t peak_queued_bytes = 0; //largest send_buffer size seen at poll time
+		uint64_t sent_bytes = 0; //total bytes handed to the socket
+		uint64_t dropped_frames = 0; //droppable frames discarded by drop_stale()
+		uint64_t dropped_bytes = 0; //...and the bytes they contained
+	} stats;
+
 	//internals:
 	Socket socket = InvalidSocket;
+	bool owns_socket = true; //false for stand-ins of a socket owned by another thread (see ShardedServer); close() then only marks the connection closed
+
+	//[begin,end) ranges of droppable frames in send_buffer (sorted, non-overlapping):
+	std::vector< std::pair< size_t, size_t > > droppable;
 
 
 	enum Event {
@@ -100,8 +121,36 @@ struct Connection {
 	};
 };
 
+//Options applied to the sockets a Server or Client creates:
+struct SocketOptions {
+	bool no_delay = true; //TCP_NODELAY: send small frames right away instead of letting Nagle's algorithm hold them back
+	int send_buffer_bytes = 0; //SO_SNDBUF (0 = leave at OS default)
+	int recv_buffer_bytes = 0; //SO_RCVBUF (0 = leave at OS default)
+	bool reuse_port = false; //SO_REUSEPORT (listening sockets only): lets several Servers -- e.g., one per thread -- accept on the same port
+	int busy_poll_us = 0; //SO_BUSY_POLL (linux only): busy-wait this long for incoming packets before sleeping (0 = off)
+};
+
 struct Server {
-	Server(std::string const &port); //pass the port number to listen on, as a string (servname, really)
+	Server(std::string const &port, SocketOptions const &options = SocketOptions()); //pass the port number to listen on, as a string (servname, really)
+
+	//Limits on each connection's send queue, so a client that stops reading can't grow send_buffer forever:
+	struct SendLimits {
+		enum Policy : uint8_t {
+			DropStale, //over high_water: discard all but the newest queued droppable frame
+			Disconnect //over high_water: close the connection
+		} policy = DropStale;
+		size_t high_water = 64 * 1024; //queued bytes at which 'policy' kicks in (0 = unlimited)
+		size_t hard_limit = 1024 * 1024; //queued bytes at which the connection is closed no matter the policy (0 = unlimited)
+	} send_limits;
+
+	//Totals over all connections (including ones already closed):
+	struct Stats {
+		size_t queued_bytes = 0; //bytes waiting in send buffers as of the last poll
+		size_t peak_queued_bytes = 0; //largest single-connection send buffer seen
+		uint64_t dropped_frames = 0; //droppable frames discarded under DropStale
+		uint64_t dropped_bytes = 0;
+		uint64_t limit_disconnects = 0; //connections closed for exceeding send limits
+	} stats;
 
 	//poll() updates the list of active connections and sends/receives data if possible:
 	// (will wait up to 'timeout' for first event)
@@ -112,11 +161,12 @@ struct Server {
 
 	std::list< Connection > connections;
 	Socket listen_socket = InvalidSocket;
+	SocketOptions socket_options; //(also applied to accepted connections)
 };
 
 
 struct Client {
-	Client(std::string const &host, std::string const &port);
+	Client(std::string const &host, std::string const &port, SocketOptions const &options = SocketOptions());
 
 	//poll() checks the status of the active connection and sends/receives data if possible:
 	// (will wait up to 'timeout' for first event)
@@ -127,4 +177,5 @@ struct Client {
 
 	std::list< Connection > connections; //will only ever contain exactly one connection
 	Connection &connection; //reference to the only connection in the connections list
+	SocketOptions socket_options;
 };
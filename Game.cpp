@@ -12,48 +12,37 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/norm.hpp>
 
-// ---------- wire I/O for controls (unchanged) ----------
+// ---------- wire I/O for controls ----------
 
-void Player::Controls::send_controls_message(Connection *connection_) const {
+void Player::Controls::send_controls_message(Connection *connection_, uint32_t tick, uint8_t actions) const {
 	assert(connection_);
 	auto &connection = *connection_;
 
-	uint32_t size = 5;
-	connection.send(Message::C2S_Controls);
-	connection.send(uint8_t(size));
-	connection.send(uint8_t(size >> 8));
-	connection.send(uint8_t(size >> 16));
-
-	auto send_button = [&](Button const &b) {
+	auto pack_button = [](Button const &b) -> uint8_t {
 		if (b.downs & 0x80) {
 			std::cerr << "Wow, you are really good at pressing buttons!" << std::endl;
 		}
-		connection.send(uint8_t( (b.pressed ? 0x80 : 0x00) | (b.downs & 0x7f) ) );
+		return uint8_t( (b.pressed ? 0x80 : 0x00) | (b.downs & 0x7f) );
 	};
 
-	send_button(left);
-	send_button(right);
-	send_button(up);
-	send_button(down);
-	send_button(jump);
+	C2S_InputMessage message;
+	message.tick = tick;
+	message.left = pack_button(left);
+	message.right = pack_button(right);
+	message.up = pack_button(up);
+	message.down = pack_button(down);
+	message.jump = pack_button(jump);
+	message.actions = actions;
+	send_frame(message, &connection.send_buffer);
 }
 
-bool Player::Controls::recv_controls_message(Connection *connection_) {
+bool Player::Controls::recv_controls_message(Connection *connection_, uint8_t *actions, uint32_t *tick) {
 	assert(connection_);
+	assert(actions);
 	auto &connection = *connection_;
 
-	auto &recv_buffer = connection.recv_buffer;
-
-	// expecting [type, size_low0, size_mid8, size_high8]:
-	if (recv_buffer.size() < 4) return false;
-	if (recv_buffer[0] != uint8_t(Message::C2S_Controls)) return false;
-	uint32_t size = (uint32_t(recv_buffer[3]) << 16)
-	              | (uint32_t(recv_buffer[2]) << 8)
-	              |  uint32_t(recv_buffer[1]);
-	if (size != 5) throw std::runtime_error("Controls message with size " + std::to_string(size) + " != 5!");
-
-	// need complete message:
-	if (recv_buffer.size() < 4 + size) return false;
+	C2S_InputMessage message;
+	if (!recv_frame(&connection.recv_buffer, &message)) return false;
 
 	auto recv_button = [](uint8_t byte, Button *button) {
 		button->pressed = (byte & 0x80);
@@ -65,14 +54,14 @@ bool Player::Controls::recv_controls_message(Connection *connection_) {
 		button->downs = uint8_t(d);
 	};
 
-	recv_button(recv_buffer[4+0], &left);
-	recv_button(recv_buffer[4+1], &right);
-	recv_button(recv_buffer[4+2], &up);
-	recv_button(recv_buffer[4+3], &down);
-	recv_button(recv_buffer[4+4], &jump);
+	recv_button(message.left, &left);
+	recv_button(message.right, &right);
+	recv_button(message.up, &up);
+	recv_button(message.down, &down);
+	recv_button(message.jump, &jump);
 
-	// delete message from buffer:
-	recv_buffer.erase(recv_buffer.begin(), recv_buffer.begin() + 4 + size);
+	*actions |= message.actions;
+	if (tick) *tick = message.tick;
 
 	return true;
 }
@@ -389,15 +378,14 @@ void Game::send_state_message(Connection *connection_, Player *connection_player
 	assert(connection_);
 	auto &connection = *connection_;
 
-	connection.send(Message::S2C_State);
-	// placeholder size (3 bytes)
-	connection.send(uint8_t(0));
-	connection.send(uint8_t(0));
-	connection.send(uint8_t(0));
-	size_t mark = connection.send_buffer.size();
+	//state messages are full snapshots, so a newer one makes any still-queued older one redundant:
+	size_t frame_begin = connection.send_buffer.size();
 
-	// write phase + winner_index first:
-	int8_t winner_for_conn = -1;
+	S2C_StateMessage message;
+	message.phase = phase;
+
+	// winner from this connection's perspective:
+	message.winner_index = -1;
 	if (winner_index >= 0) {
 		// identify p0/p1 in server list:
 		const Player* p0 = nullptr;
@@ -409,98 +397,59 @@ void Game::send_state_message(Connection *connection_, Player *connection_player
 		const Player* server_winner = (winner_index == 0 ? p0 : p1);
 		if (connection_player && server_winner && p0 && p1) {
 			// map to perspective: 0 = you, 1 = opponent
-			winner_for_conn = (server_winner == connection_player) ? 0 : 1;
+			message.winner_index = (server_winner == connection_player) ? 0 : 1;
 		} else {
 			// fallback (e.g., unexpected states)
-			winner_for_conn = winner_index;
+			message.winner_index = winner_index;
 		}
 	}
 
-	connection.send(uint8_t(phase));
-	connection.send(int8_t(winner_for_conn));
-
-	// helper to send a player:
-	auto send_player = [&](Player const &player) {
-		connection.send(player.position);
-		connection.send(player.velocity);
-		connection.send(player.color);
-		uint8_t len = uint8_t(std::min< size_t >(255, player.name.size()));
-		connection.send(len);
-		connection.send_buffer.insert(connection.send_buffer.end(), player.name.begin(), player.name.begin() + len);
-		// ready + hp
-		connection.send(uint8_t(player.ready ? 1 : 0));
-		connection.send(uint8_t(player.hp));
+	// helper to add a player:
+	auto add_player = [&](Player const &player) {
+		S2C_StateMessage::PlayerEntry *entry = message.players.push_back();
+		if (!entry) return; //more players than the message can describe
+		entry->position = player.position;
+		entry->velocity = player.velocity;
+		entry->color = player.color;
+		entry->name.assign(player.name);
+		entry->ready = uint8_t(player.ready ? 1 : 0);
+		entry->hp = player.hp;
 	};
 
-	// player count (send connection's player first)
-	connection.send(uint8_t(players.size()));
-	if (connection_player) send_player(*connection_player);
+	// connection's player first:
+	if (connection_player) add_player(*connection_player);
 	for (auto const &player : players) {
 		if (&player == connection_player) continue;
-		send_player(player);
+		add_player(player);
 	}
 
-	// patch size
-	uint32_t size = uint32_t(connection.send_buffer.size() - mark);
-	connection.send_buffer[mark-3] = uint8_t(size);
-	connection.send_buffer[mark-2] = uint8_t(size >> 8);
-	connection.send_buffer[mark-1] = uint8_t(size >> 16);
+	send_frame(message, &connection.send_buffer);
+
+	connection.mark_droppable(frame_begin);
 }
 
 bool Game::recv_state_message(Connection *connection_) {
 	assert(connection_);
 	auto &connection = *connection_;
-	auto &recv_buffer = connection.recv_buffer;
-
-	if (recv_buffer.size() < 4) return false;
-	if (recv_buffer[0] != uint8_t(Message::S2C_State)) return false;
-	uint32_t size = (uint32_t(recv_buffer[3]) << 16)
-	              | (uint32_t(recv_buffer[2]) << 8)
-	              |  uint32_t(recv_buffer[1]);
-	uint32_t at = 0;
-	if (recv_buffer.size() < 4 + size) return false;
-
-	auto read = [&](auto *val) {
-		if (at + sizeof(*val) > size) throw std::runtime_error("Ran out of bytes reading state message.");
-		std::memcpy(val, &recv_buffer[4 + at], sizeof(*val));
-		at += sizeof(*val);
-	};
 
-	// read phase + winner_index
-	uint8_t phase_u8 = 0;
-	int8_t win_i8 = -1;
-	read(&phase_u8);
-	read(&win_i8);
-	phase = Phase(phase_u8);
-	winner_index = win_i8;
+	//(static because it's a couple of kilobytes; only used on the client's main thread)
+	static S2C_StateMessage message;
+	if (!recv_frame(&connection.recv_buffer, &message)) return false;
+
+	phase = message.phase;
+	winner_index = message.winner_index;
 
 	players.clear();
-	uint8_t player_count = 0;
-	read(&player_count);
-	for (uint8_t i = 0; i < player_count; ++i) {
+	for (auto const &entry : message.players) {
 		players.emplace_back();
 		Player &player = players.back();
-		read(&player.position);
-		read(&player.velocity);
-		read(&player.color);
-		uint8_t name_len = 0;
-		read(&name_len);
-		player.name.clear();
-		for (uint8_t n = 0; n < name_len; ++n) {
-			char c;
-			read(&c);
-			player.name += c;
-		}
-		uint8_t ready_u8 = 0;
-		uint8_t hp_u8 = 3;
-		read(&ready_u8);
-		read(&hp_u8);
-		player.ready = (ready_u8 != 0);
-		player.hp = hp_u8;
+		player.position = entry.position;
+		player.velocity = entry.velocity;
+		player.color = entry.color;
+		player.name = entry.name.view();
+		player.ready = (entry.ready != 0);
+		player.hp = entry.hp;
 	}
 
-	if (at != size) throw std::runtime_error("Trailing data in state message.");
-
-	recv_buffer.erase(recv_buffer.begin(), recv_buffer.begin() + 4 + size);
 	return true;
 }
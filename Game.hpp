@@ -1,6 +1,8 @@
 //@ChatGPT used
 #pragma once
 
+#include "message_codec.hpp"
+
 #include <glm/glm.hpp>
 
 #include <string>
@@ -13,9 +15,9 @@ struct Connection;
 
 // ---- wire message types ----
 enum class Message : uint8_t {
-	C2S_Controls = 1,    // 5-byte controls
+	C2S_Input    = 'i',  // client -> server tick tag + 5 controls + action bitmask (bit0=attack, bit1=defend, bit2=parry)
 	S2C_State    = 's',  // server -> client state
-	C2S_Action   = 'a',  // client -> server action bitmask (bit0=attack, bit1=defend, bit2=parry)
+	S2C_Fail     = 'F',  // server -> client error text (client disconnects)
 };
 
 // ---- high-level phase for client UI ----
@@ -25,6 +27,7 @@ enum class Phase : uint8_t {
 	Playing = 2,     // in game
 	RoundEnd = 3     // round over
 };
+template< > struct FrameEnum< Phase > { static constexpr Phase Max = Phase::RoundEnd; };
 
 // ---- action bits (for pending_action) ----
 enum ActionBits : uint8_t {
@@ -33,6 +36,50 @@ enum ActionBits : uint8_t {
 	Action_Parry  = 1 << 2
 };
 
+// ---- wire message layouts (framing in message_codec.hpp) ----
+// one frame per client send interval (or sooner, if something was pressed):
+struct C2S_InputMessage {
+	static constexpr Message Type = Message::C2S_Input;
+	uint32_t tick = 0; // client send tick (counts Game::Tick intervals of client time)
+	// per button: (pressed ? 0x80 : 0x00) | (downs & 0x7f)
+	uint8_t left = 0, right = 0, up = 0, down = 0, jump = 0;
+	uint8_t actions = 0; // ActionBits pressed since the previous input message
+	static constexpr auto Fields = std::make_tuple(
+		&C2S_InputMessage::tick,
+		&C2S_InputMessage::left, &C2S_InputMessage::right,
+		&C2S_InputMessage::up, &C2S_InputMessage::down,
+		&C2S_InputMessage::jump, &C2S_InputMessage::actions
+	);
+};
+
+struct S2C_StateMessage {
+	static constexpr Message Type = Message::S2C_State;
+	struct PlayerEntry {
+		glm::vec2 position = glm::vec2(0.0f);
+		glm::vec2 velocity = glm::vec2(0.0f);
+		glm::vec3 color = glm::vec3(1.0f);
+		Str8< 255 > name;
+		uint8_t ready = 0;
+		uint8_t hp = 0;
+		static constexpr auto Fields = std::make_tuple(
+			&PlayerEntry::position, &PlayerEntry::velocity, &PlayerEntry::color,
+			&PlayerEntry::name, &PlayerEntry::ready, &PlayerEntry::hp
+		);
+	};
+	Phase phase = Phase::Waiting;
+	int8_t winner_index = -1; // 0 = receiving player, 1 = opponent
+	List8< PlayerEntry, 8 > players; // receiving player first
+	static constexpr auto Fields = std::make_tuple(
+		&S2C_StateMessage::phase, &S2C_StateMessage::winner_index, &S2C_StateMessage::players
+	);
+};
+
+struct S2C_FailMessage {
+	static constexpr Message Type = Message::S2C_Fail;
+	Str8< 255 > text;
+	static constexpr auto Fields = std::make_tuple(&S2C_FailMessage::text);
+};
+
 // ---- input button ----
 struct Button {
 	uint8_t downs = 0;   // number of press events since last tick
@@ -44,12 +91,16 @@ struct Player {
 	// client -> server controls
 	struct Controls {
 		Button left, right, up, down, jump;
-		void send_controls_message(Connection *connection) const;
-		bool recv_controls_message(Connection *connection);
+		// controls and actions travel together in one C2S_Input frame:
+		void send_controls_message(Connection *connection, uint32_t tick, uint8_t actions) const;
+		// returns true if a message was read; action bits are OR'd into *actions:
+		bool recv_controls_message(Connection *connection, uint8_t *actions, uint32_t *tick = nullptr);
 	} controls;
 
 	// server-side: bitmask of ActionBits to be consumed in update()
 	uint8_t pending_action = 0;
+	// server-side: tick tag of the latest input message
+	uint32_t input_tick = 0;
 
 	// gameplay state (server authoritative; sent to clients)
 	bool ready = false;
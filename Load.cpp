@@ -1,20 +1,76 @@
 #include "Load.hpp"
 
+#include <algorithm>
 #include <array>
-#include <list>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <thread>
 #include <cassert>
 
 namespace {
-	std::array< std::list< std::function< void() > >, MaxLoadTag > &get_load_lists() {
-		static std::array< std::list< std::function< void() > >, MaxLoadTag > load_lists;
-		return load_lists;
+	struct LoadJob {
+		LoadTag tag;
+		std::function< void() > prepare; //(may be empty) run on a worker thread
+		std::function< void() > finish; //run on the main thread
+		std::vector< LoadId > after; //jobs that must finish before this one prepares
+
+		//used while loading:
+		std::vector< LoadId > dependents; //jobs that list this one in 'after'
+		uint32_t waiting = 0; //unfinished jobs in 'after'
+		std::exception_ptr error; //thrown by 'prepare'
+	};
+
+	std::vector< LoadJob > &get_load_jobs() {
+		static std::vector< LoadJob > load_jobs;
+		return load_jobs;
+	}
+
+	//most recent main-thread-only job of each tag (these keep their registration order):
+	std::array< LoadId, MaxLoadTag > &get_last_in_order() {
+		static std::array< LoadId, MaxLoadTag > last_in_order = []() {
+			std::array< LoadId, MaxLoadTag > ret;
+			ret.fill(-1U);
+			return ret;
+		}();
+		return last_in_order;
 	}
 }
 
-void add_load_function(LoadTag tag, std::function< void() > const &fn) {
-	auto &load_lists = get_load_lists();
-	assert(tag < load_lists.size());
-	load_lists[tag].emplace_back(fn);
+bool print_load_timing = false;
+uint32_t load_worker_count = 0;
+
+LoadId add_load_function(LoadTag tag, std::function< void() > const &fn) {
+	assert(tag < MaxLoadTag);
+	auto &jobs = get_load_jobs();
+	LoadId &last = get_last_in_order()[tag];
+
+	LoadId id = LoadId(jobs.size());
+	jobs.emplace_back();
+	jobs.back().tag = tag;
+	jobs.back().finish = fn;
+	if (last != -1U) jobs.back().after.emplace_back(last);
+	last = id;
+	return id;
+}
+
+LoadId add_load_function(LoadTag tag, std::function< void() > const &prepare, std::function< void() > const &finish, std::vector< LoadId > const &after) {
+	assert(tag < MaxLoadTag);
+	auto &jobs = get_load_jobs();
+
+	LoadId id = LoadId(jobs.size());
+	for (LoadId a : after) {
+		if (a >= id) throw std::runtime_error("Load dependency on a load that doesn't exist (yet).");
+	}
+	jobs.emplace_back();
+	jobs.back().tag = tag;
+	jobs.back().prepare = prepare;
+	jobs.back().finish = finish;
+	jobs.back().after = after;
+	return id;
 }
 
 void call_load_functions() {
@@ -22,11 +78,139 @@ void call_load_functions() {
 	assert(!has_been_called && "call_load_functions should only be called *once*");
 	has_been_called = true;
 
-	auto &load_lists = get_load_lists();
-	for (auto &fn_list : load_lists) {
-		while (!fn_list.empty()) {
-			(*fn_list.begin())(); //call first function in the list
-			fn_list.pop_front(); //remove from list
+	auto before = std::chrono::high_resolution_clock::now();
+
+	auto &jobs = get_load_jobs();
+	uint32_t total = uint32_t(jobs.size());
+
+	//count how many jobs of each tag are left, so 'finish' calls can be held back until earlier tags are done:
+	std::array< uint32_t, MaxLoadTag > unfinished_in_tag;
+	unfinished_in_tag.fill(0);
+	for (auto &job : jobs) {
+		unfinished_in_tag[job.tag] += 1;
+	}
+	auto current_tag = [&]() {
+		uint32_t tag = 0;
+		while (tag < MaxLoadTag && unfinished_in_tag[tag] == 0) ++tag;
+		return tag;
+	};
+
+	for (LoadId id = 0; id < total; ++id) {
+		for (LoadId a : jobs[id].after) {
+			jobs[a].dependents.emplace_back(id);
+			jobs[id].waiting += 1;
+		}
+	}
+
+	//shared with the workers (guarded by 'mutex'):
+	std::mutex mutex;
+	std::condition_variable to_prepare_cv; //signalled when 'to_prepare' grows (or on quit)
+	std::condition_variable prepared_cv; //signalled when 'prepared' grows
+	std::deque< LoadId > to_prepare; //jobs ready for a worker
+	std::deque< LoadId > prepared; //jobs ready for 'finish' (subject to tag order)
+	uint32_t preparing = 0; //jobs currently in a worker's hands
+	bool quit = false;
+
+	//a job whose dependencies are done goes to a worker, or (if there's nothing to prepare) straight on to be finished:
+	auto ready = [&](LoadId id) {
+		if (jobs[id].prepare) {
+			to_prepare.emplace_back(id);
+			to_prepare_cv.notify_one();
+		} else {
+			prepared.emplace_back(id);
 		}
+	};
+
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		for (LoadId id = 0; id < total; ++id) {
+			if (jobs[id].waiting == 0) ready(id);
+		}
+	}
+
+	//worker threads just run 'prepare' functions:
+	// (one core is left for the main thread, but at least two workers so slow loads can overlap even on small machines)
+	uint32_t cores = std::thread::hardware_concurrency();
+	uint32_t worker_count = load_worker_count ? load_worker_count : std::clamp(cores > 1 ? cores - 1 : 1u, 2u, 8u);
+	std::vector< std::thread > workers;
+	for (uint32_t w = 0; w < worker_count; ++w) {
+		workers.emplace_back([&]() {
+			std::unique_lock< std::mutex > lock(mutex);
+			while (true) {
+				to_prepare_cv.wait(lock, [&]() { return quit || !to_prepare.empty(); });
+				if (quit) break;
+				LoadId id = to_prepare.front();
+				to_prepare.pop_front();
+				preparing += 1;
+
+				lock.unlock();
+				try {
+					jobs[id].prepare();
+				} catch (...) {
+					jobs[id].error = std::current_exception();
+				}
+				lock.lock();
+
+				preparing -= 1;
+				prepared.emplace_back(id);
+				prepared_cv.notify_one();
+			}
+		});
+	}
+
+	//stop the workers on the way out (even if a 'finish' throws):
+	struct StopWorkers {
+		std::function< void() > fn;
+		~StopWorkers() { fn(); }
+	} stop_workers{ [&]() {
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			quit = true;
+		}
+		to_prepare_cv.notify_all();
+		for (auto &worker : workers) {
+			worker.join();
+		}
+	} };
+
+	//main thread runs 'finish' functions as jobs become ready:
+	for (uint32_t finished = 0; finished < total; ++finished) {
+		LoadId id = -1U;
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			while (true) {
+				uint32_t tag = current_tag();
+				auto f = std::find_if(prepared.begin(), prepared.end(), [&](LoadId p) { return jobs[p].tag <= tag; });
+				if (f != prepared.end()) {
+					id = *f;
+					prepared.erase(f);
+					break;
+				}
+				if (preparing == 0 && to_prepare.empty()) {
+					throw std::runtime_error("Load functions can't make progress (a dependency cycle, or a load that depends on one with a later tag?).");
+				}
+				prepared_cv.wait(lock);
+			}
+		}
+
+		LoadJob &job = jobs[id];
+		if (job.error) std::rethrow_exception(job.error);
+		job.finish();
+
+		std::unique_lock< std::mutex > lock(mutex);
+		unfinished_in_tag[job.tag] -= 1;
+		for (LoadId d : job.dependents) {
+			assert(jobs[d].waiting > 0);
+			jobs[d].waiting -= 1;
+			if (jobs[d].waiting == 0) ready(d);
+		}
+	}
+
+	if (print_load_timing) {
+		auto after = std::chrono::high_resolution_clock::now();
+		std::cout << "Loaded " << total << " things in " << std::chrono::duration< double, std::milli >(after - before).count() << " ms"
+		          << " (" << worker_count << " worker thread" << (worker_count == 1 ? "" : "s") << ")." << std::endl;
 	}
+
+	jobs.clear();
 }
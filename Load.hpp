@@ -20,10 +20,28 @@
  * These functions are grouped by 'tags', which allow some sequencing of calls.
  * (particularly, this is useful for loading large data blobs [e.g. Meshes] before looking up individual elements within them.)
  *
+ * Loads that do a lot of CPU work (reading files, decoding) can split it off into a 'prepare' function,
+ * which call_load_functions() runs on a pool of worker threads; only the 'finish' function
+ * (e.g. the OpenGL upload) runs on the main thread:
+ *
+ * Load< Texture > tex(LoadTagDefault,
+ *     []() { return decode_png(data_path("tex.png")); },            //any thread
+ *     [](Image &&image) { return new Texture(upload(image)); });  //main thread
+ *
+ * Tags only order the main-thread parts: all 'finish' functions of one tag are done before those of the
+ * next tag start, while 'prepare' functions start as early as their dependencies allow.
+ * Explicit dependencies can be given by id: a load won't start preparing until everything it
+ * depends on has finished:
+ *
+ * Load< Level > level(LoadTagDefault, prepare_level, finish_level, { tex.id });
  */
 
 #include <functional>
+#include <memory>
+#include <optional>
 #include <stdexcept>
+#include <type_traits>
+#include <vector>
 #include <cstdint>
 
 enum LoadTag : uint32_t {
@@ -33,15 +51,32 @@ enum LoadTag : uint32_t {
 	MaxLoadTag //<-- just used to track # of load tags
 };
 
+//Identifies a load, for use in dependency lists:
+typedef uint32_t LoadId;
+
 //Add a function to an internal list of loading functions:
 // (only call *before* "call_load_functions()")
-void add_load_function(LoadTag tag, std::function< void() > const &fn);
+// functions added this way run on the main thread, in the order they were added (within their tag)
+LoadId add_load_function(LoadTag tag, std::function< void() > const &fn);
+
+//Add a load split into a 'prepare' part (run on a worker thread) and a 'finish' part (run on the main thread):
+// 'after' lists loads that must finish before this one's 'prepare' starts.
+// 'prepare' must not touch OpenGL (or anything else the main thread might be using).
+LoadId add_load_function(LoadTag tag, std::function< void() > const &prepare, std::function< void() > const &finish, std::vector< LoadId > const &after = {});
 
 //Call all loading functions:
-// (loading functions may throw exceptions if they fail.)
+// (loading functions may throw exceptions if they fail; the first exception is re-thrown here.)
 // (only call *once*)
 void call_load_functions();
 
+//Set to have call_load_functions() print how long loading took (e.g., when working on startup time):
+// (the client sets this with --load-timing; see README.md)
+extern bool print_load_timing;
+
+//Worker threads call_load_functions() uses for 'prepare' parts (0 picks based on the number of cores):
+// (1 is close to loading serially, which is handy for comparing against)
+extern uint32_t load_worker_count;
+
 
 //work-around for MSVC not accepting this as a lambda:
 template< typename T >
@@ -51,7 +86,7 @@ template< typename T >
 struct Load {
 	//Constructing a Load< T > adds the passed function to the list of functions to call:
 	Load(LoadTag tag, const std::function< T const *() > &load_fn = new_T< T >) : value(nullptr) {
-		add_load_function(tag, [this,load_fn](){
+		id = add_load_function(tag, [this,load_fn](){
 			this->value = load_fn();
 			if (!(this->value)) {
 				throw std::runtime_error("Loading failed.");
@@ -59,6 +94,23 @@ struct Load {
 		});
 	}
 
+	//Two-part load: 'prepare()' runs on a worker thread and returns some intermediate value,
+	// which is then passed to 'finish()' on the main thread to produce the T:
+	template< typename Prepare, typename Finish >
+	Load(LoadTag tag, Prepare prepare, Finish finish, std::vector< LoadId > const &after = {}) : value(nullptr) {
+		typedef std::invoke_result_t< Prepare > Prepared;
+		auto prepared = std::make_shared< std::optional< Prepared > >();
+		id = add_load_function(tag, [prepared,prepare](){
+			prepared->emplace(prepare());
+		}, [this,prepared,finish](){
+			this->value = finish(std::move(**prepared));
+			prepared->reset();
+			if (!(this->value)) {
+				throw std::runtime_error("Loading failed.");
+			}
+		}, after);
+	}
+
 	//Make a "Load< T >" behave like a "T const *":
 	explicit operator bool() { return value != nullptr; }
 	operator T const *() { return value; }
@@ -66,6 +118,7 @@ struct Load {
 	T const *operator->() { return value; }
 
 	T const *value;
+	LoadId id;
 };
 
 
@@ -75,8 +128,27 @@ template< >
 struct Load< void > {
 	//Constructing a Load< T > adds the passed function to the list of functions to call:
 	Load( LoadTag tag, const std::function< void() > &load_fn) {
-		add_load_function(tag, load_fn);
+		id = add_load_function(tag, load_fn);
 	}
+
+	//Two-part load (see above); 'finish()' takes the result of 'prepare()', or nothing if 'prepare()' returns void:
+	template< typename Prepare, typename Finish >
+	Load(LoadTag tag, Prepare prepare, Finish finish, std::vector< LoadId > const &after = {}) {
+		typedef std::invoke_result_t< Prepare > Prepared;
+		if constexpr (std::is_void_v< Prepared >) {
+			id = add_load_function(tag, prepare, finish, after);
+		} else {
+			auto prepared = std::make_shared< std::optional< Prepared > >();
+			id = add_load_function(tag, [prepared,prepare](){
+				prepared->emplace(prepare());
+			}, [prepared,finish](){
+				finish(std::move(**prepared));
+				prepared->reset();
+			}, after);
+		}
+	}
+
+	LoadId id;
 };
 
 
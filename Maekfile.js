@@ -139,6 +139,8 @@ if (maek.OS === 'windows') {
 	copies.push( maek.COPY(`${NEST_LIBS}/SDL3/dist/SDL3.dll`, `dist/SDL3.dll`) );
 	//this one needed because the show-*.exe helpers sit in scenes/:
 	copies.push( maek.COPY(`${NEST_LIBS}/SDL3/dist/SDL3.dll`, `scenes/SDL3.dll`) );
+	//...and the benchmarks in bench/:
+	copies.push( maek.COPY(`${NEST_LIBS}/SDL3/dist/SDL3.dll`, `bench/SDL3.dll`) );
 }
 
 //call rules on the maek object to specify tasks.
@@ -149,20 +151,35 @@ if (maek.OS === 'windows') {
 // cppFile: name of c++ file to compile
 // objFileBase (optional): base name object file to produce (if not supplied, set to options.objDir + '/' + cppFile without the extension)
 //returns objFile: objFileBase + a platform-dependant suffix ('.o' or '.obj')
+
+//client code that the benchmarks (below) link as well:
+const mix_span_obj = maek.CPP('mix_span.cpp');
+const sprite_renderer_obj = maek.CPP('SpriteRenderer.cpp');
+const lit_color_texture_program_obj = maek.CPP('LitColorTextureProgram.cpp');
+
 const client_names = [
 	maek.CPP('client.cpp'),
 	maek.CPP('PlayMode.cpp'),
-	maek.CPP('LitColorTextureProgram.cpp'),
+	lit_color_texture_program_obj,
 	//maek.CPP('ColorTextureProgram.cpp'),  //not used right now, but you might want it
 	maek.CPP('Sound.cpp'),
+	sprite_renderer_obj,
+	maek.CPP('Widgets.cpp')
+];
+
+//asset loading code shared by the client and bake:
+const asset_names = [
 	maek.CPP('load_wav.cpp'),
+	maek.CPP('resample.cpp'),
+	mix_span_obj, //(resample.cpp uses its cpu_has_avx)
 	maek.CPP('load_opus.cpp'),
 	maek.CPP('TextRenderer.cpp'),
-	maek.CPP('SpriteRenderer.cpp')
+	maek.CPP('ShelfPacker.cpp')
 ];
 
 const server_names = [
-	maek.CPP('server.cpp')
+	maek.CPP('server.cpp'),
+	maek.CPP('ShardedServer.cpp')
 ];
 
 const common_names = [
@@ -174,6 +191,8 @@ const common_names = [
 	maek.CPP('ColorProgram.cpp'),
 	maek.CPP('Scene.cpp'),
 	maek.CPP('Mesh.cpp'),
+	maek.CPP('MappedFile.cpp'),
+	maek.CPP('Pack.cpp'),
 	maek.CPP('load_save_png.cpp'),
 	maek.CPP('gl_compile_program.cpp'),
 	maek.CPP('Mode.cpp'),
@@ -189,23 +208,41 @@ const show_meshes_names = [
 	maek.CPP('ShowMeshesMode.cpp')
 ];
 
+const show_scene_program_obj = maek.CPP('ShowSceneProgram.cpp'); //(also linked into a benchmark)
 const show_scene_names = [
 	maek.CPP('show-scene.cpp'),
-	maek.CPP('ShowSceneProgram.cpp'),
+	show_scene_program_obj,
 	maek.CPP('ShowSceneMode.cpp')
 ];
 
+const bake_names = [
+	maek.CPP('bake.cpp')
+];
+
 //the '[exeFile =] LINK(objFiles, exeFileBase, [, options])' links an array of objects into an executable:
 // objFiles: array of objects to link
 // exeFileBase: name of executable file to produce
 //returns exeFile: exeFileBase + a platform-dependant suffix (e.g., '.exe' on windows)
-const client_exe = maek.LINK([...client_names, ...common_names], 'dist/client');
+const client_exe = maek.LINK([...client_names, ...asset_names, ...common_names], 'dist/client');
 const server_exe = maek.LINK([...server_names, ...common_names], 'dist/server');
 const show_meshes_exe = maek.LINK([...show_meshes_names, ...common_names], 'scenes/show-meshes');
 const show_scene_exe = maek.LINK([...show_scene_names, ...common_names], 'scenes/show-scene');
+const bake_exe = maek.LINK([...bake_names, ...asset_names, ...common_names], 'scenes/bake');
+
+//benchmarks and fuzzers (run by hand; see README.md):
+const bench_window_obj = maek.CPP('bench_window.cpp'); //(OpenGL benchmarks only)
+const fuzz_messages_exe = maek.LINK([maek.CPP('fuzz-messages.cpp'), ...common_names], 'bench/fuzz-messages');
+const bench_messages_exe = maek.LINK([maek.CPP('bench-messages.cpp'), ...common_names], 'bench/bench-messages');
+const bench_loopback_exe = maek.LINK([maek.CPP('bench-loopback.cpp'), ...common_names], 'bench/bench-loopback');
+const bench_sprites_exe = maek.LINK([maek.CPP('bench-sprites.cpp'), bench_window_obj, sprite_renderer_obj, ...asset_names, ...common_names], 'bench/bench-sprites');
+const bench_scene_binds_exe = maek.LINK([maek.CPP('bench-scene-binds.cpp'), bench_window_obj, lit_color_texture_program_obj, ...common_names], 'bench/bench-scene-binds');
+const bench_instancing_exe = maek.LINK([maek.CPP('bench-instancing.cpp'), bench_window_obj, lit_color_texture_program_obj, show_scene_program_obj, ...common_names], 'bench/bench-instancing');
+const bench_png_exe = maek.LINK([maek.CPP('bench-png.cpp'), ...common_names], 'bench/bench-png');
+const bench_mixer_exe = maek.LINK([maek.CPP('bench-mixer.cpp'), mix_span_obj], 'bench/bench-mixer');
+const bench_exes = [fuzz_messages_exe, bench_messages_exe, bench_loopback_exe, bench_sprites_exe, bench_scene_binds_exe, bench_instancing_exe, bench_png_exe, bench_mixer_exe];
 
 //set the default target to the game (and copy the readme files):
-maek.TARGETS = [client_exe, server_exe, show_meshes_exe, show_scene_exe, ...copies];
+maek.TARGETS = [client_exe, server_exe, show_meshes_exe, show_scene_exe, bake_exe, ...bench_exes, ...copies];
 
 //Note that tasks that produce ':abstract targets' are never cached.
 // This is similar to how .PHONY targets behave in make.
@@ -0,0 +1,83 @@
+#include "MappedFile.hpp"
+
+#include <stdexcept>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(std::string const &filename) {
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Failed to open '" + filename + "' for mapping.");
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		CloseHandle(file);
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	size_ = size_t(size.QuadPart);
+	file_ = file;
+	if (size_ == 0) return; //(can't map an empty file; nothing to map anyway)
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL) {
+		CloseHandle(file);
+		throw std::runtime_error("Failed to map '" + filename + "'.");
+	}
+	void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == NULL) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		throw std::runtime_error("Failed to map view of '" + filename + "'.");
+	}
+	mapping_ = mapping;
+	data_ = static_cast< char const * >(view);
+}
+
+MappedFile::~MappedFile() {
+	if (data_) UnmapViewOfFile(data_);
+	if (mapping_) CloseHandle(mapping_);
+	if (file_) CloseHandle(file_);
+}
+
+#else
+
+MappedFile::MappedFile(std::string const &filename) {
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("Failed to open '" + filename + "' for mapping.");
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close(fd);
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	size_ = size_t(info.st_size);
+	if (size_ == 0) {
+		close(fd); //(can't map an empty file; nothing to map anyway)
+		return;
+	}
+
+	void *mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); //(the mapping keeps the file alive)
+	if (mapped == MAP_FAILED) {
+		throw std::runtime_error("Failed to map '" + filename + "'.");
+	}
+	//chunk files are read front-to-back:
+	madvise(mapped, size_, MADV_SEQUENTIAL);
+	data_ = static_cast< char const * >(mapped);
+}
+
+MappedFile::~MappedFile() {
+	if (data_) munmap(const_cast< char * >(data_), size_);
+}
+
+#endif
@@ -0,0 +1,36 @@
+#pragma once
+
+/*
+ * A MappedFile maps a whole file into memory (read-only) for as long as it exists.
+ *
+ * Compared to reading through a std::ifstream, nothing is copied: pages are brought in
+ * by the OS as they are touched, and (since they are backed by the file) don't count
+ * against the program's private memory. Useful for handing file data straight to
+ * OpenGL, or for reading chunks in place (see read_chunk_view in read_write_chunk.hpp).
+ *
+ * MappedFile file(data_path("level.pnct"));
+ * glBufferData(GL_ARRAY_BUFFER, file.size(), file.data(), GL_STATIC_DRAW);
+ */
+
+#include <string>
+#include <cstddef>
+
+struct MappedFile {
+	//map 'filename'; throws on failure:
+	explicit MappedFile(std::string const &filename);
+	~MappedFile();
+
+	MappedFile(MappedFile const &) = delete;
+	MappedFile &operator=(MappedFile const &) = delete;
+
+	char const *data() const { return data_; }
+	size_t size() const { return size_; }
+
+private:
+	char const *data_ = nullptr; //(nullptr for empty files)
+	size_t size_ = 0;
+#if defined(_WIN32)
+	void *file_ = nullptr; //HANDLEs
+	void *mapping_ = nullptr;
+#endif
+};
@@ -1,56 +1,149 @@
 #include "Mesh.hpp"
+#include "MappedFile.hpp"
 #include "read_write_chunk.hpp"
 
 #include <glm/glm.hpp>
 
 #include <stdexcept>
-#include <fstream>
 #include <iostream>
 #include <vector>
 #include <string>
 #include <set>
 #include <cstddef>
+#include <cstring>
 
 MeshBuffer::MeshBuffer(std::string const &filename) {
+	//the file is mapped rather than read, so vertex data goes straight from the page cache to OpenGL:
+	MappedFile mapped(filename);
+	load(mapped.data(), mapped.size(), filename);
+}
+
+MeshBuffer::MeshBuffer(char const *data, size_t size, std::string const &filename) {
+	load(data, size, filename);
+}
+
+void MeshBuffer::load(char const *bytes, size_t size, std::string const &filename) {
 	glGenBuffers(1, &buffer);
 
-	std::ifstream file(filename, std::ios::binary);
+	ChunkBytes file{ bytes, bytes + size };
 
-	GLuint total = 0;
+	//positions are the first attribute in both formats (used for mesh bounds):
+	ChunkBytes data; //(viewed in place)
+	size_t vertex_size = 0;
+	auto vertex_position = [&data,&vertex_size](uint32_t v) {
+		glm::vec3 position;
+		std::memcpy(&position, data.begin + size_t(v) * vertex_size, sizeof(position));
+		return position;
+	};
 
-	struct Vertex {
-		glm::vec3 Position;
-		glm::vec3 Normal;
-		glm::u8vec4 Color;
-		glm::vec2 TexCoord;
+	auto ends_with = [&filename](std::string const &suffix) {
+		return filename.size() >= suffix.size() && filename.substr(filename.size() - suffix.size()) == suffix;
 	};
-	static_assert(sizeof(Vertex) == 3*4+3*4+4*1+2*4, "Vertex is packed.");
-	std::vector< Vertex > data;
 
-	//read + upload data chunk:
-	if (filename.size() >= 5 && filename.substr(filename.size()-5) == ".pnct") {
-		read_chunk(file, "pnct", &data);
+	//indices (only for indexed files; also viewed in place):
+	ChunkBytes indices;
+	GLenum index_type = GL_NONE;
+	size_t index_size = 0;
 
-		//upload data:
-		glBindBuffer(GL_ARRAY_BUFFER, buffer);
-		glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(Vertex), data.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//read + upload data chunk:
+	if (ends_with(".pnct")) {
+		struct Vertex {
+			glm::vec3 Position;
+			glm::vec3 Normal;
+			glm::u8vec4 Color;
+			glm::vec2 TexCoord;
+		};
+		static_assert(sizeof(Vertex) == 3*4+3*4+4*1+2*4, "Vertex is packed.");
+		static_assert(offsetof(Vertex, Position) == 0, "Position comes first.");
+		vertex_size = sizeof(Vertex);
 
-		total = GLuint(data.size()); //store total for later checks on index
+		data = read_chunk_view(&file, "pnct", sizeof(Vertex));
 
 		//store attrib locations:
 		Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
 		Normal = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Normal));
 		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
 		TexCoord = Attrib(2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, TexCoord));
+	} else if (ends_with(".pnci")) {
+		struct Vertex {
+			glm::vec3 Position;
+			uint32_t Normal; //snorm 10:10:10 (and 2 unused bits)
+			glm::u8vec4 Color;
+			uint16_t TexCoord[2]; //half float
+		};
+		static_assert(sizeof(Vertex) == 3*4+4+4*1+2*2, "Vertex is packed.");
+		static_assert(offsetof(Vertex, Position) == 0, "Position comes first.");
+		vertex_size = sizeof(Vertex);
+
+		data = read_chunk_view(&file, "pnq0", sizeof(Vertex));
+
+		//index chunk is 16- or 32-bit, depending on how many vertices there are:
+		if (file.size() >= 4 && std::memcmp(file.begin, "ix16", 4) == 0) {
+			index_type = GL_UNSIGNED_SHORT;
+			index_size = sizeof(uint16_t);
+			indices = read_chunk_view(&file, "ix16", index_size);
+		} else {
+			index_type = GL_UNSIGNED_INT;
+			index_size = sizeof(uint32_t);
+			indices = read_chunk_view(&file, "ix32", index_size);
+		}
+
+		//store attrib locations:
+		// (the packed normal format needs size 4; shaders reading a vec3 just ignore w)
+		Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
+		Normal = Attrib(4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Normal));
+		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
+		TexCoord = Attrib(2, GL_HALF_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, TexCoord));
 	} else {
 		throw std::runtime_error("Unknown file type '" + filename + "'");
 	}
 
+	GLuint total = GLuint(data.size() / vertex_size); //store total for later checks on index
+
+	//check that indices don't point outside the vertex data (the GPU won't):
+	for (char const *i = indices.begin; i < indices.end; i += index_size) {
+		uint32_t index = 0;
+		if (index_type == GL_UNSIGNED_SHORT) {
+			uint16_t index16;
+			std::memcpy(&index16, i, sizeof(index16));
+			index = index16;
+		} else {
+			std::memcpy(&index, i, sizeof(index));
+		}
+		if (index >= total) {
+			throw std::runtime_error("mesh file '" + filename + "' has an out-of-range index");
+		}
+	}
+
+	//upload data:
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, data.size(), data.begin, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (index_type != GL_NONE) {
+		//(binding GL_ELEMENT_ARRAY_BUFFER with no vertex array bound would change whatever vertex array is)
+		glBindVertexArray(0);
+		glGenBuffers(1, &index_buffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size(), indices.begin, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+
 	std::vector< char > strings;
-	read_chunk(file, "str0", &strings);
+	read_chunk(&file, "str0", &strings);
+
+	auto add_mesh = [&](uint32_t name_begin, uint32_t name_end, Mesh const &mesh) {
+		if (!(name_begin <= name_end && name_end <= strings.size())) {
+			throw std::runtime_error("index entry has out-of-range name begin/end");
+		}
+		std::string name(strings.data() + name_begin, strings.data() + name_end);
+		bool inserted = meshes.insert(std::make_pair(name, mesh)).second;
+		if (!inserted) {
+			std::cerr << "WARNING: mesh name '" + name + "' in filename '" + filename + "' collides with existing mesh." << std::endl;
+		}
+	};
 
-	{ //read index chunk, add to meshes:
+	if (index_type == GL_NONE) { //read index chunk, add to meshes:
 		struct IndexEntry {
 			uint32_t name_begin, name_end;
 			uint32_t vertex_begin, vertex_end;
@@ -58,32 +151,56 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
 
 		std::vector< IndexEntry > index;
-		read_chunk(file, "idx0", &index);
+		read_chunk(&file, "idx0", &index);
 
 		for (auto const &entry : index) {
-			if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
-				throw std::runtime_error("index entry has out-of-range name begin/end");
-			}
 			if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= total)) {
 				throw std::runtime_error("index entry has out-of-range vertex start/count");
 			}
-			std::string name(&strings[0] + entry.name_begin, &strings[0] + entry.name_end);
 			Mesh mesh;
 			mesh.type = GL_TRIANGLES;
 			mesh.start = entry.vertex_begin;
 			mesh.count = entry.vertex_end - entry.vertex_begin;
 			for (uint32_t v = entry.vertex_begin; v < entry.vertex_end; ++v) {
-				mesh.min = glm::min(mesh.min, data[v].Position);
-				mesh.max = glm::max(mesh.max, data[v].Position);
+				glm::vec3 position = vertex_position(v);
+				mesh.min = glm::min(mesh.min, position);
+				mesh.max = glm::max(mesh.max, position);
 			}
-			bool inserted = meshes.insert(std::make_pair(name, mesh)).second;
-			if (!inserted) {
-				std::cerr << "WARNING: mesh name '" + name + "' in filename '" + filename + "' collides with existing mesh." << std::endl;
+			add_mesh(entry.name_begin, entry.name_end, mesh);
+		}
+	} else { //indexed meshes also record the vertices they use (for bounds):
+		struct IndexEntry {
+			uint32_t name_begin, name_end;
+			uint32_t index_begin, index_end;
+			uint32_t vertex_begin, vertex_end;
+		};
+		static_assert(sizeof(IndexEntry) == 24, "Index entry should be packed");
+
+		std::vector< IndexEntry > index;
+		read_chunk(&file, "idx1", &index);
+
+		for (auto const &entry : index) {
+			if (!(entry.index_begin <= entry.index_end && entry.index_end <= indices.size() / index_size)) {
+				throw std::runtime_error("index entry has out-of-range index start/count");
+			}
+			if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= total)) {
+				throw std::runtime_error("index entry has out-of-range vertex start/count");
+			}
+			Mesh mesh;
+			mesh.type = GL_TRIANGLES;
+			mesh.start = entry.index_begin;
+			mesh.count = entry.index_end - entry.index_begin;
+			mesh.index_type = index_type;
+			for (uint32_t v = entry.vertex_begin; v < entry.vertex_end; ++v) {
+				glm::vec3 position = vertex_position(v);
+				mesh.min = glm::min(mesh.min, position);
+				mesh.max = glm::max(mesh.max, position);
 			}
+			add_mesh(entry.name_begin, entry.name_end, mesh);
 		}
 	}
 
-	if (file.peek() != EOF) {
+	if (!file.empty()) {
 		std::cerr << "WARNING: trailing data in mesh file '" << filename << "'" << std::endl;
 	}
 
@@ -128,6 +245,8 @@ GLuint MeshBuffer::make_vao_for_program(GLuint program) const {
 	bind_attribute("Color", Color);
 	bind_attribute("TexCoord", TexCoord);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//element buffer binding is part of the vertex array object's state:
+	if (index_buffer) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
 	glBindVertexArray(0);
 
 	//Check that all active attributes were bound:
@@ -7,6 +7,12 @@
  *  a single OpenGL array buffer. Individual meshes can be looked up by name
  *  using the MeshBuffer::lookup() function.
  *
+ * MeshBuffers load either:
+ *  '.pnct' files -- triangle soup with full-float attributes (drawn with glDrawArrays)
+ *  '.pnci' files -- indexed, de-duplicated, vertex-cache-ordered meshes with quantized
+ *     normals (snorm 10:10:10) and texture coordinates (half float), drawn with glDrawElements
+ *     (made from '.pnct' files by scenes/index-meshes.py)
+ *
  */
 
 #include "GL.hpp"
@@ -18,10 +24,12 @@
 
 struct Mesh {
 	//Meshes are vertex ranges (and primitive types) in their MeshBuffer:
+	// ...or, for indexed meshes, ranges of the MeshBuffer's index buffer.
 
 	GLenum type = GL_TRIANGLES; //type of primitives in mesh
-	GLuint start = 0; //index of first vertex
-	GLuint count = 0; //count of vertices
+	GLuint start = 0; //index of first vertex (or of first index, if indexed)
+	GLuint count = 0; //count of vertices (or of indices, if indexed)
+	GLenum index_type = GL_NONE; //type of indices (e.g., GL_UNSIGNED_SHORT) if indexed; GL_NONE if not
 
 	//Bounding box.
 	//useful for debug visualization and (perhaps, eventually) collision detection:
@@ -33,6 +41,8 @@ struct MeshBuffer {
 	//construct from a file:
 	// note: will throw if file fails to read.
 	MeshBuffer(std::string const &filename);
+	//construct from file contents already in memory (e.g. a Pack entry); 'filename' picks the format, as above:
+	MeshBuffer(char const *data, size_t size, std::string const &filename);
 
 	//look up a particular mesh by name:
 	// note: will throw if mesh not found.
@@ -45,8 +55,15 @@ struct MeshBuffer {
 	//This is the OpenGL vertex buffer object containing the mesh data:
 	GLuint buffer = 0;
 
+	//(indexed files only) the OpenGL element buffer holding the meshes' indices:
+	// make_vao_for_program binds this to the vertex array object, so draws can use glDrawElements
+	GLuint index_buffer = 0;
+
 	//-- internals ---
 
+	//used by the constructors:
+	void load(char const *data, size_t size, std::string const &filename);
+
 	//used by the lookup() function:
 	std::map< std::string, Mesh > meshes;
 
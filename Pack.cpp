@@ -0,0 +1,159 @@
+#include "Pack.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <cassert>
+#include <cstdint>
+
+namespace {
+	struct TocEntry {
+		uint32_t name_begin, name_end;
+		char type[4];
+		uint32_t offset, size;
+	};
+	static_assert(sizeof(TocEntry) == 4 + 4 + 4 + 4 + 4, "TocEntry is packed.");
+
+	//entry data starts on this boundary (so e.g. float audio can be used in place):
+	constexpr size_t PackAlignment = 16;
+}
+
+Pack::Pack(std::string const &filename) : file(filename) {
+	ChunkBytes from{ file.data(), file.data() + file.size() };
+
+	std::vector< TocEntry > toc;
+	read_chunk(&from, "toc0", &toc);
+
+	std::vector< char > names;
+	read_chunk(&from, "str0", &names);
+
+	ChunkBytes data = read_chunk_view(&from, "dat0", 1);
+
+	if (!from.empty()) {
+		throw std::runtime_error("Pack '" + filename + "' has trailing data.");
+	}
+
+	entries.reserve(toc.size());
+	for (auto const &t : toc) {
+		if (!(t.name_begin <= t.name_end && t.name_end <= names.size())) {
+			throw std::runtime_error("Pack '" + filename + "' has an entry with an out-of-range name.");
+		}
+		if (!(t.offset <= data.size() && t.size <= data.size() - t.offset)) {
+			throw std::runtime_error("Pack '" + filename + "' has an entry with out-of-range data.");
+		}
+		std::string name(names.data() + t.name_begin, names.data() + t.name_end);
+		Entry entry;
+		std::memcpy(entry.type, t.type, 4);
+		entry.data.begin = data.begin + t.offset;
+		entry.data.end = entry.data.begin + t.size;
+		if (!entries.emplace(name, entry).second) {
+			throw std::runtime_error("Pack '" + filename + "' has two entries named '" + name + "'.");
+		}
+	}
+}
+
+Pack::Entry const *Pack::find(std::string const &name, char const *type) const {
+	auto f = entries.find(name);
+	if (f == entries.end()) return nullptr;
+	if (type && std::memcmp(f->second.type, type, 4) != 0) return nullptr;
+	return &f->second;
+}
+
+Pack::Entry const &Pack::lookup(std::string const &name, char const *type) const {
+	Entry const *entry = find(name, type);
+	if (!entry) {
+		throw std::runtime_error("Pack has no entry '" + name + "'" + (type ? " of type '" + std::string(type, 4) + "'" : std::string()) + ".");
+	}
+	return *entry;
+}
+
+Pack::Image Pack::image(std::string const &name) const {
+	ChunkBytes data = lookup(name, "rgba").data;
+	Image image;
+	if (data.size() < 2 * sizeof(uint32_t)) {
+		throw std::runtime_error("Pack image '" + name + "' is too short.");
+	}
+	uint32_t size[2];
+	std::memcpy(size, data.begin, sizeof(size));
+	image.size = glm::uvec2(size[0], size[1]);
+	if (data.size() - sizeof(size) != size_t(image.size.x) * size_t(image.size.y) * sizeof(glm::u8vec4)) {
+		throw std::runtime_error("Pack image '" + name + "' has the wrong number of pixels.");
+	}
+	static_assert(alignof(glm::u8vec4) == 1, "pixels can be used unaligned");
+	image.pixels = reinterpret_cast< glm::u8vec4 const * >(data.begin + sizeof(size));
+	return image;
+}
+
+Pack::Audio Pack::audio(std::string const &name) const {
+	ChunkBytes data = lookup(name, "f32m").data;
+	if (data.size() % sizeof(float) != 0) {
+		throw std::runtime_error("Pack audio '" + name + "' isn't a whole number of samples.");
+	}
+	static_assert(PackAlignment % alignof(float) == 0, "aligned entries can be read as floats");
+	if (reinterpret_cast< uintptr_t >(data.begin) % alignof(float) != 0) {
+		throw std::runtime_error("Pack audio '" + name + "' isn't aligned.");
+	}
+	Audio audio;
+	audio.count = data.size() / sizeof(float);
+	audio.samples = reinterpret_cast< float const * >(data.begin);
+	return audio;
+}
+
+//------------------------------------------
+
+void PackWriter::add(std::string const &name, char const type[4], std::vector< char > &&data) {
+	added.emplace_back();
+	added.back().name = name;
+	std::memcpy(added.back().type, type, 4);
+	added.back().data = std::move(data);
+}
+
+void PackWriter::add_image(std::string const &name, glm::uvec2 size, std::vector< glm::u8vec4 > const &pixels) {
+	assert(pixels.size() == size_t(size.x) * size_t(size.y));
+	uint32_t header[2] = { size.x, size.y };
+	std::vector< char > data(sizeof(header) + pixels.size() * sizeof(glm::u8vec4));
+	std::memcpy(data.data(), header, sizeof(header));
+	if (!pixels.empty()) std::memcpy(data.data() + sizeof(header), pixels.data(), pixels.size() * sizeof(glm::u8vec4));
+	add(name, "rgba", std::move(data));
+}
+
+void PackWriter::add_audio(std::string const &name, std::vector< float > const &samples) {
+	std::vector< char > data(samples.size() * sizeof(float));
+	if (!samples.empty()) std::memcpy(data.data(), samples.data(), data.size());
+	add(name, "f32m", std::move(data));
+}
+
+void PackWriter::write(std::string const &filename) const {
+	std::vector< TocEntry > toc;
+	std::vector< char > names;
+	toc.reserve(added.size());
+	for (auto const &a : added) {
+		toc.emplace_back();
+		toc.back().name_begin = uint32_t(names.size());
+		names.insert(names.end(), a.name.begin(), a.name.end());
+		toc.back().name_end = uint32_t(names.size());
+		std::memcpy(toc.back().type, a.type, 4);
+	}
+
+	//lay out the data, aligning each entry relative to the start of the file:
+	size_t data_start = 8 + toc.size() * sizeof(TocEntry) + 8 + names.size() + 8; //(three chunk headers)
+	std::vector< char > data;
+	for (size_t i = 0; i < added.size(); ++i) {
+		size_t at = data_start + data.size();
+		data.resize(data.size() + (PackAlignment - at % PackAlignment) % PackAlignment, '\0');
+		if (data.size() + added[i].data.size() > 0xffffffff) {
+			throw std::runtime_error("Pack '" + filename + "' would be too big.");
+		}
+		toc[i].offset = uint32_t(data.size());
+		toc[i].size = uint32_t(added[i].data.size());
+		data.insert(data.end(), added[i].data.begin(), added[i].data.end());
+	}
+
+	std::ofstream out(filename, std::ios::binary);
+	write_chunk("toc0", toc, &out);
+	write_chunk("str0", names, &out);
+	write_chunk("dat0", data, &out);
+	if (!out) {
+		throw std::runtime_error("Failed to write pack '" + filename + "'.");
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+/*
+ * A Pack is a single file holding many assets, already converted to the form the game
+ * uses at runtime (decoded pixels, decoded audio, pre-rasterized glyphs, ...), so that
+ * loading is just looking things up in one mapped file.
+ *
+ * Packs are made by the 'bake' tool (see bake.cpp) from the contents of dist/:
+ *   scenes/bake dist dist/assets.pack
+ *
+ * Pack pack(data_path("assets.pack"));
+ * Pack::Image image = pack.image("player1.png");
+ * ...upload image.size / image.pixels...
+ *
+ * Entries are named by their path relative to the baked directory and have a type:
+ *  'rgba' -- uint32 width, uint32 height, then width*height RGBA8 pixels, bottom row first (see image())
+ *  'f32m' -- 48kHz mono float samples, decoded from a '.wav' (see audio() and Sound::Sample)
+ *  'glyf' -- a TextRenderer glyph atlas (see TextRenderer::load_glyphs)
+ *  'file' -- a copy of the original file (fonts, meshes, scenes, '.opus' audio, ...)
+ *
+ * File layout (using the chunks from read_write_chunk.hpp):
+ *  'toc0' chunk: entries of uint32 name_begin, name_end, char type[4], uint32 offset, size
+ *  'str0' chunk: entry names
+ *  'dat0' chunk: entry data; offsets are relative to the start of this chunk's data,
+ *     and entries start on 16-byte boundaries (relative to the start of the file)
+ */
+
+#include "MappedFile.hpp"
+#include "read_write_chunk.hpp"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Pack {
+	//map and index a pack file; throws on failure:
+	explicit Pack(std::string const &filename);
+
+	//an entry's contents (valid as long as the Pack):
+	struct Entry {
+		char type[4];
+		ChunkBytes data;
+	};
+
+	//look up an entry; returns nullptr if there is no entry with this name (and type, if given):
+	Entry const *find(std::string const &name, char const *type = nullptr) const;
+
+	//same as find(), but throws if not found:
+	Entry const &lookup(std::string const &name, char const *type = nullptr) const;
+
+	//'rgba' entries:
+	struct Image {
+		glm::uvec2 size = glm::uvec2(0);
+		glm::u8vec4 const *pixels = nullptr; //(points into the pack)
+	};
+	Image image(std::string const &name) const;
+
+	//'f32m' entries:
+	struct Audio {
+		size_t count = 0;
+		float const *samples = nullptr; //(points into the pack)
+	};
+	Audio audio(std::string const &name) const;
+
+	//internals:
+	MappedFile file;
+	std::unordered_map< std::string, Entry > entries;
+};
+
+//PackWriter builds a pack file (used by the 'bake' tool):
+struct PackWriter {
+	void add(std::string const &name, char const type[4], std::vector< char > &&data);
+	void add_image(std::string const &name, glm::uvec2 size, std::vector< glm::u8vec4 > const &pixels);
+	void add_audio(std::string const &name, std::vector< float > const &samples);
+
+	//write everything added so far to 'filename'; throws on failure:
+	void write(std::string const &filename) const;
+
+	struct Added {
+		std::string name;
+		char type[4];
+		std::vector< char > data;
+	};
+	std::vector< Added > added;
+};
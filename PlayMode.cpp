@@ -6,6 +6,9 @@
 #include "hex_dump.hpp"
 #include "GL.hpp"
 #include "load_save_png.hpp"
+#include "Load.hpp"
+#include "MappedFile.hpp"
+#include "Pack.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 #define GLM_ENABLE_EXPERIMENTAL
@@ -18,24 +21,35 @@
 #include <vector>
 #include <cmath>
 #include <limits>
+#include <filesystem>
+#include <memory>
 
 #include "TextRenderer.hpp"
 #include "SpriteRenderer.hpp"
+#include "Widgets.hpp"
 
 // -------------------- file-scope singletons & state --------------------
+// assets baked into one file by scenes/bake (see Pack.hpp); null if there's no pack, in which case assets load from their own files.
+// (declared before g_text so it is destroyed after it: the font reads from the pack for as long as g_text exists)
+static std::unique_ptr< Pack const > g_pack;
+
 static TextRenderer g_text;
 static SpriteRenderer g_sprites;
 
-static GLuint g_tex_p1 = 0;
-static GLuint g_tex_p2 = 0;
-static GLuint g_tex_white = 0;
+// (all packed into g_sprites' atlas, so the whole board + HUD draws in one batch)
+static SpriteRenderer::Sprite g_tex_p1;
+static SpriteRenderer::Sprite g_tex_p2;
+static SpriteRenderer::Sprite g_tex_white;
 static glm::vec2 g_tex_p1_size(1.0f);
 static glm::vec2 g_tex_p2_size(1.0f);
 
 // action icons:
-static GLuint g_tex_attack = 0;
-static GLuint g_tex_defend = 0;
-static GLuint g_tex_parry  = 0;
+static SpriteRenderer::Sprite g_tex_attack;
+static SpriteRenderer::Sprite g_tex_defend;
+static SpriteRenderer::Sprite g_tex_parry;
+
+// sprite draw order (lower layers first):
+enum SpriteLayer : uint32_t { Layer_Board = 0, Layer_Players = 1, Layer_FX = 2, Layer_HUD = 3 };
 
 // per-player caches to infer facing from movement:
 static std::vector< glm::vec2 > g_prev_positions; // last world pos
@@ -46,6 +60,10 @@ static Button g_attack; // J
 static Button g_defend; // K
 static Button g_parry;  // L
 
+// upstream input pacing (see PlayMode::update):
+static float   g_input_send_timer = 0.0f; // seconds since last C2S_Input frame
+static uint8_t g_input_sent_held  = 0;    // 'pressed' bits in the last C2S_Input frame
+
 // local cooldown timers (seconds). Server doesn’t broadcast these yet:
 static double g_now = 0.0;
 static double g_last_atk = -1e9, g_last_def = -1e9, g_last_par = -1e9;
@@ -57,24 +75,29 @@ static constexpr double PAR_CD = 5.0;
 struct ActionFX {
 	glm::vec2 pos = glm::vec2(0.0f); // world position to draw
 	float     rot = 0.0f;            // radians
-	GLuint    tex = 0;               // which icon
+	SpriteRenderer::Sprite tex;      // which icon
 	float     t   = 0.0f;            // life elapsed
 	float     life= 0.35f;           // total lifetime
 };
 static std::vector<ActionFX> g_fx;
 
-// -------------------- helpers --------------------
-static inline bool parse_message(std::vector<uint8_t>& buf, uint8_t& out_type, std::vector<uint8_t>& out_payload) {
-	if (buf.size() < 2) return false;
-	uint8_t type = buf[0];
-	uint8_t len  = buf[1];
-	if (buf.size() < 2u + len) return false;
-	out_type = type;
-	out_payload.assign(buf.begin() + 2, buf.begin() + 2 + len);
-	buf.erase(buf.begin(), buf.begin() + 2 + len);
-	return true;
-}
+// retained HUD (see Widgets.hpp); PlayMode::draw only pokes the values that change:
+struct Hud {
+	WidgetTree tree;
+	IconWidget  *you_icon = nullptr,   *enemy_icon = nullptr;
+	LabelWidget *you_hearts = nullptr, *enemy_hearts = nullptr;
+	int shown_local_hp = -1, shown_enemy_hp = -1;
+
+	struct Cooldown {
+		const char  *name = "";
+		LabelWidget *label = nullptr;
+		BarWidget   *bar = nullptr;
+		int shown_tenths = -1; // tenths of a second left, as currently displayed
+	} atk, def, par;
+};
+static Hud g_hud;
 
+// -------------------- helpers --------------------
 static std::string make_hearts(int hp) {
 	static const char* HEART = "\xE2\x99\xA5"; // UTF-8 '♥'
 	std::string s;
@@ -82,44 +105,73 @@ static std::string make_hearts(int hp) {
 	return s;
 }
 
-static float length2(glm::vec2 v) { return v.x * v.x + v.y * v.y; }
-static float signf(float x) { return (x > 0.0f ? 1.0f : (x < 0.0f ? -1.0f : 0.0f)); }
-
-// load a PNG into GL texture; return GL id and optionally size:
-static GLuint load_texture_png(const std::string& path, glm::vec2* out_size = nullptr) {
-	GLuint tex = 0;
+// lay out the HUD widgets (panels sit left and right of the board):
+static void build_hud() {
+	Hud &hud = g_hud;
+	hud.tree.root.clear_children();
+	glm::vec2 icon_sz = glm::vec2(Game::PlayerRadius * 2.4f);
+
+	Widget *left = hud.tree.root.add< Widget >(glm::vec2(-1.75f, 0.82f));
+	left->add< LabelWidget >(glm::vec2(0.0f), 0.08f, glm::vec4(1,1,1,1), "You Are");
+	hud.you_icon = left->add< IconWidget >(glm::vec2(0.60f, 0.01f), icon_sz); // slightly to the right of text baseline
+	hud.you_hearts = left->add< LabelWidget >(glm::vec2(0.0f, -0.12f), 0.12f, glm::vec4(1,0.4f,0.4f,1));
+	left->add< LabelWidget >(glm::vec2(0.0f, -0.24f), 0.08f, glm::vec4(1,1,1,1), "Move [W/S/A/D]");
+
+	// ability icons + cooldown text + cooldown bar, one row each:
+	auto add_cd = [&](Hud::Cooldown &cd, glm::vec2 row, const char *name, SpriteRenderer::Sprite const &tex) {
+		Widget *at = left->add< Widget >(row);
+		at->add< IconWidget >(glm::vec2(0.0f), icon_sz, tex);
+		cd.name = name;
+		cd.label = at->add< LabelWidget >(glm::vec2(0.10f, -0.03f), 0.07f, glm::vec4(1,1,1,1));
+		cd.bar = at->add< BarWidget >(glm::vec2(0.10f, -0.065f), glm::vec2(0.45f, 0.01f), g_tex_white,
+			glm::vec4(1,1,1,0.7f), glm::vec4(1,1,1,0.15f));
+		cd.shown_tenths = -1;
+	};
+	add_cd(hud.atk, glm::vec2(0.02f, -0.34f), "Attack [J]", g_tex_attack);
+	add_cd(hud.def, glm::vec2(0.02f, -0.46f), "Defend [K]", g_tex_defend);
+	add_cd(hud.par, glm::vec2(0.02f, -0.58f), "Parry  [L]", g_tex_parry);
 
-	glm::uvec2 size(0);
-	std::vector< glm::u8vec4 > data;
-	load_png(path, &size, &data, LowerLeftOrigin);
+	Widget *right = hud.tree.root.add< Widget >(glm::vec2(1.25f, 0.82f));
+	right->add< LabelWidget >(glm::vec2(0.0f), 0.08f, glm::vec4(1,1,1,1), "Enemy is");
+	hud.enemy_icon = right->add< IconWidget >(glm::vec2(0.50f, 0.01f), icon_sz); // to the right of "Enemy is"
+	hud.enemy_hearts = right->add< LabelWidget >(glm::vec2(0.0f, -0.12f), 0.12f, glm::vec4(1,0.4f,0.4f,1));
 
-	glGenTextures(1, &tex);
-	glBindTexture(GL_TEXTURE_2D, tex);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, GLsizei(size.x), GLsizei(size.y), 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
-	glBindTexture(GL_TEXTURE_2D, 0);
+	hud.shown_local_hp = hud.shown_enemy_hp = -1;
+}
 
-	if (out_size) *out_size = glm::vec2(size);
+static float length2(glm::vec2 v) { return v.x * v.x + v.y * v.y; }
+static float signf(float x) { return (x > 0.0f ? 1.0f : (x < 0.0f ? -1.0f : 0.0f)); }
 
-	return tex;
+// a PNG decoded (on a loader thread), waiting to go into the sprite atlas:
+// (already laid out as SpriteRenderer::add_padded_image wants it, so the main thread just uploads it)
+struct DecodedPNG {
+	glm::uvec2 size = glm::uvec2(0);
+	std::vector< glm::u8vec4 > padded; //(size.x + 2) x (size.y + 2), image at (1,1)
+};
+static DecodedPNG decode_png(const std::string& name) {
+	DecodedPNG png;
+	auto destination = [&png](glm::uvec2 size) {
+		png.size = size;
+		png.padded.resize(size_t(size.x + 2) * (size.y + 2));
+		return PNGDestination{ png.padded.data() + size.x + 2 + 1, size.x + 2 };
+	};
+	if (g_pack && g_pack->find(name, "rgba")) {
+		// already decoded by the bake tool:
+		Pack::Image image = g_pack->image(name);
+		PNGDestination to = destination(image.size);
+		for (uint32_t y = 0; y < image.size.y; ++y) {
+			std::copy(image.pixels + size_t(y) * image.size.x, image.pixels + size_t(y + 1) * image.size.x, to.pixels + y * to.stride);
+		}
+	} else {
+		MappedFile file(data_path(name));
+		load_png(file.data(), file.size(), destination, LowerLeftOrigin);
+	}
+	return png;
 }
 
-static GLuint create_white_texture() {
-	GLuint tex = 0;
-	glGenTextures(1, &tex);
-	glBindTexture(GL_TEXTURE_2D, tex);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	uint32_t px = 0xffffffffu;
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &px);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	return tex;
+static SpriteRenderer::Sprite create_white_sprite() {
+	glm::u8vec4 px(0xff);
+	return g_sprites.add_image(glm::uvec2(1), &px);
 }
 
 // convert a facing axis to radians (attack.png faces UP by default)
@@ -130,23 +182,70 @@ static float facing_to_rot(glm::vec2 facing) {
 	return  3.1415926f;                               // down  -> 180
 }
 
-// -------------------- PlayMode --------------------
-PlayMode::PlayMode(Client &client_) : client(client_) {
-	// init text + sprites
-	g_text.init("fonts/Font.ttf", 42); // use dist/fonts/Font.ttf
-	g_sprites.init();
+// -------------------- assets --------------------
+// (call_load_functions() decodes these on worker threads; only the atlas / GL work happens on the main thread)
 
-	// load arrow textures (right-facing by default in image)
-	g_tex_p1 = load_texture_png(data_path("player1.png"), &g_tex_p1_size);
-	g_tex_p2 = load_texture_png(data_path("player2.png"), &g_tex_p2_size);
+// the pack (Early, and before any load that reads from it):
+static Load< void > load_pack(LoadTagEarly, [](){
+	std::string path = data_path("assets.pack");
+	if (std::filesystem::exists(path)) g_pack = std::make_unique< Pack const >(path);
+});
 
-	// action icons:
-	g_tex_attack = load_texture_png(data_path("attack.png"));
-	g_tex_defend = load_texture_png(data_path("defend.png"));
-	g_tex_parry  = load_texture_png(data_path("parry.png"));
+// sprite renderer + 1x1 white (Early, so the atlas exists before any image is added):
+static Load< void > load_sprites(LoadTagEarly, [](){
+	g_sprites.init();
+	g_tex_white = create_white_sprite();
+});
+
+// arrow textures (right-facing by default in image):
+static Load< void > load_p1(LoadTagDefault, [](){ return decode_png("player1.png"); }, [](DecodedPNG &&png){
+	g_tex_p1_size = glm::vec2(png.size);
+	g_tex_p1 = g_sprites.add_padded_image(png.size, png.padded.data());
+}, { load_pack.id });
+static Load< void > load_p2(LoadTagDefault, [](){ return decode_png("player2.png"); }, [](DecodedPNG &&png){
+	g_tex_p2_size = glm::vec2(png.size);
+	g_tex_p2 = g_sprites.add_padded_image(png.size, png.padded.data());
+}, { load_pack.id });
 
-	// 1x1 white
-	g_tex_white = create_white_texture();
+// action icons:
+static Load< void > load_attack(LoadTagDefault, [](){ return decode_png("attack.png"); }, [](DecodedPNG &&png){
+	g_tex_attack = g_sprites.add_padded_image(png.size, png.padded.data());
+}, { load_pack.id });
+static Load< void > load_defend(LoadTagDefault, [](){ return decode_png("defend.png"); }, [](DecodedPNG &&png){
+	g_tex_defend = g_sprites.add_padded_image(png.size, png.padded.data());
+}, { load_pack.id });
+static Load< void > load_parry(LoadTagDefault, [](){ return decode_png("parry.png"); }, [](DecodedPNG &&png){
+	g_tex_parry = g_sprites.add_padded_image(png.size, png.padded.data());
+}, { load_pack.id });
+
+// font: opening it and rasterizing the HUD's characters (SDF rendering is the slow part) happens off the main thread:
+// (with a pack, the characters come pre-rasterized; scenes/bake's BakedFonts should match the font + size + mode here)
+static Load< void > load_text(LoadTagDefault, [](){
+	std::string const font = "fonts/Font.ttf"; // use dist/fonts/Font.ttf (SDF: crisp at every size we draw)
+	int const pixel_height = 32;
+	TextRenderer::Mode const mode = TextRenderer::Mode::SDF;
+
+	std::string ascii;
+	for (char c = ' '; c <= '~'; ++c) ascii += c;
+
+	Pack::Entry const *file = (g_pack ? g_pack->find(font, "file") : nullptr);
+	Pack::Entry const *glyphs = (g_pack ? g_pack->find(TextRenderer::baked_glyphs_name(font, pixel_height, mode), "glyf") : nullptr);
+	if (file && glyphs) {
+		g_text.load_font_data(file->data.begin, file->data.size(), pixel_height, mode);
+		if (!g_text.load_glyphs(glyphs->data.begin, glyphs->data.size())) {
+			std::cerr << "WARNING: baked glyphs for '" << font << "' don't match; rasterizing them as needed instead." << std::endl;
+		}
+	} else {
+		g_text.load_font(font, pixel_height, mode, ascii);
+	}
+}, [](){
+	g_text.init_gl();
+}, { load_pack.id });
+
+// -------------------- PlayMode --------------------
+PlayMode::PlayMode(Client &client_) : client(client_) {
+	// (text + sprites were set up by the loads above)
+	build_hud();
 
 	// clear caches
 	g_prev_positions.clear();
@@ -156,6 +255,9 @@ PlayMode::PlayMode(Client &client_) : client(client_) {
 	g_now = 0.0;
 	g_last_atk = g_last_def = g_last_par = -1e9;
 	g_fx.clear();
+
+	g_input_send_timer = 0.0f;
+	g_input_sent_held = 0;
 }
 
 PlayMode::~PlayMode() { }
@@ -201,11 +303,8 @@ void PlayMode::update(float elapsed) {
 	// advance local clock (used for cooldown display)
 	g_now += double(elapsed);
 
-	// send movement/ready to server (5-byte protocol)
-	controls.send_controls_message(&client.connection);
-
 	// local FX spawn helper
-	auto spawn_self_fx = [&](GLuint tex, float rot, glm::vec2 world_pos){
+	auto spawn_self_fx = [&](SpriteRenderer::Sprite const &tex, float rot, glm::vec2 world_pos){
 		ActionFX fx;
 		fx.pos = world_pos;
 		fx.rot = rot;
@@ -246,26 +345,39 @@ void PlayMode::update(float elapsed) {
 		}
 	}
 
-	auto send_action = [&](uint8_t mask){
-		client.connection.send(Message::C2S_Action);  // frame type
-		client.connection.send(uint8_t(1));           // size low  (1)
-		client.connection.send(uint8_t(0));           // size mid  (0)
-		client.connection.send(uint8_t(0));           // size high (0)
-		client.connection.send(uint8_t(mask));        // payload: bit0=attack, bit1=defend, bit2=parry
-	};
-
+	// send movement/ready + actions to server as one C2S_Input frame per send interval.
+	// presses skip the wait and go out right away (client.poll below flushes them this frame):
 	{
 		uint8_t mask = 0;
 		if (g_attack.downs) mask |= Action_Attack;
 		if (g_defend.downs) mask |= Action_Defend;
 		if (g_parry.downs)  mask |= Action_Parry;
-		if (mask) send_action(mask);
+
+		bool pressed_something = mask
+			|| controls.left.downs || controls.right.downs
+			|| controls.up.downs || controls.down.downs
+			|| controls.jump.downs;
+		uint8_t held = uint8_t(
+			  (controls.left.pressed  ? 0x01 : 0x00)
+			| (controls.right.pressed ? 0x02 : 0x00)
+			| (controls.up.pressed    ? 0x04 : 0x00)
+			| (controls.down.pressed  ? 0x08 : 0x00)
+			| (controls.jump.pressed  ? 0x10 : 0x00)
+		);
+
+		g_input_send_timer += elapsed;
+		if (pressed_something || held != g_input_sent_held || g_input_send_timer >= Game::Tick) {
+			uint32_t tick = uint32_t(g_now / double(Game::Tick));
+			controls.send_controls_message(&client.connection, tick, mask);
+			g_input_sent_held = held;
+			g_input_send_timer = 0.0f;
+		}
 	}
 
 	// reset local-only action counters
 	g_attack.downs = 0; g_defend.downs = 0; g_parry.downs = 0;
 
-	// reset press counters for movement/ready (client-side)
+	// reset press counters for movement/ready (client-side; any downs were just sent)
 	controls.left.downs = controls.right.downs = 0;
 	controls.up.downs = controls.down.downs = 0;
 	controls.jump.downs = 0;
@@ -286,19 +398,19 @@ void PlayMode::update(float elapsed) {
 				do {
 					handled_message = false;
 					if (game.recv_state_message(c)) { handled_message = true; continue; }
-					uint8_t type; std::vector<uint8_t> payload;
-					while (parse_message(c->recv_buffer, type, payload)) {
-						handled_message = true;
-						switch (type) {
-							case 'F': {
-								std::string text(payload.begin(), payload.end());
-								std::cerr << "[Server] " << text << "\n";
-								throw std::runtime_error("Server says: " + text);
-							} break;
-							default: break;
-						}
+					S2C_FailMessage fail;
+					if (recv_frame(&c->recv_buffer, &fail)) {
+						std::string text(fail.text.view());
+						std::cerr << "[Server] " << text << "\n";
+						throw std::runtime_error("Server says: " + text);
 					}
 				} while (handled_message);
+				uint8_t type = 0;
+				uint32_t size = 0;
+				if (peek_frame(c->recv_buffer.data(), c->recv_buffer.size(), &type, &size)
+				 && type != uint8_t(Message::S2C_State) && type != uint8_t(Message::S2C_Fail)) {
+					throw std::runtime_error("Unknown message type " + std::to_string(int(type)));
+				}
 			} catch (std::exception const &e) {
 				std::cerr << "[" << c->socket << "] malformed message from server: " << e.what() << std::endl;
 				throw;
@@ -425,11 +537,14 @@ void PlayMode::draw(glm::uvec2 const &drawable_size) {
 	}
 
 	// ---------------- Playing ----------------
+	// board sprites are queued below and drawn together by one flush() before the HUD.
+	g_sprites.begin(world_to_clip);
+
 	// draw arena background (quad)
 	auto draw_rect = [&](glm::vec2 minP, glm::vec2 maxP, glm::vec4 color){
 		glm::vec2 center = 0.5f * (minP + maxP);
 		glm::vec2 size   = maxP - minP;
-		g_sprites.draw(world_to_clip, g_tex_white, center, size, 0.0f, color);
+		g_sprites.submit(g_tex_white, center, size, 0.0f, color, Layer_Board);
 	};
 
 	draw_rect(Game::ArenaMin, Game::ArenaMax, glm::vec4(0.08f,0.08f,0.08f,1.0f));
@@ -462,7 +577,7 @@ void PlayMode::draw(glm::uvec2 const &drawable_size) {
 
 			// Use a server-stable mapping so both clients see the same colors.
 			// Parse trailing number from "Player N": N==1 -> P1 texture, else -> P2 texture.
-			auto choose_texture = [&](const Player &pp)->GLuint {
+			auto choose_texture = [&](const Player &pp)->SpriteRenderer::Sprite const & {
 				auto parse_num = [](const std::string &name)->int {
 					if (name.size() >= 8 && name.rfind("Player ", 0) == 0) {
 						int num = 0; bool any = false;
@@ -496,8 +611,7 @@ void PlayMode::draw(glm::uvec2 const &drawable_size) {
 				return (&pp == red) ? g_tex_p1 : g_tex_p2;
 			};
 
-			GLuint tex = choose_texture(p);
-			g_sprites.draw(world_to_clip, tex, p.position, arrow_size, rot, glm::vec4(1,1,1,1));
+			g_sprites.submit(choose_texture(p), p.position, arrow_size, rot, glm::vec4(1,1,1,1), Layer_Players);
 			++idx;
 		}
 	}
@@ -506,13 +620,16 @@ void PlayMode::draw(glm::uvec2 const &drawable_size) {
 	for (const auto &fx : g_fx) {
 		float a = 1.0f - std::min(fx.t / fx.life, 1.0f);
 		glm::vec2 sz = glm::vec2(Game::PlayerRadius * 3.0f);
-		g_sprites.draw(world_to_clip, fx.tex, fx.pos, sz, fx.rot, glm::vec4(1,1,1,a));
+		g_sprites.submit(fx.tex, fx.pos, sz, fx.rot, glm::vec4(1,1,1,a), Layer_FX);
 	}
 
+	// world sprites go first; the HUD draws on top:
+	g_sprites.flush();
+
 	// ---------------- HUD ----------------
 	{
 		// helper: choose P1/P2 texture from stable server-side name ("Player N")
-		auto choose_texture = [&](const Player &pp)->GLuint {
+		auto choose_texture = [&](const Player &pp)->SpriteRenderer::Sprite const & {
 			auto parse_num = [](const std::string &name)->int {
 				if (name.size() >= 8 && name.rfind("Player ", 0) == 0) {
 					int num = 0; bool any = false;
@@ -546,60 +663,41 @@ void PlayMode::draw(glm::uvec2 const &drawable_size) {
 			return (&pp == red) ? g_tex_p1 : g_tex_p2;
 		};
 
-		// left panel (do not overlap the board)
-		glm::vec2 left_pos(-1.75f, 0.82f);
-		g_text.draw_text(world_to_clip, left_pos, 0.08f, glm::vec4(1,1,1,1), "You Are");
+		// icons: front() is YOU (server sends you first), back() is OPPONENT
+		g_hud.you_icon->set_visible(!game.players.empty());
+		if (!game.players.empty()) g_hud.you_icon->set_sprite(choose_texture(game.players.front()));
+		g_hud.enemy_icon->set_visible(game.players.size() > 1);
+		if (game.players.size() > 1) g_hud.enemy_icon->set_sprite(choose_texture(game.players.back()));
 
-		// [ADD] draw your own icon next to the label
-		if (!game.players.empty()) {
-			GLuint self_tex = choose_texture(game.players.front());           // front() is YOU (server sends you first)
-			glm::vec2 you_icon_pos = left_pos + glm::vec2(0.60f, 0.01f);      // slightly to the right of text baseline
-			glm::vec2 you_icon_sz  = glm::vec2(Game::PlayerRadius * 2.4f);    // same scale as ability icons
-			g_sprites.draw(world_to_clip, self_tex, you_icon_pos, you_icon_sz, 0.0f, glm::vec4(1,1,1,1));
+		// hearts (only re-built when hp changes):
+		if (local_hp != g_hud.shown_local_hp) {
+			g_hud.shown_local_hp = local_hp;
+			g_hud.you_hearts->set_text(make_hearts(local_hp));
+		}
+		if (enemy_hp != g_hud.shown_enemy_hp) {
+			g_hud.shown_enemy_hp = enemy_hp;
+			g_hud.enemy_hearts->set_text(make_hearts(enemy_hp));
 		}
 
-		g_text.draw_text(world_to_clip, left_pos + glm::vec2(0.0f, -0.12f), 0.12f, glm::vec4(1,0.4f,0.4f,1), make_hearts(local_hp));
-
-		// controls header
-		g_text.draw_text(world_to_clip, left_pos + glm::vec2(0.0f, -0.24f), 0.08f, glm::vec4(1,1,1,1), "Move [W/S/A/D]");
-
-		// ability icons + cooldown text
-		auto draw_cd = [&](glm::vec2 icon_at, GLuint tex, const char* label, double left_sec){
-			glm::vec2 sz = glm::vec2(Game::PlayerRadius * 2.4f);
-			g_sprites.draw(world_to_clip, tex, icon_at, sz, 0.0f, glm::vec4(1,1,1,1));
+		// cooldowns (only re-built when the displayed tenth of a second changes):
+		auto update_cd = [&](Hud::Cooldown &cd, double left_sec, double total_sec){
+			int tenths = int(std::ceil(left_sec * 10.0));
+			if (tenths == cd.shown_tenths) return;
+			cd.shown_tenths = tenths;
 			char buf[64];
-			if (left_sec > 0.0) {
-				snprintf(buf, sizeof(buf), "%s  %.1fs", label, left_sec);
+			if (tenths > 0) {
+				snprintf(buf, sizeof(buf), "%s  %.1fs", cd.name, tenths / 10.0);
 			} else {
-				snprintf(buf, sizeof(buf), "%s  READY", label);
+				snprintf(buf, sizeof(buf), "%s  READY", cd.name);
 			}
-			g_text.draw_text(world_to_clip, icon_at + glm::vec2(0.10f, -0.03f), 0.07f, glm::vec4(1,1,1,1), buf);
+			cd.label->set_text(buf);
+			cd.bar->set_fraction(float(tenths / (total_sec * 10.0)));
 		};
+		update_cd(g_hud.atk, std::max(0.0, ATK_CD - (g_now - g_last_atk)), ATK_CD);
+		update_cd(g_hud.def, std::max(0.0, DEF_CD - (g_now - g_last_def)), DEF_CD);
+		update_cd(g_hud.par, std::max(0.0, PAR_CD - (g_now - g_last_par)), PAR_CD);
 
-		double atk_left = std::max(0.0, ATK_CD - (g_now - g_last_atk));
-		double def_left = std::max(0.0, DEF_CD - (g_now - g_last_def));
-		double par_left = std::max(0.0, PAR_CD - (g_now - g_last_par));
-
-		glm::vec2 row1 = left_pos + glm::vec2(0.02f, -0.34f);
-		glm::vec2 row2 = row1     + glm::vec2(0.00f, -0.12f);
-		glm::vec2 row3 = row2     + glm::vec2(0.00f, -0.12f);
-		draw_cd(row1, g_tex_attack, "Attack [J]", atk_left);
-		draw_cd(row2, g_tex_defend, "Defend [K]", def_left);
-		draw_cd(row3, g_tex_parry , "Parry  [L]", par_left);
-
-		// right panel (enemy hearts)
-		glm::vec2 right_pos(1.25f, 0.82f);
-		g_text.draw_text(world_to_clip, right_pos, 0.08f, glm::vec4(1,1,1,1), "Enemy is");
-
-		// [ADD] draw enemy icon next to the label
-		if (game.players.size() > 1) {
-			GLuint enemy_tex = choose_texture(game.players.back());           // back() is OPPONENT
-			glm::vec2 en_icon_pos = right_pos + glm::vec2(0.50f, 0.01f);      // to the right of "Enemy is"
-			glm::vec2 en_icon_sz  = glm::vec2(Game::PlayerRadius * 2.4f);
-			g_sprites.draw(world_to_clip, enemy_tex, en_icon_pos, en_icon_sz, 0.0f, glm::vec4(1,1,1,1));
-		}
-
-		g_text.draw_text(world_to_clip, right_pos + glm::vec2(0.0f, -0.12f), 0.12f, glm::vec4(1,0.4f,0.4f,1), make_hearts(enemy_hp));
+		g_hud.tree.draw(g_sprites, g_text, world_to_clip);
 	}
 
 	GL_ERRORS();
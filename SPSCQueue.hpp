@@ -0,0 +1,114 @@
+#pragma once
+
+/*
+ * SPSCQueue is a fixed-capacity, lock-free queue for handing values from
+ * exactly one producer thread to exactly one consumer thread.
+ *
+ * Neither side ever blocks: try_push() fails when the queue is full and
+ * try_pop() fails when it is empty, so each side decides for itself whether
+ * to retry, drop, or hold on to the value.
+ *
+ * //producer thread:
+ * if (!queue.try_push(std::move(item))) { ...full, try again later... }
+ *
+ * //consumer thread:
+ * Item item;
+ * while (queue.try_pop(&item)) { ... }
+ *
+ */
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cassert>
+#include <algorithm>
+
+template< typename T >
+struct SPSCQueue {
+	//capacity is rounded up to a power of two:
+	explicit SPSCQueue(size_t capacity) {
+		size_t size = 1;
+		while (size < capacity) size *= 2;
+		slots.resize(size);
+		mask = size - 1;
+	}
+
+	SPSCQueue(SPSCQueue const &) = delete;
+	SPSCQueue &operator=(SPSCQueue const &) = delete;
+
+	//producer side: returns false (and leaves 'value' alone) if the queue is full:
+	bool try_push(T &&value) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head_cache == slots.size()) {
+			head_cache = head.load(std::memory_order_acquire);
+			if (t - head_cache == slots.size()) return false;
+		}
+		slots[t & mask] = std::move(value);
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+	bool try_push(T const &value) {
+		T copy(value);
+		return try_push(std::move(copy));
+	}
+
+	//consumer side: returns false if the queue is empty:
+	bool try_pop(T *value) {
+		assert(value);
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail_cache) {
+			tail_cache = tail.load(std::memory_order_acquire);
+			if (h == tail_cache) return false;
+		}
+		*value = std::move(slots[h & mask]);
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	//bulk versions, for queues of plain values (e.g., audio samples):
+	//producer side: pushes as many of values[0,count) as fit; returns the number pushed:
+	size_t try_push_n(T const *values, size_t count) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (slots.size() - (t - head_cache) < count) {
+			head_cache = head.load(std::memory_order_acquire);
+		}
+		count = std::min(count, slots.size() - (t - head_cache));
+		for (size_t i = 0; i < count; ++i) {
+			slots[(t + i) & mask] = values[i];
+		}
+		tail.store(t + count, std::memory_order_release);
+		return count;
+	}
+
+	//consumer side: pops up to 'count' values into values[0,count); returns the number popped:
+	size_t try_pop_n(T *values, size_t count) {
+		size_t h = head.load(std::memory_order_relaxed);
+		if (tail_cache - h < count) {
+			tail_cache = tail.load(std::memory_order_acquire);
+		}
+		count = std::min(count, tail_cache - h);
+		for (size_t i = 0; i < count; ++i) {
+			values[i] = std::move(slots[(h + i) & mask]);
+		}
+		head.store(h + count, std::memory_order_release);
+		return count;
+	}
+
+	//approximate (may be stale by the time the caller looks at it):
+	size_t size_approx() const {
+		return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+	}
+	size_t capacity() const { return slots.size(); }
+
+	//internals:
+	std::vector< T > slots;
+	size_t mask = 0;
+
+	//consumer-owned (kept on separate cache lines from the producer's half to avoid false sharing):
+	alignas(64) std::atomic< size_t > head{0}; //next slot to pop
+	size_t tail_cache = 0; //consumer's last look at 'tail'
+
+	//producer-owned:
+	alignas(64) std::atomic< size_t > tail{0}; //next slot to push
+	size_t head_cache = 0; //producer's last look at 'head'
+};
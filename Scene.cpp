@@ -1,15 +1,18 @@
 #include "Scene.hpp"
 
 #include "gl_errors.hpp"
+#include "MappedFile.hpp"
 #include "read_write_chunk.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
-#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <istream>
 
 //-------------------------
 
-glm::mat4x3 Scene::Transform::make_parent_from_local() const {
+static glm::mat4x3 make_parent_from_local(glm::vec3 const &position, glm::quat const &rotation, glm::vec3 const &scale) {
 	//compute:
 	//   translate   *   rotate    *   scale
 	// [ 1 0 0 p.x ]   [       0 ]   [ s.x 0 0 0 ]
@@ -26,6 +29,10 @@ glm::mat4x3 Scene::Transform::make_parent_from_local() const {
 	);
 }
 
+glm::mat4x3 Scene::Transform::make_parent_from_local() const {
+	return ::make_parent_from_local(position, rotation, scale);
+}
+
 glm::mat4x3 Scene::Transform::make_local_from_parent() const {
 	//compute:
 	//   1/scale       *    rot^-1   *  translate^-1
@@ -87,9 +94,246 @@ void Scene::draw(Camera const &camera) const {
 	draw(clip_from_world, light_from_world);
 }
 
-void Scene::draw(glm::mat4 const &clip_from_world, glm::mat4x3 const &light_from_world) const {
+uint32_t Scene::update_hierarchy() const {
+	uint32_t count = uint32_t(transforms.size());
+
+	//check that every transform is still at its slot with the same parent:
+	// (every transform in the list is checked, so by the time a parent's slot is compared it has been validated too)
+	bool sorted = (hierarchy.transform.size() == count);
+	if (sorted) {
+		for (auto const &t : transforms) {
+			if (!(t.slot < count && hierarchy.transform[t.slot] == &t)) {
+				sorted = false;
+				break;
+			}
+			uint32_t parent = (t.parent ? t.parent->slot : Hierarchy::NoParent);
+			if (hierarchy.parent[t.slot] != parent) {
+				sorted = false;
+				break;
+			}
+		}
+	}
+
+	if (!sorted) {
+		//re-sort, placing each transform after its parent:
+		constexpr uint32_t Unplaced = -1U;
+		constexpr uint32_t Placing = -2U;
+		for (auto const &t : transforms) {
+			t.slot = Unplaced;
+		}
+		hierarchy.transform.clear();
+		hierarchy.parent.clear();
+		hierarchy.transform.reserve(count);
+		hierarchy.parent.reserve(count);
+
+		std::vector< Transform const * > chain;
+		for (auto const &t : transforms) {
+			//collect unplaced ancestors (for a scene that is already sorted, that's just 't'):
+			chain.clear();
+			for (Transform const *at = &t; at && at->slot >= Placing; at = at->parent) {
+				if (at->slot == Placing) throw std::runtime_error("Scene transform hierarchy contains a cycle.");
+				at->slot = Placing;
+				chain.emplace_back(at);
+			}
+			//place them root-most first:
+			for (auto ci = chain.rbegin(); ci != chain.rend(); ++ci) {
+				Transform const *at = *ci;
+				at->slot = uint32_t(hierarchy.transform.size());
+				hierarchy.transform.emplace_back(at);
+				hierarchy.parent.emplace_back(at->parent ? at->parent->slot : Hierarchy::NoParent);
+			}
+		}
+		//(a parent that isn't in 'transforms' gets placed anyway; the hierarchy will just never look sorted)
+		count = uint32_t(hierarchy.transform.size());
+		hierarchy.position.assign(count, glm::vec3(0.0f));
+		hierarchy.rotation.assign(count, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+		hierarchy.scale.assign(count, glm::vec3(1.0f));
+		hierarchy.world_from_local.assign(count, glm::mat4x3(1.0f));
+	}
+	hierarchy.changed.resize(count);
+
+	//update world matrices, parents first, skipping any where neither the transform nor its ancestors changed:
+	uint32_t rebuilt = 0;
+	for (uint32_t i = 0; i < count; ++i) {
+		Transform const &t = *hierarchy.transform[i];
+		uint32_t parent = hierarchy.parent[i];
+		bool changed = !sorted
+			|| (parent != Hierarchy::NoParent && hierarchy.changed[parent])
+			|| t.position != hierarchy.position[i]
+			|| t.rotation != hierarchy.rotation[i]
+			|| t.scale != hierarchy.scale[i];
+		hierarchy.changed[i] = changed;
+		if (!changed) continue;
+
+		hierarchy.position[i] = t.position;
+		hierarchy.rotation[i] = t.rotation;
+		hierarchy.scale[i] = t.scale;
+		glm::mat4x3 parent_from_local = make_parent_from_local(hierarchy.position[i], hierarchy.rotation[i], hierarchy.scale[i]);
+		if (parent == Hierarchy::NoParent) {
+			hierarchy.world_from_local[i] = parent_from_local;
+		} else {
+			hierarchy.world_from_local[i] = hierarchy.world_from_local[parent] * glm::mat4(parent_from_local);
+		}
+		rebuilt += 1;
+	}
+	return rebuilt;
+}
+
+glm::mat4x3 const &Scene::world_from_local(Transform const &transform) const {
+	if (!(transform.slot < hierarchy.transform.size() && hierarchy.transform[transform.slot] == &transform)) {
+		throw std::runtime_error("Scene::world_from_local: transform '" + transform.name + "' isn't in the hierarchy; call update_hierarchy() after adding transforms.");
+	}
+	return hierarchy.world_from_local[transform.slot];
+}
+
+//Sort keys order drawables by pipeline state, most expensive to change first:
+// [63..54] program | [53..42] vao | [41..30] first texture | [29..16] vertex range | [15..0] view depth (near to far)
+//GL names are truncated to fit and the vertex range is hashed; collisions just interleave groups, costing a few extra binds / draws.
+// (sorting by vertex range puts copies of the same mesh next to each other, so they can be drawn instanced)
+static uint64_t make_sort_key(Scene::Drawable::Pipeline const &pipeline, float depth) {
+	uint64_t key = 0;
+	key |= uint64_t(pipeline.program & 0x3ff) << 54;
+	key |= uint64_t(pipeline.vao & 0xfff) << 42;
+	key |= uint64_t(pipeline.textures[0].texture & 0xfff) << 30;
+	key |= uint64_t(((pipeline.start * 0x9E3779B1u) ^ (pipeline.count * 0x85EBCA77u)) >> 18) << 16;
+	//non-negative floats sort the same way as their bit patterns, so the top 16 bits make a (coarse) depth key:
+	depth = std::max(depth, 0.0f);
+	uint32_t bits;
+	static_assert(sizeof(bits) == sizeof(depth), "float should be 32 bits");
+	std::memcpy(&bits, &depth, sizeof(bits));
+	key |= uint64_t(bits >> 16);
+	return key;
+}
+
+//can 'b' share an instanced draw call with 'a'?
+static bool same_instanced_draw(Scene::Drawable::Pipeline const &a, Scene::Drawable::Pipeline const &b) {
+	if (a.program != b.program || a.vao != b.vao) return false;
+	if (a.type != b.type || a.start != b.start || a.count != b.count || a.index_type != b.index_type) return false;
+	if (a.set_uniforms || b.set_uniforms) return false; //(can't tell if two of these would set the same thing)
+	for (uint32_t i = 0; i < Scene::Drawable::Pipeline::TextureCount; ++i) {
+		if (a.textures[i].texture != b.textures[i].texture || a.textures[i].target != b.textures[i].target) return false;
+	}
+	return true;
+}
+
+//per-instance matrices for instanced pipelines live in a buffer texture, bound to the unit after the pipeline's textures:
+static constexpr uint32_t InstanceTextureUnit = Scene::Drawable::Pipeline::TextureCount;
+struct InstanceBuffer {
+	GLuint buffer = 0;
+	GLuint texture = 0;
+	uint32_t max_instances = 0; //how many fit in one buffer texture
+};
+static InstanceBuffer &instance_buffer() {
+	static InstanceBuffer ib;
+	if (ib.buffer == 0) {
+		glGenBuffers(1, &ib.buffer);
+		glGenTextures(1, &ib.texture);
+		glBindBuffer(GL_TEXTURE_BUFFER, ib.buffer);
+		glBindTexture(GL_TEXTURE_BUFFER, ib.texture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, ib.buffer);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+		GLint max_texels = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+		ib.max_instances = std::max(1u, uint32_t(max_texels) / Scene::Drawable::Pipeline::InstanceTexels);
+		GL_ERRORS();
+	}
+	return ib;
+}
+
+//Frustum planes as (a,b,c,d) with dot(abc, p) + d >= 0 for points 'p' inside the view, from the rows of clip_from_world:
+// (for an infinite perspective projection the "far" plane comes out as (0,0,0,+), which keeps everything)
+static void make_frustum_planes(glm::mat4 const &clip_from_world, glm::vec4 planes[6]) {
+	glm::vec4 row[4];
+	for (uint32_t r = 0; r < 4; ++r) {
+		row[r] = glm::vec4(clip_from_world[0][r], clip_from_world[1][r], clip_from_world[2][r], clip_from_world[3][r]);
+	}
+	planes[0] = row[3] + row[0]; //left
+	planes[1] = row[3] - row[0]; //right
+	planes[2] = row[3] + row[1]; //bottom
+	planes[3] = row[3] - row[1]; //top
+	planes[4] = row[3] + row[2]; //near
+	planes[5] = row[3] - row[2]; //far
+}
+
+//World-space boxes (as center + half-extent), stored as separate arrays so the plane tests below run over
+// contiguous floats and the compiler can vectorize them:
+struct CullBoxes {
+	std::vector< float > cx, cy, cz, ex, ey, ez;
+	std::vector< uint8_t > visible;
+
+	void clear() {
+		cx.clear(); cy.clear(); cz.clear();
+		ex.clear(); ey.clear(); ez.clear();
+	}
+	void push(glm::vec3 const &center, glm::vec3 const &extent) {
+		cx.emplace_back(center.x); cy.emplace_back(center.y); cz.emplace_back(center.z);
+		ex.emplace_back(extent.x); ey.emplace_back(extent.y); ez.emplace_back(extent.z);
+	}
+
+	//set visible[i] to 0 for boxes entirely behind any of the planes:
+	void cull(glm::vec4 const planes[6]) {
+		size_t count = cx.size();
+		visible.assign(count, 1);
+		float const *px = cx.data(), *py = cy.data(), *pz = cz.data();
+		float const *rx = ex.data(), *ry = ey.data(), *rz = ez.data();
+		uint8_t *out = visible.data();
+		for (uint32_t p = 0; p < 6; ++p) {
+			glm::vec4 plane = planes[p];
+			glm::vec3 abs_normal = glm::abs(glm::vec3(plane));
+			for (size_t i = 0; i < count; ++i) {
+				float dist = plane.x * px[i] + plane.y * py[i] + plane.z * pz[i] + plane.w;
+				float radius = abs_normal.x * rx[i] + abs_normal.y * ry[i] + abs_normal.z * rz[i];
+				out[i] &= uint8_t(dist + radius >= 0.0f);
+			}
+		}
+	}
+};
+
+struct QueuedDrawable {
+	uint64_t key;
+	Scene::Drawable const *drawable;
+	glm::mat4x3 world_from_object;
+};
+
+//LSD radix sort on 'key', eight bits at a time; passes where every key has the same digit are skipped:
+static void radix_sort(std::vector< QueuedDrawable > &items, std::vector< QueuedDrawable > &scratch) {
+	scratch.resize(items.size());
+	for (uint32_t shift = 0; shift < 64; shift += 8) {
+		uint32_t counts[256] = { };
+		for (auto const &item : items) {
+			counts[(item.key >> shift) & 0xff] += 1;
+		}
+		if (counts[(items[0].key >> shift) & 0xff] == items.size()) continue;
+
+		uint32_t offsets[256];
+		uint32_t total = 0;
+		for (uint32_t d = 0; d < 256; ++d) {
+			offsets[d] = total;
+			total += counts[d];
+		}
+		for (auto const &item : items) {
+			scratch[offsets[(item.key >> shift) & 0xff]++] = item;
+		}
+		items.swap(scratch);
+	}
+}
 
-	//Iterate through all drawables, sending each one to OpenGL:
+void Scene::draw(glm::mat4 const &clip_from_world, glm::mat4x3 const &light_from_world) const {
+	draw_stats = DrawStats();
+	draw_stats.transform_rebuilds = update_hierarchy();
+
+	glm::vec4 frustum[6];
+	make_frustum_planes(clip_from_world, frustum);
+
+	//Build a render queue of all the drawables that have something to draw:
+	// (drawables with bounds wait in 'bounded' until they pass the frustum test)
+	static thread_local std::vector< QueuedDrawable > queue, scratch, bounded;
+	static thread_local CullBoxes boxes;
+	queue.clear();
+	bounded.clear();
+	boxes.clear();
 	for (auto const &drawable : drawables) {
 		//Reference to drawable's pipeline for convenience:
 		Scene::Drawable::Pipeline const &pipeline = drawable.pipeline;
@@ -101,63 +345,224 @@ void Scene::draw(glm::mat4 const &clip_from_world, glm::mat4x3 const &light_from
 		//skip any drawables that don't contain any vertices:
 		if (pipeline.count == 0) continue;
 
+		assert(drawable.transform); //drawables *must* have a transform
+		glm::mat4x3 const &world_from_object = world_from_local(*drawable.transform);
+
+		//depth of the object's origin ('w' is distance along the view direction for perspective projections):
+		float depth = (clip_from_world * glm::vec4(world_from_object[3], 1.0f)).w;
+
+		QueuedDrawable item{ make_sort_key(pipeline, depth), &drawable, world_from_object };
+
+		bool has_bounds = drawable.bounds_min.x <= drawable.bounds_max.x
+		               && drawable.bounds_min.y <= drawable.bounds_max.y
+		               && drawable.bounds_min.z <= drawable.bounds_max.z;
+		if (has_bounds) {
+			//world-space box around the transformed object-space box:
+			glm::vec3 center = 0.5f * (drawable.bounds_max + drawable.bounds_min);
+			glm::vec3 extent = 0.5f * (drawable.bounds_max - drawable.bounds_min);
+			glm::mat3 abs_linear = glm::mat3(glm::abs(world_from_object[0]), glm::abs(world_from_object[1]), glm::abs(world_from_object[2]));
+			boxes.push(world_from_object * glm::vec4(center, 1.0f), abs_linear * extent);
+			bounded.emplace_back(item);
+		} else {
+			queue.emplace_back(item);
+		}
+	}
 
-		//Set shader program:
-		glUseProgram(pipeline.program);
-
-		//Set attribute sources:
-		glBindVertexArray(pipeline.vao);
+	boxes.cull(frustum);
+	for (size_t i = 0; i < bounded.size(); ++i) {
+		if (boxes.visible[i]) queue.emplace_back(bounded[i]);
+		else draw_stats.culled += 1;
+	}
+	if (queue.empty()) return;
+
+	//Group drawables by state (and, within a group, draw front-to-back):
+	radix_sort(queue, scratch);
+
+	//Currently bound state, so that only changes get sent to OpenGL:
+	GLuint bound_program = 0;
+	GLuint bound_vao = 0;
+	Drawable::Pipeline::TextureInfo bound_textures[Drawable::Pipeline::TextureCount];
+	uint32_t active_unit = 0;
+	glActiveTexture(GL_TEXTURE0);
+
+	//Draw calls are collected into batches (one draw call each), along with the instance data they need:
+	struct Batch {
+		uint32_t first; //index in queue
+		uint32_t count; //drawables in this batch (> 1 only for instanced pipelines)
+		uint32_t instance_base; //first instance in 'instance_data' (instanced pipelines only)
+	};
+	static thread_local std::vector< Batch > batches;
+	static thread_local std::vector< glm::vec4 > instance_data;
+	batches.clear();
+	instance_data.clear();
+	InstanceBuffer *instances = nullptr; //(created on first use)
+	bool bound_instances = false;
+
+	auto draw_batches = [&]() {
+		if (!instance_data.empty()) {
+			//upload (orphaning last batch's data, which the GPU may still be reading):
+			glBindBuffer(GL_TEXTURE_BUFFER, instances->buffer);
+			glBufferData(GL_TEXTURE_BUFFER, instance_data.size() * sizeof(glm::vec4), instance_data.data(), GL_STREAM_DRAW);
+			glBindBuffer(GL_TEXTURE_BUFFER, 0);
+			if (!bound_instances) {
+				glActiveTexture(GL_TEXTURE0 + InstanceTextureUnit);
+				active_unit = InstanceTextureUnit;
+				glBindTexture(GL_TEXTURE_BUFFER, instances->texture);
+				bound_instances = true;
+			}
+		}
 
-		//Configure program uniforms:
+		for (auto const &batch : batches) {
+			QueuedDrawable const &item = queue[batch.first];
+			Scene::Drawable::Pipeline const &pipeline = item.drawable->pipeline;
+
+			//Set shader program:
+			if (pipeline.program != bound_program) {
+				glUseProgram(pipeline.program);
+				bound_program = pipeline.program;
+				draw_stats.program_binds += 1;
+				if (pipeline.INSTANCES_samplerBuffer != -1U) {
+					glUniform1i(pipeline.INSTANCES_samplerBuffer, InstanceTextureUnit);
+				}
+			}
 
-		//the object-to-world matrix is used in all three of these uniforms:
-		assert(drawable.transform); //drawables *must* have a transform
-		glm::mat4x3 world_from_object = drawable.transform->make_world_from_local();
+			//Set attribute sources:
+			if (pipeline.vao != bound_vao) {
+				glBindVertexArray(pipeline.vao);
+				bound_vao = pipeline.vao;
+				draw_stats.vao_binds += 1;
+			}
 
-		//CLIP_FROM_OBJECT takes vertices from object space to clip space:
-		if (pipeline.CLIP_FROM_OBJECT_mat4 != -1U) {
-			glm::mat4 clip_from_object = clip_from_world * glm::mat4(world_from_object);
-			glUniformMatrix4fv(pipeline.CLIP_FROM_OBJECT_mat4, 1, GL_FALSE, glm::value_ptr(clip_from_object));
-		}
+			//Configure program uniforms:
+			if (pipeline.INSTANCES_samplerBuffer != -1U) {
+				//(per-instance matrices were already written to instance_data)
+				if (pipeline.INSTANCE_BASE_int != -1U) {
+					glUniform1i(pipeline.INSTANCE_BASE_int, GLint(batch.instance_base));
+				}
+			} else {
+				//the object-to-world matrix is used in all three of these uniforms:
+				glm::mat4x3 const &world_from_object = item.world_from_object;
+
+				//CLIP_FROM_OBJECT takes vertices from object space to clip space:
+				if (pipeline.CLIP_FROM_OBJECT_mat4 != -1U) {
+					glm::mat4 clip_from_object = clip_from_world * glm::mat4(world_from_object);
+					glUniformMatrix4fv(pipeline.CLIP_FROM_OBJECT_mat4, 1, GL_FALSE, glm::value_ptr(clip_from_object));
+				}
+
+				//the object-to-light matrix is used in the next two uniforms:
+				glm::mat4x3 light_from_object = light_from_world * glm::mat4(world_from_object);
+
+				//CLIP_FROM_OBJECT takes vertices from object space to light space:
+				if (pipeline.LIGHT_FROM_OBJECT_mat4x3 != -1U) {
+					glUniformMatrix4x3fv(pipeline.LIGHT_FROM_OBJECT_mat4x3, 1, GL_FALSE, glm::value_ptr(light_from_object));
+				}
+
+				//LIGHT_FROM_NORMAL takes normals from object space to light space:
+				if (pipeline.LIGHT_FROM_NORMAL_mat3 != -1U) {
+					glm::mat3 light_from_normal = glm::inverse(glm::transpose(glm::mat3(light_from_object)));
+					glUniformMatrix3fv(pipeline.LIGHT_FROM_NORMAL_mat3, 1, GL_FALSE, glm::value_ptr(light_from_normal));
+				}
+			}
 
-		//the object-to-light matrix is used in the next two uniforms:
-		glm::mat4x3 light_from_object = light_from_world * glm::mat4(world_from_object);
+			//set any requested custom uniforms:
+			if (pipeline.set_uniforms) pipeline.set_uniforms();
+
+			//set up textures (units the pipeline doesn't use are left as they are; its shader won't read them):
+			for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
+				Drawable::Pipeline::TextureInfo const &want = pipeline.textures[i];
+				if (want.texture == 0) continue;
+				if (want.texture == bound_textures[i].texture && want.target == bound_textures[i].target) continue;
+				if (active_unit != i) {
+					glActiveTexture(GL_TEXTURE0 + i);
+					active_unit = i;
+				}
+				if (bound_textures[i].texture != 0 && bound_textures[i].target != want.target) {
+					glBindTexture(bound_textures[i].target, 0);
+				}
+				glBindTexture(want.target, want.texture);
+				bound_textures[i] = want;
+				draw_stats.texture_binds += 1;
+			}
 
-		//CLIP_FROM_OBJECT takes vertices from object space to light space:
-		if (pipeline.LIGHT_FROM_OBJECT_mat4x3 != -1U) {
-			glUniformMatrix4x3fv(pipeline.LIGHT_FROM_OBJECT_mat4x3, 1, GL_FALSE, glm::value_ptr(light_from_object));
+			//draw the object(s):
+			if (pipeline.index_type != GL_NONE) {
+				size_t index_size = (pipeline.index_type == GL_UNSIGNED_BYTE ? 1 : pipeline.index_type == GL_UNSIGNED_SHORT ? 2 : 4);
+				GLbyte const *first = (GLbyte const *)0 + size_t(pipeline.start) * index_size;
+				if (pipeline.INSTANCES_samplerBuffer != -1U) {
+					glDrawElementsInstanced(pipeline.type, pipeline.count, pipeline.index_type, first, batch.count);
+				} else {
+					glDrawElements(pipeline.type, pipeline.count, pipeline.index_type, first);
+				}
+			} else if (pipeline.INSTANCES_samplerBuffer != -1U) {
+				glDrawArraysInstanced(pipeline.type, pipeline.start, pipeline.count, batch.count);
+			} else {
+				glDrawArrays(pipeline.type, pipeline.start, pipeline.count);
+			}
+			draw_stats.draws += 1;
+			draw_stats.drawables += batch.count;
 		}
 
-		//LIGHT_FROM_NORMAL takes normals from object space to light space:
-		if (pipeline.LIGHT_FROM_NORMAL_mat3 != -1U) {
-			glm::mat3 light_from_normal = glm::inverse(glm::transpose(glm::mat3(light_from_object)));
-			glUniformMatrix3fv(pipeline.LIGHT_FROM_NORMAL_mat3, 1, GL_FALSE, glm::value_ptr(light_from_normal));
+		batches.clear();
+		instance_data.clear();
+	};
+
+	for (uint32_t i = 0; i < queue.size(); /* later */) {
+		Scene::Drawable::Pipeline const &pipeline = queue[i].drawable->pipeline;
+		if (pipeline.INSTANCES_samplerBuffer == -1U) {
+			batches.emplace_back(Batch{ i, 1, 0 });
+			i += 1;
+			continue;
 		}
 
-		//set any requested custom uniforms:
-		if (pipeline.set_uniforms) pipeline.set_uniforms();
+		if (!instances) instances = &instance_buffer();
 
-		//set up textures:
-		for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
-			if (pipeline.textures[i].texture != 0) {
-				glActiveTexture(GL_TEXTURE0 + i);
-				glBindTexture(pipeline.textures[i].target, pipeline.textures[i].texture);
-			}
+		//gather the following copies of the same mesh:
+		uint32_t count = 1;
+		while (i + count < queue.size() && count < instances->max_instances
+		    && same_instanced_draw(pipeline, queue[i + count].drawable->pipeline)) {
+			count += 1;
 		}
 
-		//draw the object:
-		glDrawArrays(pipeline.type, pipeline.start, pipeline.count);
+		//make room in the buffer texture if needed:
+		uint32_t base = uint32_t(instance_data.size() / Drawable::Pipeline::InstanceTexels);
+		if (base + count > instances->max_instances) {
+			draw_batches();
+			base = 0;
+		}
 
-		//un-bind textures:
-		for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
-			if (pipeline.textures[i].texture != 0) {
-				glActiveTexture(GL_TEXTURE0 + i);
-				glBindTexture(pipeline.textures[i].target, 0);
+		//per-instance data, laid out as described in Scene.hpp:
+		for (uint32_t j = i; j < i + count; ++j) {
+			glm::mat4x3 const &world_from_object = queue[j].world_from_object;
+			glm::mat4 clip_from_object = clip_from_world * glm::mat4(world_from_object);
+			glm::mat4x3 light_from_object = light_from_world * glm::mat4(world_from_object);
+			glm::mat3 light_from_normal = glm::inverse(glm::transpose(glm::mat3(light_from_object)));
+			for (uint32_t c = 0; c < 4; ++c) {
+				instance_data.emplace_back(clip_from_object[c]);
+			}
+			for (uint32_t r = 0; r < 3; ++r) {
+				instance_data.emplace_back(light_from_object[0][r], light_from_object[1][r], light_from_object[2][r], light_from_object[3][r]);
+			}
+			for (uint32_t c = 0; c < 3; ++c) {
+				instance_data.emplace_back(light_from_normal[c], 0.0f);
 			}
 		}
-		glActiveTexture(GL_TEXTURE0);
+		batches.emplace_back(Batch{ i, count, base });
+		i += count;
+	}
+	draw_batches();
 
+	//un-bind textures:
+	for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
+		if (bound_textures[i].texture != 0) {
+			glActiveTexture(GL_TEXTURE0 + i);
+			glBindTexture(bound_textures[i].target, 0);
+		}
 	}
+	if (bound_instances) {
+		glActiveTexture(GL_TEXTURE0 + InstanceTextureUnit);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+	}
+	glActiveTexture(GL_TEXTURE0);
 
 	glUseProgram(0);
 	glBindVertexArray(0);
@@ -169,10 +574,17 @@ void Scene::draw(glm::mat4 const &clip_from_world, glm::mat4x3 const &light_from
 void Scene::load(std::string const &filename,
 	std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable) {
 
-	std::ifstream file(filename, std::ios::binary);
+	MappedFile mapped(filename);
+	load(mapped.data(), mapped.size(), filename, on_drawable);
+}
+
+void Scene::load(char const *data, size_t size, std::string const &filename,
+	std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable) {
+
+	ChunkBytes file{ data, data + size };
 
 	std::vector< char > names;
-	read_chunk(file, "str0", &names);
+	read_chunk(&file, "str0", &names);
 
 	struct HierarchyEntry {
 		uint32_t parent;
@@ -184,7 +596,7 @@ void Scene::load(std::string const &filename,
 	};
 	static_assert(sizeof(HierarchyEntry) == 4 + 4 + 4 + 4*3 + 4*4 + 4*3, "HierarchyEntry is packed.");
 	std::vector< HierarchyEntry > hierarchy;
-	read_chunk(file, "xfh0", &hierarchy);
+	read_chunk(&file, "xfh0", &hierarchy);
 
 	struct MeshEntry {
 		uint32_t transform;
@@ -193,7 +605,7 @@ void Scene::load(std::string const &filename,
 	};
 	static_assert(sizeof(MeshEntry) == 4 + 4 + 4, "MeshEntry is packed.");
 	std::vector< MeshEntry > meshes;
-	read_chunk(file, "msh0", &meshes);
+	read_chunk(&file, "msh0", &meshes);
 
 	struct CameraEntry {
 		uint32_t transform;
@@ -203,7 +615,7 @@ void Scene::load(std::string const &filename,
 	};
 	static_assert(sizeof(CameraEntry) == 4 + 4 + 4 + 4 + 4, "CameraEntry is packed.");
 	std::vector< CameraEntry > loaded_cameras;
-	read_chunk(file, "cam0", &loaded_cameras);
+	read_chunk(&file, "cam0", &loaded_cameras);
 
 	struct LightEntry {
 		uint32_t transform;
@@ -215,7 +627,7 @@ void Scene::load(std::string const &filename,
 	};
 	static_assert(sizeof(LightEntry) == 4 + 1 + 3 + 4 + 4 + 4, "LightEntry is packed.");
 	std::vector< LightEntry > loaded_lights;
-	read_chunk(file, "lmp0", &loaded_lights);
+	read_chunk(&file, "lmp0", &loaded_lights);
 
 
 	//--------------------------------
@@ -301,10 +713,17 @@ void Scene::load(std::string const &filename,
 		light->spot_fov = l.fov / 180.0f * 3.1415926f; //FOV is stored in degrees; convert to radians.
 	}
 
-	//load any extra that a subclass wants:
-	load_extra(file, names, hierarchy_transforms);
+	//load any extra that a subclass wants (from a stream over the rest of the mapped file):
+	struct RemainingBytes : std::streambuf {
+		RemainingBytes(ChunkBytes const &bytes) {
+			char *begin = const_cast< char * >(bytes.begin); //(only ever read)
+			setg(begin, begin, begin + bytes.size());
+		}
+	} remaining(file);
+	std::istream extra(&remaining);
+	load_extra(extra, names, hierarchy_transforms);
 
-	if (file.peek() != EOF) {
+	if (extra.peek() != EOF) {
 		std::cerr << "WARNING: trailing data in scene file '" << filename << "'" << std::endl;
 	}
 
@@ -327,51 +746,63 @@ Scene &Scene::operator=(Scene const &other) {
 	return *this;
 }
 
-void Scene::set(Scene const &other, std::unordered_map< Transform const *, Transform * > *transform_map_) {
+void Scene::set(Scene const &other, std::unordered_map< Transform const *, Transform * > *transform_map) {
 
-	std::unordered_map< Transform const *, Transform * > t2t_temp;
-	std::unordered_map< Transform const *, Transform * > &transform_to_transform = *(transform_map_ ? transform_map_ : &t2t_temp);
+	//copy transforms in the other scene's hierarchy order, so that slot indices carry over and pointers can be fixed up by index:
+	other.update_hierarchy();
+	hierarchy = other.hierarchy;
 
-	transform_to_transform.clear();
+	uint32_t count = uint32_t(hierarchy.transform.size());
+	std::vector< Transform * > slot_to_transform;
+	slot_to_transform.reserve(count);
 
-	//null transform maps to itself:
-	transform_to_transform.insert(std::make_pair(nullptr, nullptr));
-
-	//Copy transforms and store mapping:
 	transforms.clear();
-	for (auto const &t : other.transforms) {
+	for (uint32_t i = 0; i < count; ++i) {
+		Transform const &t = *other.hierarchy.transform[i];
 		transforms.emplace_back();
 		transforms.back().name = t.name;
 		transforms.back().position = t.position;
 		transforms.back().rotation = t.rotation;
 		transforms.back().scale = t.scale;
-		transforms.back().parent = t.parent; //will update later
+		uint32_t parent = hierarchy.parent[i];
+		transforms.back().parent = (parent == Hierarchy::NoParent ? nullptr : slot_to_transform[parent]); //(parents come first)
+		transforms.back().slot = i;
 
-		//store mapping between transforms old and new:
-		auto ret = transform_to_transform.insert(std::make_pair(&t, &transforms.back()));
-		assert(ret.second);
+		slot_to_transform.emplace_back(&transforms.back());
+		hierarchy.transform[i] = &transforms.back();
 	}
 
-	//update transform parents:
-	for (auto &t : transforms) {
-		t.parent = transform_to_transform.at(t.parent);
+	auto copy_of = [&](Transform const *t) -> Transform * {
+		if (!t) return nullptr;
+		if (!(t->slot < count && other.hierarchy.transform[t->slot] == t)) {
+			throw std::runtime_error("Scene::set: object refers to a transform that isn't in the scene.");
+		}
+		return slot_to_transform[t->slot];
+	};
+
+	if (transform_map) {
+		transform_map->clear();
+		transform_map->insert(std::make_pair(nullptr, nullptr));
+		for (uint32_t i = 0; i < count; ++i) {
+			transform_map->insert(std::make_pair(other.hierarchy.transform[i], slot_to_transform[i]));
+		}
 	}
 
 	//copy other's drawables, updating transform pointers:
 	drawables = other.drawables;
 	for (auto &d : drawables) {
-		d.transform = transform_to_transform.at(d.transform);
+		d.transform = copy_of(d.transform);
 	}
 
 	//copy other's cameras, updating transform pointers:
 	cameras = other.cameras;
 	for (auto &c : cameras) {
-		c.transform = transform_to_transform.at(c.transform);
+		c.transform = copy_of(c.transform);
 	}
 
 	//copy other's lights, updating transform pointers:
 	lights = other.lights;
 	for (auto &l : lights) {
-		l.transform = transform_to_transform.at(l.transform);
+		l.transform = copy_of(l.transform);
 	}
 }
@@ -15,6 +15,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+#include <limits>
 #include <list>
 #include <memory>
 #include <functional>
@@ -40,6 +41,7 @@ struct Scene {
 		glm::mat4x3 make_parent_from_local() const;
 		glm::mat4x3 make_local_from_parent() const;
 		// ..relative to the world:
+		// (these walk up the parent chain every call; Scene::world_from_local looks up the matrices Scene::draw last computed)
 		glm::mat4x3 make_world_from_local() const;
 		glm::mat4x3 make_local_from_world() const;
 
@@ -47,6 +49,10 @@ struct Scene {
 		Transform(Transform const &) = delete;
 		//if we delete some constructors, we need to let the compiler know that the default constructor is still okay:
 		Transform() = default;
+
+	private:
+		friend struct Scene;
+		mutable uint32_t slot = -1U; //index in Scene::hierarchy (maintained by the scene)
 	};
 
 	struct Drawable {
@@ -54,6 +60,11 @@ struct Scene {
 		Drawable(Transform *transform_) : transform(transform_) { assert(transform); }
 		Transform * transform;
 
+		//Object-space bounding box, used to skip drawing things outside the view (e.g. copy a Mesh's min/max here).
+		// the default (empty) box means "bounds unknown", and such drawables are never culled:
+		glm::vec3 bounds_min = glm::vec3( std::numeric_limits< float >::infinity());
+		glm::vec3 bounds_max = glm::vec3(-std::numeric_limits< float >::infinity());
+
 		//Contains all the data needed to run the OpenGL pipeline:
 		struct Pipeline {
 			GLuint program = 0; //shader program; passed to glUseProgram
@@ -65,6 +76,10 @@ struct Scene {
 			GLuint start = 0; //first vertex to draw; passed to glDrawArrays
 			GLuint count = 0; //number of vertices to draw; passed to glDrawArrays
 
+			//(optional) indexed drawing: if set, 'vao' has an element buffer bound and start/count are a range of its indices
+			// (of this type, e.g. GL_UNSIGNED_SHORT); passed to glDrawElements -- copy a Mesh's index_type here
+			GLenum index_type = GL_NONE;
+
 			//uniforms:
 			GLuint CLIP_FROM_OBJECT_mat4 = -1U; //uniform location for object to clip space matrix
 			GLuint LIGHT_FROM_OBJECT_mat4x3 = -1U; //uniform location for object to light space (== world space) matrix
@@ -72,6 +87,14 @@ struct Scene {
 
 			std::function< void() > set_uniforms; //(optional) function to set any other useful uniforms
 
+			//(optional) instancing: a program that reads the three matrices above from a buffer texture instead of uniforms
+			// lets Scene::draw draw all copies of the same vertex range (with the same textures) in one glDrawArraysInstanced (or glDrawElementsInstanced).
+			//the buffer holds InstanceTexels RGBA32F texels per instance, starting at texel InstanceTexels * (INSTANCE_BASE + gl_InstanceID):
+			//  [0..3] CLIP_FROM_OBJECT columns, [4..6] LIGHT_FROM_OBJECT rows, [7..9] LIGHT_FROM_NORMAL columns (.xyz)
+			enum : uint32_t { InstanceTexels = 10 };
+			GLuint INSTANCES_samplerBuffer = -1U; //uniform location for the samplerBuffer holding instance data
+			GLuint INSTANCE_BASE_int = -1U; //uniform location for the index of a draw call's first instance
+
 			//texture objects to bind for the first TextureCount textures:
 			enum : uint32_t { TextureCount = 4 };
 			struct TextureInfo {
@@ -122,18 +145,59 @@ struct Scene {
 	std::list< Camera > cameras;
 	std::list< Light > lights;
 
+	//The transforms are mirrored into flat arrays, sorted so parents come before children,
+	// which lets world matrices for the whole scene be updated in one linear pass:
+	struct Hierarchy {
+		static constexpr uint32_t NoParent = -1U;
+		std::vector< Transform const * > transform;
+		std::vector< uint32_t > parent; //index of parent (always less than own index), or NoParent
+		std::vector< glm::vec3 > position;
+		std::vector< glm::quat > rotation;
+		std::vector< glm::vec3 > scale;
+		std::vector< glm::mat4x3 > world_from_local;
+		std::vector< uint8_t > changed; //(scratch) world_from_local was rebuilt in the latest update
+	};
+	mutable Hierarchy hierarchy;
+
+	//bring 'hierarchy' up to date with 'transforms'; returns the number of world matrices that needed rebuilding.
+	// (only re-sorts if transforms were added, removed, or re-parented; called by draw())
+	uint32_t update_hierarchy() const;
+
+	//world matrix of a transform, as of the last update_hierarchy():
+	// throws if the transform isn't in the hierarchy (e.g., it was added since the last update_hierarchy())
+	glm::mat4x3 const &world_from_local(Transform const &transform) const;
+
 	//The "draw" function provides a convenient way to pass all the things in a scene to OpenGL:
+	// drawables whose bounds are outside the view are skipped;
+	// the rest are sorted by program, vertex array, and texture (then near-to-far), not drawn in list order,
+	// so a pipeline's set_uniforms() should only set uniforms (not change bindings).
 	void draw(Camera const &camera) const;
 
 	//..sometimes, you want to draw with a custom projection matrix and/or light space:
 	void draw(glm::mat4 const &clip_from_world, glm::mat4x3 const &light_from_world = glm::mat4x3(1.0f)) const;
 
+	//counts from the most recent draw(), for seeing how much state switching a scene needs:
+	struct DrawStats {
+		uint32_t draws = 0; //draw calls issued
+		uint32_t drawables = 0; //drawables drawn (more than 'draws' when instancing groups them)
+		uint32_t culled = 0; //drawables skipped because their bounds were outside the view
+		uint32_t program_binds = 0;
+		uint32_t vao_binds = 0;
+		uint32_t texture_binds = 0;
+		uint32_t transform_rebuilds = 0; //world matrices that had to be recomputed
+	};
+	mutable DrawStats draw_stats;
+
 	//add transforms/objects/cameras from a scene file to this scene:
 	// the 'on_drawable' callback gives your code a chance to look up mesh data and make Drawables:
 	// throws on file format errors
 	void load(std::string const &filename,
 		std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable = nullptr
 	);
+	//...same, from scene file contents already in memory (e.g. a Pack entry); 'filename' is only used in error messages:
+	void load(char const *data, size_t size, std::string const &filename,
+		std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable = nullptr
+	);
 
 	//this function is called to read extra chunks from the scene file after the main chunks are read:
 	// this is useful if you, e.g., subclassing scene to represent a game level/area
@@ -149,5 +213,6 @@ struct Scene {
 	Scene(Scene const &); //...as a constructor
 	Scene &operator=(Scene const &); //...as scene = scene
 	//... as a set() function that optionally returns the transform->transform mapping:
+	// (the copy's transforms are in parents-before-children order)
 	void set(Scene const &, std::unordered_map< Transform const *, Transform * > *transform_map = nullptr);
 };
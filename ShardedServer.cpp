@@ -0,0 +1,328 @@
+#include "ShardedServer.hpp"
+
+#include "SPSCQueue.hpp"
+#include "message_codec.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <chrono>
+#include <iterator>
+#include <stdexcept>
+#include <cassert>
+
+//I/O thread -> simulation:
+struct InboundEvent {
+	uint64_t id = 0;
+	Connection::Event event = Connection::OnOpen;
+	Socket socket = InvalidSocket; //(OnOpen only; so stand-ins print like real connections)
+	std::vector< uint8_t > frames; //(OnRecv only) one or more complete frames
+};
+
+//simulation -> I/O thread:
+struct OutboundCommand {
+	uint64_t id = 0;
+	std::vector< uint8_t > data; //append to the connection's send_buffer
+	std::vector< std::pair< size_t, size_t > > droppable; //droppable frame ranges within 'data'
+	bool close = false; //close the connection (after the data above has been queued)
+};
+
+//entries in each direction's queue, per shard:
+static constexpr size_t QueueSize = 8192;
+//how long an idle I/O thread waits in poll() before checking for commands from the simulation:
+static constexpr double IOPollTimeout = 0.001;
+//how long the simulation thread sleeps between checks while waiting for events:
+static constexpr auto WaitStep = std::chrono::microseconds(200);
+
+//connection ids are (counter << ShardBits) | shard index:
+static constexpr uint32_t ShardBits = 8;
+static constexpr uint64_t ShardMask = (uint64_t(1) << ShardBits) - 1;
+
+struct ShardedServer::Shard {
+	Shard(uint32_t index_, std::string const &port, SocketOptions const &options, Server::SendLimits const &limits)
+		: index(index_), server(port, options), inbound(QueueSize), outbound(QueueSize), backlog_limit(limits.hard_limit) {
+		server.send_limits = limits;
+	}
+
+	uint32_t index;
+	Server server; //(only touched by the I/O thread once it has started)
+	SPSCQueue< InboundEvent > inbound;
+	SPSCQueue< OutboundCommand > outbound;
+	std::thread thread;
+
+	//I/O thread's view of its connections:
+	std::unordered_map< uint64_t, Connection * > by_id;
+	std::unordered_map< Connection const *, uint64_t > ids;
+	uint64_t next_counter = 1;
+	std::deque< InboundEvent > backlog; //events still waiting for room in 'inbound'
+	std::unordered_map< uint64_t, size_t > backlog_bytes; //received bytes per connection waiting in 'backlog'
+	size_t backlog_limit = 0; //backlog_bytes at which a connection is closed (0 = unlimited; see Server::SendLimits::hard_limit)
+
+	//copy of server.stats, published by the I/O thread for the simulation thread:
+	std::mutex stats_mutex;
+	Server::Stats stats;
+
+	void run(std::atomic< bool > const &quit);
+	void post(InboundEvent &&event);
+	void forget(Connection const *c);
+	void enforce_backlog_limit(Connection *c, uint64_t id);
+};
+
+void ShardedServer::Shard::post(InboundEvent &&event) {
+	if (backlog.empty() && inbound.try_push(std::move(event))) return;
+
+	//simulation is behind; hold on to the event (merging runs of data from the same connection):
+	if (event.event == Connection::OnRecv) backlog_bytes[event.id] += event.frames.size();
+	if (event.event == Connection::OnRecv && !backlog.empty()
+	 && backlog.back().event == Connection::OnRecv && backlog.back().id == event.id) {
+		auto &frames = backlog.back().frames;
+		frames.insert(frames.end(), event.frames.begin(), event.frames.end());
+	} else {
+		backlog.emplace_back(std::move(event));
+	}
+}
+
+//a connection whose data has piled up waiting for the simulation is closed, same as one whose send queue has (see enforce_send_limits in Connection.cpp):
+void ShardedServer::Shard::enforce_backlog_limit(Connection *c, uint64_t id) {
+	if (backlog_limit == 0) return;
+	auto f = backlog_bytes.find(id);
+	if (f == backlog_bytes.end() || f->second <= backlog_limit) return;
+
+	std::cerr << "[ShardedServer] connection " << c->socket << " has " << f->second << " received bytes waiting for the simulation (limit " << backlog_limit << "), disconnecting." << std::endl;
+	server.stats.limit_disconnects += 1;
+
+	//its data will never be read, so don't keep it around:
+	backlog.erase(std::remove_if(backlog.begin(), backlog.end(), [id](InboundEvent const &event) {
+		return event.id == id && event.event == Connection::OnRecv;
+	}), backlog.end());
+	backlog_bytes.erase(f);
+
+	forget(c);
+	c->close();
+
+	InboundEvent event;
+	event.id = id;
+	event.event = Connection::OnClose;
+	post(std::move(event));
+}
+
+void ShardedServer::Shard::forget(Connection const *c) {
+	auto f = ids.find(c);
+	if (f == ids.end()) return;
+	by_id.erase(f->second);
+	ids.erase(f);
+}
+
+void ShardedServer::Shard::run(std::atomic< bool > const &quit) {
+	auto on_event = [this](Connection *c, Connection::Event evt) {
+		InboundEvent event;
+		event.event = evt;
+		if (evt == Connection::OnOpen) {
+			event.id = (next_counter++ << ShardBits) | index;
+			event.socket = c->socket;
+			by_id.emplace(event.id, c);
+			ids.emplace(c, event.id);
+		} else {
+			auto f = ids.find(c);
+			if (f == ids.end()) return; //(already closed by the simulation)
+			event.id = f->second;
+		}
+
+		if (evt == Connection::OnRecv) {
+			//forward only complete frames, so the simulation never sees half a message:
+			size_t complete = 0;
+			uint8_t type = 0;
+			uint32_t size = 0;
+			while (peek_frame(c->recv_buffer.data() + complete, c->recv_buffer.size() - complete, &type, &size)
+			    && c->recv_buffer.size() - complete - FrameHeaderSize >= size) {
+				complete += FrameHeaderSize + size;
+			}
+			if (complete == 0) return;
+			event.frames.assign(c->recv_buffer.begin(), c->recv_buffer.begin() + complete);
+			c->recv_buffer.erase(c->recv_buffer.begin(), c->recv_buffer.begin() + complete);
+		} else if (evt == Connection::OnClose) {
+			forget(c);
+		}
+
+		uint64_t id = event.id;
+		post(std::move(event));
+		if (evt == Connection::OnRecv) enforce_backlog_limit(c, id);
+	};
+
+	while (!quit.load(std::memory_order_relaxed)) {
+		//apply commands from the simulation:
+		bool queued = false;
+		OutboundCommand command;
+		while (outbound.try_pop(&command)) {
+			auto f = by_id.find(command.id);
+			if (f == by_id.end()) continue; //(closed on this side; the simulation will hear about it)
+			Connection &c = *f->second;
+
+			if (!command.data.empty()) {
+				size_t base = c.send_buffer.size();
+				c.send_buffer.insert(c.send_buffer.end(), command.data.begin(), command.data.end());
+				for (auto const &[begin, end] : command.droppable) {
+					c.droppable.emplace_back(base + begin, base + end);
+				}
+				queued = true;
+			}
+			if (command.close) {
+				forget(&c);
+				c.close();
+			}
+		}
+
+		//(don't sit in poll() when there is fresh data to send)
+		server.poll(on_event, queued ? 0.0 : IOPollTimeout);
+
+		while (!backlog.empty()) {
+			uint64_t id = backlog.front().id;
+			size_t bytes = backlog.front().frames.size();
+			if (!inbound.try_push(std::move(backlog.front()))) break;
+			backlog.pop_front();
+			if (bytes != 0) {
+				auto f = backlog_bytes.find(id);
+				assert(f != backlog_bytes.end() && f->second >= bytes);
+				f->second -= bytes;
+				if (f->second == 0) backlog_bytes.erase(f);
+			}
+		}
+
+		//(never wait on the simulation thread just to report stats)
+		if (stats_mutex.try_lock()) {
+			stats = server.stats;
+			stats_mutex.unlock();
+		}
+	}
+
+	for (auto &c : server.connections) {
+		c.close();
+	}
+}
+
+//---------------------------------
+
+ShardedServer::ShardedServer(std::string const &port, uint32_t io_threads, SocketOptions const &options, Server::SendLimits const &limits) {
+	if (io_threads == 0 || io_threads > ShardMask + 1) {
+		throw std::runtime_error("ShardedServer needs between 1 and " + std::to_string(ShardMask + 1) + " I/O threads (not " + std::to_string(io_threads) + ").");
+	}
+
+	//every shard listens on the same port:
+	// (the kernel spreading connections evenly between the listeners is linux behavior; elsewhere one shard may end up with most of them)
+	SocketOptions shard_options = options;
+	if (io_threads > 1) shard_options.reuse_port = true;
+
+	//bind everything before starting any threads, so a failure doesn't leave threads running:
+	for (uint32_t i = 0; i < io_threads; ++i) {
+		shards.emplace_back(std::make_unique< Shard >(i, port, shard_options, limits));
+	}
+	for (auto &shard : shards) {
+		Shard *s = shard.get();
+		s->thread = std::thread([this, s]() { s->run(quit); });
+	}
+}
+
+ShardedServer::~ShardedServer() {
+	quit = true;
+	for (auto &shard : shards) {
+		if (shard->thread.joinable()) shard->thread.join();
+	}
+}
+
+void ShardedServer::poll(std::function< void(Connection *, Connection::Event event) > const &on_event, double timeout) {
+	//hand queued data and closes to the owning I/O threads:
+	auto hand_off = [this]() {
+		for (auto c = connections.begin(); c != connections.end(); /*later*/) {
+			auto old = c;
+			++c;
+			uint64_t id = ids.at(&*old);
+			Shard &shard = *shards[id & ShardMask];
+
+			bool closed = !*old;
+			if (!closed && old->send_buffer.empty()) continue;
+
+			OutboundCommand command;
+			command.id = id;
+			command.data = std::move(old->send_buffer);
+			command.droppable = std::move(old->droppable);
+			command.close = closed;
+			if (!shard.outbound.try_push(std::move(command))) {
+				//queue is full; keep everything for next time:
+				old->send_buffer = std::move(command.data);
+				old->droppable = std::move(command.droppable);
+				continue;
+			}
+			old->send_buffer.clear();
+			old->droppable.clear();
+
+			if (closed) {
+				by_id.erase(id);
+				ids.erase(&*old);
+				connections.erase(old);
+			}
+		}
+	};
+
+	hand_off();
+
+	//report events from the I/O threads (waiting up to 'timeout' for the first one):
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast< std::chrono::steady_clock::duration >(std::chrono::duration< double >(timeout));
+	while (true) {
+		bool any = false;
+		for (auto &shard : shards) {
+			//(at most a queue's worth per shard, so a busy shard can't keep poll() from returning)
+			InboundEvent event;
+			for (size_t count = 0; count < QueueSize && shard->inbound.try_pop(&event); ++count) {
+				any = true;
+				if (event.event == Connection::OnOpen) {
+					connections.emplace_back();
+					Connection &c = connections.back();
+					c.socket = event.socket;
+					c.owns_socket = false;
+					by_id.emplace(event.id, std::prev(connections.end()));
+					ids.emplace(&c, event.id);
+					if (on_event) on_event(&c, Connection::OnOpen);
+					continue;
+				}
+
+				auto f = by_id.find(event.id);
+				if (f == by_id.end()) continue; //(stand-in already closed and reaped)
+				Connection &c = *f->second;
+
+				if (event.event == Connection::OnRecv) {
+					if (!c) continue; //(closed by the simulation since; close is on its way to the I/O thread)
+					c.recv_buffer.insert(c.recv_buffer.end(), event.frames.begin(), event.frames.end());
+					if (on_event) on_event(&c, Connection::OnRecv);
+				} else { assert(event.event == Connection::OnClose);
+					bool was_open = bool(c);
+					c.close();
+					if (was_open && on_event) on_event(&c, Connection::OnClose);
+					ids.erase(&c);
+					connections.erase(f->second);
+					by_id.erase(f);
+				}
+			}
+		}
+		if (any) break;
+
+		auto now = std::chrono::steady_clock::now();
+		if (now >= deadline) break;
+		std::this_thread::sleep_for(std::min< std::chrono::steady_clock::duration >(WaitStep, deadline - now));
+	}
+
+	//send anything queued (or closed) by the callbacks right away:
+	hand_off();
+
+	//gather stats:
+	stats = Server::Stats();
+	for (auto &shard : shards) {
+		std::lock_guard< std::mutex > lock(shard->stats_mutex);
+		stats.queued_bytes += shard->stats.queued_bytes;
+		stats.peak_queued_bytes = std::max(stats.peak_queued_bytes, shard->stats.peak_queued_bytes);
+		stats.dropped_frames += shard->stats.dropped_frames;
+		stats.dropped_bytes += shard->stats.dropped_bytes;
+		stats.limit_disconnects += shard->stats.limit_disconnects;
+	}
+}
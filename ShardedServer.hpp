@@ -0,0 +1,64 @@
+#pragma once
+
+/*
+ * ShardedServer spreads a server's connections over several I/O threads.
+ *
+ * Each I/O thread runs its own Server listening on the same port (via SO_REUSEPORT,
+ * so the OS load-balances new connections between them) and does all of the
+ * accept()/recv()/send() work for its connections.
+ *
+ * The simulation thread sees each remote connection as a stand-in 'Connection':
+ *  - its recv_buffer is filled with complete frames (see message_codec.hpp) read by the I/O thread
+ *  - anything appended to its send_buffer (including mark_droppable() ranges) is handed to the I/O thread on the next poll()
+ *  - close() on it closes the real connection
+ *  - if the simulation falls so far behind that more than limits.hard_limit received bytes are waiting for it, the
+ *    connection is closed (and counted in stats.limit_disconnects), just like one whose send queue grows that large
+ * The two sides only talk through single-producer/single-consumer queues, so neither waits on the other.
+ *
+ * It is a drop-in replacement for Server:
+
+ShardedServer server("1337", 4); //four I/O threads sharing port 1337
+while (true) {
+	server.poll([](Connection *connection, Connection::Event evt){
+		//...same as with Server...
+	}, 1.0);
+}
+
+ */
+
+#include "Connection.hpp"
+
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+
+struct ShardedServer {
+	//starts 'io_threads' I/O threads (SO_REUSEPORT is turned on when there is more than one):
+	ShardedServer(std::string const &port, uint32_t io_threads, SocketOptions const &options = SocketOptions(), Server::SendLimits const &limits = Server::SendLimits());
+	~ShardedServer(); //stops the I/O threads and closes all connections
+
+	ShardedServer(ShardedServer const &) = delete;
+	ShardedServer &operator=(ShardedServer const &) = delete;
+
+	//poll() hands queued sends to the I/O threads, then reports events the I/O threads have seen:
+	// (will wait up to 'timeout' for first event)
+	void poll(
+		std::function< void(Connection *, Connection::Event event) > const &connection_event = nullptr,
+		double timeout = 0.0 //timeout (seconds)
+	);
+
+	//stand-ins for the open connections (owned by the simulation thread):
+	std::list< Connection > connections;
+
+	//Totals over all I/O threads (as of the last poll; see Server::Stats):
+	Server::Stats stats;
+
+	//internals:
+	struct Shard;
+	std::vector< std::unique_ptr< Shard > > shards;
+	std::atomic< bool > quit{false};
+
+	//stand-in <-> connection id (ids are assigned by the I/O threads and say which shard owns the connection):
+	std::unordered_map< uint64_t, std::list< Connection >::iterator > by_id;
+	std::unordered_map< Connection const *, uint64_t > ids;
+};
@@ -0,0 +1,42 @@
+#include "ShelfPacker.hpp"
+
+ShelfPacker::ShelfPacker(glm::uvec2 size_, uint32_t padding_) : size(size_), padding(padding_) {
+}
+
+bool ShelfPacker::pack(glm::uvec2 want, glm::uvec2 *at) {
+	uint32_t w = want.x + 2 * padding;
+	uint32_t h = want.y + 2 * padding;
+	if (w > size.x) return false;
+
+	//best fit: the lowest shelf that is tall enough and wastes the least height:
+	Shelf *best = nullptr;
+	for (auto &shelf : shelves) {
+		if (shelf.height < h || shelf.x + w > size.x) continue;
+		if (!best || shelf.height < best->height) best = &shelf;
+	}
+
+	//don't put short things on very tall shelves if there's room for a new shelf:
+	if (best && best->height > h + h / 2 && used_height + h <= size.y) best = nullptr;
+
+	if (!best) {
+		if (used_height + h > size.y) return false;
+		shelves.emplace_back();
+		best = &shelves.back();
+		best->y = used_height;
+		best->height = h;
+		used_height += h;
+	}
+
+	*at = glm::uvec2(best->x + padding, best->y + padding);
+	best->x += w;
+	return true;
+}
+
+void ShelfPacker::grow(uint32_t new_height) {
+	if (new_height > size.y) size.y = new_height;
+}
+
+void ShelfPacker::clear() {
+	shelves.clear();
+	used_height = 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+/*
+ * ShelfPacker hands out rectangles in a fixed-width, growable-height atlas.
+ *
+ * Rectangles are placed left-to-right along horizontal "shelves"; a new shelf
+ * is opened above the last one when nothing fits. This wastes a little space
+ * compared to fancier packers, but is fast and does well when (as with sprites
+ * or glyphs) most rectangles have similar heights.
+ *
+ * ShelfPacker packer(glm::uvec2(1024, 1024));
+ * glm::uvec2 at;
+ * if (packer.pack(glm::uvec2(15, 15), &at)) { ...copy pixels to 'at'... }
+ * else { packer.grow(2048); ...enlarge texture and try again... }
+ */
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+struct ShelfPacker {
+	//'padding' empty pixels are kept around every rectangle (room for edge extrusion / filtering):
+	ShelfPacker(glm::uvec2 size, uint32_t padding = 1);
+
+	//find space for a 'size' rectangle; on success, writes its lower-left corner (inside the padding) to 'at'.
+	// returns false if the atlas is full:
+	bool pack(glm::uvec2 size, glm::uvec2 *at);
+
+	//make the atlas taller (existing rectangles stay where they are):
+	void grow(uint32_t new_height);
+
+	//forget all rectangles:
+	void clear();
+
+	glm::uvec2 size;
+	uint32_t padding;
+
+	struct Shelf {
+		uint32_t y = 0; //bottom of shelf
+		uint32_t height = 0; //(including padding)
+		uint32_t x = 0; //first free column
+	};
+	std::vector< Shelf > shelves;
+	uint32_t used_height = 0; //top of the last shelf
+};
@@ -28,6 +28,7 @@ ShowMeshesMode::ShowMeshesMode(MeshBuffer const &buffer_) : buffer(buffer_) {
 		scene_drawable->pipeline.type = GL_TRIANGLES;
 		scene_drawable->pipeline.start = 0;
 		scene_drawable->pipeline.count = 0;
+		scene_drawable->pipeline.index_type = GL_NONE;
 	}
 
 	//select first mesh in buffer:
@@ -165,6 +166,7 @@ void ShowMeshesMode::select_prev_mesh() {
 		scene_drawable->pipeline.type = f->second.type;
 		scene_drawable->pipeline.start = f->second.start;
 		scene_drawable->pipeline.count = f->second.count;
+		scene_drawable->pipeline.index_type = f->second.index_type;
 		current_mesh_min = f->second.min;
 		current_mesh_max = f->second.max;
 	} else {
@@ -172,6 +174,7 @@ void ShowMeshesMode::select_prev_mesh() {
 		scene_drawable->pipeline.type = GL_TRIANGLES;
 		scene_drawable->pipeline.start = 0;
 		scene_drawable->pipeline.count = 0;
+		scene_drawable->pipeline.index_type = GL_NONE;
 		current_mesh_min = glm::vec3(0.0f);
 		current_mesh_max = glm::vec3(0.0f);
 	}
@@ -197,6 +200,7 @@ void ShowMeshesMode::select_next_mesh() {
 		scene_drawable->pipeline.type = f->second.type;
 		scene_drawable->pipeline.start = f->second.start;
 		scene_drawable->pipeline.count = f->second.count;
+		scene_drawable->pipeline.index_type = f->second.index_type;
 		current_mesh_min = f->second.min;
 		current_mesh_max = f->second.max;
 	} else {
@@ -204,6 +208,7 @@ void ShowMeshesMode::select_next_mesh() {
 		scene_drawable->pipeline.type = GL_TRIANGLES;
 		scene_drawable->pipeline.start = 0;
 		scene_drawable->pipeline.count = 0;
+		scene_drawable->pipeline.index_type = GL_NONE;
 		current_mesh_min = glm::vec3(0.0f);
 		current_mesh_max = glm::vec3(0.0f);
 	}
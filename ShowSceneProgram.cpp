@@ -10,9 +10,8 @@ Load< ShowSceneProgram > show_scene_program(LoadTagEarly, []() -> ShowSceneProgr
 
 	show_scene_program_pipeline.program = ret->program;
 
-	show_scene_program_pipeline.CLIP_FROM_OBJECT_mat4 = ret->CLIP_FROM_OBJECT_mat4;
-	show_scene_program_pipeline.LIGHT_FROM_OBJECT_mat4x3 = ret->LIGHT_FROM_OBJECT_mat4x3;
-	show_scene_program_pipeline.LIGHT_FROM_NORMAL_mat3 = ret->LIGHT_FROM_NORMAL_mat3;
+	show_scene_program_pipeline.INSTANCES_samplerBuffer = ret->INSTANCES_samplerBuffer;
+	show_scene_program_pipeline.INSTANCE_BASE_int = ret->INSTANCE_BASE_int;
 
 	return ret;
 });
@@ -20,11 +19,10 @@ Load< ShowSceneProgram > show_scene_program(LoadTagEarly, []() -> ShowSceneProgr
 ShowSceneProgram::ShowSceneProgram() {
 	//Compile vertex and fragment shaders using the convenient 'gl_compile_program' helper function:
 	program = gl_compile_program(
-		//vertex shader:
+		//vertex shader (per-object matrices come from the instance buffer; layout described in Scene::Drawable::Pipeline):
 		"#version 330\n"
-		"uniform mat4 CLIP_FROM_OBJECT;\n"
-		"uniform mat4x3 LIGHT_FROM_OBJECT;\n"
-		"uniform mat3 LIGHT_FROM_NORMAL;\n"
+		"uniform samplerBuffer INSTANCES;\n"
+		"uniform int INSTANCE_BASE;\n"
 		"in vec4 Position;\n"
 		"in vec3 Normal;\n"
 		"in vec4 Color;\n"
@@ -34,6 +32,10 @@ ShowSceneProgram::ShowSceneProgram() {
 		"out vec4 color;\n"
 		"out vec2 texCoord;\n"
 		"void main() {\n"
+		"	int at = 10 * (INSTANCE_BASE + gl_InstanceID);\n"
+		"	mat4 CLIP_FROM_OBJECT = mat4(texelFetch(INSTANCES, at+0), texelFetch(INSTANCES, at+1), texelFetch(INSTANCES, at+2), texelFetch(INSTANCES, at+3));\n"
+		"	mat4x3 LIGHT_FROM_OBJECT = transpose(mat3x4(texelFetch(INSTANCES, at+4), texelFetch(INSTANCES, at+5), texelFetch(INSTANCES, at+6)));\n"
+		"	mat3 LIGHT_FROM_NORMAL = mat3(texelFetch(INSTANCES, at+7).xyz, texelFetch(INSTANCES, at+8).xyz, texelFetch(INSTANCES, at+9).xyz);\n"
 		"	gl_Position = CLIP_FROM_OBJECT * Position;\n"
 		"	position = LIGHT_FROM_OBJECT * Position;\n"
 		"	normal = LIGHT_FROM_NORMAL * Normal;\n"
@@ -80,9 +82,8 @@ ShowSceneProgram::ShowSceneProgram() {
 	TexCoord_vec2 = glGetAttribLocation(program, "TexCoord");
 
 	//look up the locations of uniforms:
-	CLIP_FROM_OBJECT_mat4 = glGetUniformLocation(program, "CLIP_FROM_OBJECT");
-	LIGHT_FROM_OBJECT_mat4x3 = glGetUniformLocation(program, "LIGHT_FROM_OBJECT");
-	LIGHT_FROM_NORMAL_mat3 = glGetUniformLocation(program, "LIGHT_FROM_NORMAL");
+	INSTANCES_samplerBuffer = glGetUniformLocation(program, "INSTANCES");
+	INSTANCE_BASE_int = glGetUniformLocation(program, "INSTANCE_BASE");
 
 	INSPECT_MODE_int = glGetUniformLocation(program, "INSPECT_MODE");
 }
@@ -20,9 +20,9 @@ struct ShowSceneProgram {
 	GLuint TexCoord_vec2 = -1U;
 
 	//Uniform (per-invocation variable) locations:
-	GLuint CLIP_FROM_OBJECT_mat4 = -1U;
-	GLuint LIGHT_FROM_OBJECT_mat4x3 = -1U;
-	GLuint LIGHT_FROM_NORMAL_mat3 = -1U;
+	// (drawn instanced: object matrices are read from the INSTANCES buffer texture; see Scene::Drawable::Pipeline)
+	GLuint INSTANCES_samplerBuffer = -1U;
+	GLuint INSTANCE_BASE_int = -1U;
 
 	GLuint INSPECT_MODE_int = -1U; //0: basic lighting; 1: position only; 2: normal only; 3: color only; 4: texcoord only
 
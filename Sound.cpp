@@ -1,14 +1,46 @@
 #include "Sound.hpp"
 #include "load_wav.hpp"
 #include "load_opus.hpp"
+#include "SPSCQueue.hpp"
+#include "mix_span.hpp"
 
 #include <SDL3/SDL.h>
 
-#include <list>
+#include <vector>
 #include <cassert>
+#include <cstring>
 #include <exception>
 #include <iostream>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+//Streamed samples are decoded by a background thread into a ring buffer, which the mixer reads from:
+struct Sound::Stream {
+	Stream(Sample const &sample, bool loop_);
+
+	//decode into the ring until it is full (or 'budget' samples have been added); returns samples added:
+	// (called by only one thread at a time -- at first by play() on the game thread, and after that by the streaming thread)
+	uint32_t fill(uint32_t budget = -1U);
+
+	//decoder-side:
+	OpusStream decoder;
+	bool loop;
+	std::vector< float > pending; //decoded audio; [pending_begin,pending_end) didn't fit in the ring yet
+	uint32_t pending_begin = 0, pending_end = 0;
+	uint64_t decoded = 0; //samples decoded since the start of the file (to avoid looping forever on empty files)
+	uint32_t reported_underruns = 0;
+
+	//shared between decoder and mixer:
+	SPSCQueue< float > ring;
+	std::atomic< bool > finished{false}; //decoder has pushed everything it ever will
+	std::atomic< bool > abandoned{false}; //mixer is done playing this stream
+	std::atomic< uint32_t > underruns{0}; //number of mixes where the ring ran dry
+};
 
 //local (to this file) data used by the audio system:
 namespace {
@@ -19,26 +51,102 @@ namespace {
 	//The audio device:
 	SDL_AudioStream *stream = nullptr;
 
-	//list of all currently playing samples:
-	std::list< std::shared_ptr< Sound::PlayingSample > > playing_samples;
+	//voice limits:
+	constexpr uint32_t const VOICE_POOL_SIZE = 256; //PlayingSamples that can exist at once (playing, about to play, or still held by the game)
+	constexpr uint32_t const MAX_PLAYING = 128; //samples the mixer keeps track of (past this, new sounds steal from the least important)
+	constexpr uint32_t const MAX_MIXED = 32; //samples actually mixed each block (the rest are 'virtual': they keep time, but aren't heard)
+	constexpr float const INAUDIBLE = 0.001f; //samples with gains below this (-60dB) are always virtual
+
+	//PlayingSamples are allocated once and reused, so play() doesn't need to allocate:
+	// (built by Sound::init(); only used by game threads; guarded by pool_mutex)
+	std::mutex pool_mutex;
+	std::vector< std::shared_ptr< Sound::PlayingSample > > voice_pool;
+	uint32_t pool_next = 0; //where to start looking for a free voice
+	std::shared_ptr< Sound::PlayingSample > no_voice; //returned (already stopped) when every voice is busy
+
+	//list of all currently playing samples (audio callback only):
+	std::vector< std::shared_ptr< Sound::PlayingSample > > playing_samples;
+
+	//Commands carry changes from the game to the audio callback, which applies them at the start of each mix.
+	// (So neither side ever waits on the other, unlike with Sound::lock().)
+	struct Command {
+		enum Type : uint8_t {
+			Play, //start playing 'target'
+			SetVolume, SetPan, SetPosition, SetHalfVolumeRadius, SetRate, Stop, //change 'target' (value.x or value, over ramp)
+			StopAll, //stop every playing sample (over ramp)
+			SetGlobalVolume, //global_volume (value.x, over ramp)
+			SetListener, //listener_position (value) and listener_right (value2, over ramp)
+		} type = Play;
+		std::shared_ptr< Sound::PlayingSample > target;
+		glm::vec3 value = glm::vec3(0.0f);
+		glm::vec3 value2 = glm::vec3(0.0f);
+		float ramp = 0.0f;
+	};
+	SPSCQueue< Command > commands(1024);
+
+	//the queue has one producer, so posting from (possibly more than one) game thread is serialized by this mutex;
+	// the audio callback never takes it:
+	std::mutex post_mutex;
+
+	//commands that didn't fit in the queue yet, oldest first (guarded by post_mutex; sent along by post() and Sound::update()):
+	// (a fixed-size ring, so posting never allocates -- if it fills up too, the mixer has stalled and post() drops commands)
+	constexpr uint32_t const BACKLOG_SIZE = 1024;
+	std::array< Command, BACKLOG_SIZE > backlog;
+	uint32_t backlog_begin = 0, backlog_count = 0;
+
+	//global volume and listener (audio callback only -- the game changes them with Sound::set_volume() and Sound::listener):
+	Sound::Ramp< float > global_volume = Sound::Ramp< float >(1.0f);
+	Sound::Ramp< glm::vec3 > listener_position = Sound::Ramp< glm::vec3 >(0.0f);
+	Sound::Ramp< glm::vec3 > listener_right = Sound::Ramp< glm::vec3 >(1.0f, 0.0f, 0.0f); //unit vector pointing to the listener's right
+
+	//fraction of real time spent in mix_audio (see Sound::mix_load()):
+	std::atomic< float > recent_mix_load{0.0f};
+
+	//streamed samples keep this much decoded audio buffered (~0.7 seconds; 128k per playing stream):
+	constexpr uint32_t const STREAM_RING_SIZE = 32768;
+	//...of which this much is decoded by play() so playback can start right away:
+	constexpr uint32_t const STREAM_PREFILL = 4096;
+
+	//the streaming thread tops up the ring buffers of all playing streams:
+	std::thread streamer;
+	std::mutex streams_mutex; //guards 'streams' and 'streamer_quit'
+	std::condition_variable streams_cv;
+	std::vector< std::shared_ptr< Sound::Stream > > streams;
+	bool streamer_quit = false;
 
 }
 
 //public-facing data:
 
-//global volume control:
-Sound::Ramp< float > Sound::volume = Sound::Ramp< float >(1.0f);
-
-//global listener information:
+//global listener controls:
 Sound::Listener Sound::listener;
 
 //This audio-mixing callback is defined below:
 void mix_audio(void *, SDL_AudioStream *stream, int additional_amount, int total_amount);
 
+//...as is the streaming thread's main function:
+void stream_audio();
+
+//...and the helpers that pass commands from the game to the audio callback:
+bool post(Command &&command);
+void flush_backlog();
+void apply_commands();
+
+//...and the mixer's voice management helpers:
+void start_voice(std::shared_ptr< Sound::PlayingSample > &&voice);
+void finish_voice(Sound::PlayingSample &voice);
+bool play_shifted(Sound::PlayingSample &playing_sample, float rate, float rate_step, uint32_t count, float *out, uint32_t *produced);
+
 //------------------------ public-facing --------------------------------
 
-Sound::Sample::Sample(std::string const &filename) {
-	if (filename.size() >= 4 && filename.substr(filename.size()-4) == ".wav") {
+Sound::Sample::Sample(std::string const &filename, Storage storage) {
+	if (storage == Streamed) {
+		if (!(filename.size() >= 5 && filename.substr(filename.size()-5) == ".opus")) {
+			throw std::runtime_error("Sample '" + filename + "' can't be streamed -- only \".opus\" files can.");
+		}
+		OpusStream check(filename); //(throws if the file won't open)
+		stream_filename = filename;
+	} else if (filename.size() >= 4 && filename.substr(filename.size()-4) == ".wav") {
 		load_wav(filename, &data);
 	} else if (filename.size() >= 5 && filename.substr(filename.size()-5) == ".opus") {
 		load_opus(filename, &data);
@@ -50,15 +158,54 @@ Sound::Sample::Sample(std::string const &filename) {
 Sound::Sample::Sample(std::vector< float > const &data_) : data(data_) {
 }
 
+Sound::Sample::Sample(Pack::Audio const &audio) : data(audio.samples, audio.samples + audio.count) {
+}
+
+Sound::Sample::Sample(Pack const &pack, std::string const &name, Storage storage) {
+	bool opus = (name.size() >= 5 && name.substr(name.size()-5) == ".opus");
+	if (storage == Streamed && !opus) {
+		throw std::runtime_error("Sample '" + name + "' can't be streamed -- only \".opus\" files can.");
+	}
+	if (opus) {
+		ChunkBytes bytes = pack.lookup(name, "file").data;
+		if (storage == Streamed) {
+			OpusStream check(name, bytes.begin, bytes.size()); //(throws if the data isn't opus)
+			stream_filename = name;
+			stream_bytes = bytes;
+		} else {
+			load_opus(name, bytes.begin, bytes.size(), &data);
+		}
+	} else {
+		Pack::Audio audio = pack.audio(name); //(throws if there isn't decoded audio by that name)
+		data.assign(audio.samples, audio.samples + audio.count);
+	}
+}
+
 
 
 void Sound::init() {
+	//allocate every voice up front, so play() never does (this happens even without audio, since play() still hands out voices):
+	{
+		std::unique_lock< std::mutex > lock(pool_mutex);
+		if (voice_pool.empty()) {
+			voice_pool.reserve(VOICE_POOL_SIZE);
+			for (uint32_t v = 0; v < VOICE_POOL_SIZE; ++v) {
+				voice_pool.emplace_back(std::make_shared< Sound::PlayingSample >());
+			}
+			no_voice = std::make_shared< Sound::PlayingSample >();
+			no_voice->stopped = true;
+		}
+	}
+
 	if (!SDL_InitSubSystem(SDL_INIT_AUDIO)) {
 		std::cerr << "Failed to initialize SDL audio subsytem:\n" << SDL_GetError() << std::endl;
 		std::cerr << "  (Will continue without audio.)\n" << std::endl;
 		return;
 	}
 
+	//make sure the mixer's list never needs to grow:
+	playing_samples.reserve(MAX_PLAYING);
+
 	//Based on the example on https://wiki.libsdl.org/SDL_OpenAudioDevice
 	SDL_AudioSpec spec{ .format=SDL_AUDIO_F32, .channels=2, .freq=AUDIO_RATE };
 	stream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, mix_audio, nullptr);
@@ -79,6 +226,16 @@ void Sound::shutdown() {
 		SDL_DestroyAudioStream(stream);
 		stream = nullptr;
 	}
+	if (streamer.joinable()) {
+		//stop streaming:
+		{
+			std::unique_lock< std::mutex > lock(streams_mutex);
+			streamer_quit = true;
+		}
+		streams_cv.notify_one();
+		streamer.join();
+		streams.clear();
+	}
 }
 
 
@@ -90,114 +247,297 @@ void Sound::unlock() {
 	if (stream) SDL_UnlockAudioStream(stream);
 }
 
+//helper: take an unused PlayingSample from the pool (or return nullptr if there aren't any):
+static std::shared_ptr< Sound::PlayingSample > acquire_voice() {
+	std::unique_lock< std::mutex > lock(pool_mutex);
+	assert(!voice_pool.empty() && "Sound::init() builds the voice pool, so call it before playing anything");
+	for (uint32_t n = 0; n < voice_pool.size(); ++n) {
+		std::shared_ptr< Sound::PlayingSample > const &voice = voice_pool[pool_next];
+		pool_next = (pool_next + 1) % voice_pool.size();
+		//free if the mixer is done with it and nobody else (game code, queued commands, the mixer's list) holds it:
+		if (!voice->in_use.load(std::memory_order_acquire) && voice.use_count() == 1) {
+			voice->in_use.store(true, std::memory_order_relaxed);
+			return voice;
+		}
+	}
+	return nullptr;
+}
+
+//helper: set up a voice to play a sample ('pan' is NaN for 3D samples; 'position' and 'half_volume_radius' are NaN for 2D samples)
+// and hand it to the mixer (after starting its stream, if needed):
+static std::shared_ptr< Sound::PlayingSample > start_playing(Sound::Sample const &sample, float volume, float pan, glm::vec3 const &position, float half_volume_radius, bool loop) {
+	std::shared_ptr< Sound::PlayingSample > voice = acquire_voice();
+	if (!voice) return no_voice; //too many sounds already
+
+	//(nothing else refers to the voice, so it's safe to set up without the mixer's help)
+	voice->data = &sample.data;
+	voice->stream.reset();
+	voice->priority = sample.priority;
+	voice->i = 0;
+	voice->i_fraction = 0.0f;
+	voice->loop = loop;
+	voice->stopping = false;
+	voice->stopped.store(false, std::memory_order_relaxed);
+	voice->volume = Sound::Ramp< float >(volume);
+	voice->rate = Sound::Ramp< float >(1.0f);
+	voice->pan = Sound::Ramp< float >(pan);
+	voice->position = Sound::Ramp< glm::vec3 >(position);
+	voice->half_volume_radius = Sound::Ramp< float >(half_volume_radius);
+	voice->audibility = 0.0f;
+
+	if (!stream) {
+		//no audio device, so the sample is over before it starts:
+		voice->stopped.store(true, std::memory_order_relaxed);
+		voice->in_use.store(false, std::memory_order_release);
+		return voice;
+	}
+
+	if (!sample.stream_filename.empty()) {
+		auto s = std::make_shared< Sound::Stream >(sample, loop);
+		s->fill(STREAM_PREFILL); //decode a little right away so there's something to mix at once
+		voice->stream = s;
+
+		std::unique_lock< std::mutex > lock(streams_mutex);
+		if (!streamer.joinable()) {
+			streamer_quit = false;
+			streamer = std::thread(stream_audio);
+		}
+		streams.emplace_back(s);
+		lock.unlock();
+		streams_cv.notify_one();
+	}
+	if (!post(Command{ .type = Command::Play, .target = voice })) {
+		//mixer is too far behind to even hear about this sample:
+		finish_voice(*voice);
+	}
+	return voice;
+}
+
 std::shared_ptr< Sound::PlayingSample > Sound::play(Sample const &sample, float play_volume, float pan) {
-	std::shared_ptr< Sound::PlayingSample > playing_sample = std::make_shared< Sound::PlayingSample >(sample, play_volume, pan, false);
-	lock();
-	playing_samples.emplace_back(playing_sample);
-	unlock();
-	return playing_sample;
+	return start_playing(sample, play_volume, pan, glm::vec3(std::numeric_limits< float >::quiet_NaN()), std::numeric_limits< float >::quiet_NaN(), false);
 }
 
 std::shared_ptr< Sound::PlayingSample > Sound::play_3D(Sample const &sample, float play_volume, glm::vec3 const &position, float half_volume_radius) {
-	std::shared_ptr< Sound::PlayingSample > playing_sample = std::make_shared< Sound::PlayingSample >(sample, play_volume, position, half_volume_radius, false);
-	lock();
-	playing_samples.emplace_back(playing_sample);
-	unlock();
-	return playing_sample;
+	return start_playing(sample, play_volume, std::numeric_limits< float >::quiet_NaN(), position, half_volume_radius, false);
 }
 
 std::shared_ptr< Sound::PlayingSample > Sound::loop(Sample const &sample, float play_volume, float pan) {
-	std::shared_ptr< Sound::PlayingSample > playing_sample = std::make_shared< Sound::PlayingSample >(sample, play_volume, pan, true);
-	lock();
-	playing_samples.emplace_back(playing_sample);
-	unlock();
-	return playing_sample;
+	return start_playing(sample, play_volume, pan, glm::vec3(std::numeric_limits< float >::quiet_NaN()), std::numeric_limits< float >::quiet_NaN(), true);
 }
 
 
 
 std::shared_ptr< Sound::PlayingSample > Sound::loop_3D(Sample const &sample, float play_volume, glm::vec3 const &position, float half_volume_radius) {
-	std::shared_ptr< Sound::PlayingSample > playing_sample = std::make_shared< Sound::PlayingSample >(sample, play_volume, position, half_volume_radius, true);
-	lock();
-	playing_samples.emplace_back(playing_sample);
-	unlock();
-	return playing_sample;
+	return start_playing(sample, play_volume, std::numeric_limits< float >::quiet_NaN(), position, half_volume_radius, true);
 }
 
 
-void Sound::stop_all_samples() {
-	lock();
-	for (auto &s : playing_samples) {
-		s->stop();
-	}
-	unlock();
+bool Sound::stop_all_samples() {
+	return post(Command{ .type = Command::StopAll, .ramp = 1.0f / 60.0f });
+}
+
+void Sound::update() {
+	if (!stream) return;
+	std::unique_lock< std::mutex > lock(post_mutex);
+	flush_backlog();
+}
+
+float Sound::mix_load() {
+	return recent_mix_load.load(std::memory_order_relaxed);
 }
 
-void Sound::set_volume(float new_volume, float ramp) {
-	lock();
-	volume.set(new_volume, ramp);
-	unlock();
+bool Sound::set_volume(float new_volume, float ramp) {
+	return post(Command{ .type = Command::SetGlobalVolume, .value = glm::vec3(new_volume, 0.0f, 0.0f), .ramp = ramp });
 }
 
 //------------------
 
-void Sound::PlayingSample::set_volume(float new_volume, float ramp) {
-	Sound::lock();
-	if (!stopping) {
-		volume.set(new_volume, ramp);
-	}
-	Sound::unlock();
+bool Sound::PlayingSample::set_volume(float new_volume, float ramp) {
+	return post(Command{ .type = Command::SetVolume, .target = shared_from_this(), .value = glm::vec3(new_volume, 0.0f, 0.0f), .ramp = ramp });
 }
 
-void Sound::PlayingSample::set_pan(float new_pan, float ramp) {
-	if (!(pan.value == pan.value)) return; //ignore if not in '2D' mode
-	Sound::lock();
-	pan.set(new_pan, ramp);
-	Sound::unlock();
+bool Sound::PlayingSample::set_pan(float new_pan, float ramp) {
+	return post(Command{ .type = Command::SetPan, .target = shared_from_this(), .value = glm::vec3(new_pan, 0.0f, 0.0f), .ramp = ramp });
 }
 
-void Sound::PlayingSample::set_position(glm::vec3 const &new_position, float ramp) {
-	if (pan.value == pan.value) return; //ignore if not in '3D' mode
-	Sound::lock();
-	position.set(new_position, ramp);
-	Sound::unlock();
+bool Sound::PlayingSample::set_position(glm::vec3 const &new_position, float ramp) {
+	return post(Command{ .type = Command::SetPosition, .target = shared_from_this(), .value = new_position, .ramp = ramp });
 }
 
-void Sound::PlayingSample::set_half_volume_radius(float new_radius, float ramp) {
-	if (pan.value == pan.value) return; //ignore if not in '3D' mode
-	Sound::lock();
-	half_volume_radius.set(new_radius, ramp);
-	Sound::unlock();
+bool Sound::PlayingSample::set_half_volume_radius(float new_radius, float ramp) {
+	return post(Command{ .type = Command::SetHalfVolumeRadius, .target = shared_from_this(), .value = glm::vec3(new_radius, 0.0f, 0.0f), .ramp = ramp });
 }
 
-void Sound::PlayingSample::stop(float ramp) {
-	Sound::lock();
-	if (!(stopping || stopped)) {
-		stopping = true;
-		volume.target = 0.0f;
-		volume.ramp = ramp;
-	} else {
-		volume.ramp = std::min(volume.ramp, ramp);
-	}
-	Sound::unlock();
+bool Sound::PlayingSample::set_rate(float new_rate, float ramp) {
+	return post(Command{ .type = Command::SetRate, .target = shared_from_this(), .value = glm::vec3(new_rate, 0.0f, 0.0f), .ramp = ramp });
+}
+
+bool Sound::PlayingSample::stop(float ramp) {
+	return post(Command{ .type = Command::Stop, .target = shared_from_this(), .ramp = ramp });
 }
 
 //------------------
 
-void Sound::Listener::set_position_right(glm::vec3 const &new_position, glm::vec3 const &new_right, float ramp) {
-	Sound::lock();
-	position.set(new_position, ramp);
+bool Sound::Listener::set_position_right(glm::vec3 const &new_position, glm::vec3 const &new_right, float ramp) {
 	//some extra code to make sure right is always a unit vector:
-	if (new_right == glm::vec3(0.0f)) {
-		right.set(glm::vec3(1.0f, 0.0f, 0.0f), ramp);
-	} else {
-		right.set(glm::normalize(new_right), ramp);
+	glm::vec3 right = glm::vec3(1.0f, 0.0f, 0.0f);
+	if (new_right != glm::vec3(0.0f)) {
+		right = glm::normalize(new_right);
 	}
-	Sound::unlock();
+	return post(Command{ .type = Command::SetListener, .value = new_position, .value2 = right, .ramp = ramp });
 }
 
 //------------------------ internals --------------------------------
 
+Sound::Stream::Stream(Sample const &sample, bool loop_) : decoder(sample.stream_filename, sample.stream_bytes.begin, sample.stream_bytes.size()), loop(loop_), ring(STREAM_RING_SIZE) {
+	pending.resize(4096);
+}
+
+uint32_t Sound::Stream::fill(uint32_t budget) {
+	uint32_t added = 0;
+	while (added < budget && !finished.load(std::memory_order_relaxed)) {
+		if (pending_begin == pending_end) {
+			//decode some more:
+			pending_begin = 0;
+			pending_end = decoder.read(pending.data(), uint32_t(pending.size()));
+			decoded += pending_end;
+			if (pending_end == 0) {
+				if (loop && decoded != 0) {
+					//seamless loop: keep decoding from the start into the same ring:
+					decoder.rewind();
+					decoded = 0;
+					continue;
+				}
+				finished.store(true, std::memory_order_release);
+				break;
+			}
+		}
+		uint32_t count = std::min(budget - added, pending_end - pending_begin);
+		uint32_t pushed = uint32_t(ring.try_push_n(pending.data() + pending_begin, count));
+		pending_begin += pushed;
+		added += pushed;
+		if (pushed < count) break; //ring is full
+	}
+	return added;
+}
+
+//helper: fade out a playing sample (it is removed from playing_samples once silent):
+void stop_playing(Sound::PlayingSample &ps, float ramp) {
+	if (!(ps.stopping || ps.stopped)) {
+		ps.stopping = true;
+		ps.volume.target = 0.0f;
+		ps.volume.ramp = ramp;
+	} else {
+		ps.volume.ramp = std::min(ps.volume.ramp, ramp);
+	}
+}
+
+//helper: send a command to the audio callback (without waiting for it);
+// returns false (and drops the command) if neither the queue nor the backlog has room:
+bool post(Command &&command) {
+	if (!stream) return true; //no audio device, so no mixer to listen (nothing lost, though)
+
+	std::unique_lock< std::mutex > lock(post_mutex);
+	//first send anything left over from earlier, to keep commands in order:
+	flush_backlog();
+	if (backlog_count == 0 && commands.try_push(std::move(command))) return true;
+
+	//queue full? (the mixer must be very behind) hold on to the command until there's room:
+	if (backlog_count == BACKLOG_SIZE) return false;
+	backlog[(backlog_begin + backlog_count) % BACKLOG_SIZE] = std::move(command);
+	backlog_count += 1;
+	return true;
+}
+
+//helper: move as much of the backlog into the queue as fits (post_mutex must be held):
+void flush_backlog() {
+	while (backlog_count != 0 && commands.try_push(std::move(backlog[backlog_begin]))) {
+		backlog[backlog_begin] = Command(); //(drop the moved-from target reference right away)
+		backlog_begin = (backlog_begin + 1) % BACKLOG_SIZE;
+		backlog_count -= 1;
+	}
+}
+
+//helper: apply all commands posted since the last mix (called at the start of each mix):
+void apply_commands() {
+	Command command;
+	while (commands.try_pop(&command)) {
+		Sound::PlayingSample *target = command.target.get();
+		//ignore changes to samples that are already done (or never started):
+		if (target && !target->in_use.load(std::memory_order_relaxed)) continue;
+		bool in_3D = target && !(target->pan.value == target->pan.value); //(2D samples have a pan; 3D samples have NaN)
+		switch (command.type) {
+			case Command::Play:
+				start_voice(std::move(command.target));
+				break;
+			case Command::SetVolume:
+				if (!target->stopping) target->volume.set(command.value.x, command.ramp);
+				break;
+			case Command::SetPan:
+				if (!in_3D) target->pan.set(command.value.x, command.ramp);
+				break;
+			case Command::SetPosition:
+				if (in_3D) target->position.set(command.value, command.ramp);
+				break;
+			case Command::SetHalfVolumeRadius:
+				if (in_3D) target->half_volume_radius.set(command.value.x, command.ramp);
+				break;
+			case Command::SetRate:
+				target->rate.set(std::max(0.0f, command.value.x), command.ramp);
+				break;
+			case Command::Stop:
+				stop_playing(*target, command.ramp);
+				break;
+			case Command::StopAll:
+				for (auto &ps : playing_samples) {
+					stop_playing(*ps, command.ramp);
+				}
+				break;
+			case Command::SetGlobalVolume:
+				global_volume.set(command.value.x, command.ramp);
+				break;
+			case Command::SetListener:
+				listener_position.set(command.value, command.ramp);
+				listener_right.set(command.value2, command.ramp);
+				break;
+		}
+	}
+}
+
+//The streaming thread -- keeps every playing stream decoded a bit ahead of the mixer:
+void stream_audio() {
+	std::unique_lock< std::mutex > lock(streams_mutex);
+	while (!streamer_quit) {
+		//decode without holding the lock, so play() doesn't wait on the decoder:
+		std::vector< std::shared_ptr< Sound::Stream > > active = streams;
+		lock.unlock();
+		for (auto const &s : active) {
+			if (s->abandoned.load(std::memory_order_acquire)) continue;
+			try {
+				s->fill();
+			} catch (std::exception const &e) {
+				std::cerr << "WARNING: stopping stream of '" << s->decoder.filename << "' after error:\n" << e.what() << std::endl;
+				s->finished.store(true, std::memory_order_release);
+			}
+			uint32_t underruns = s->underruns.load(std::memory_order_relaxed);
+			if (underruns != s->reported_underruns) {
+				std::cerr << "WARNING: stream of '" << s->decoder.filename << "' ran dry (" << underruns << " time" << (underruns == 1 ? "" : "s") << " so far)." << std::endl;
+				s->reported_underruns = underruns;
+			}
+		}
+		active.clear();
+		lock.lock();
+
+		//forget streams that have nothing left to do:
+		streams.erase(std::remove_if(streams.begin(), streams.end(), [](std::shared_ptr< Sound::Stream > const &s){
+			return s->abandoned.load(std::memory_order_acquire) || s->finished.load(std::memory_order_acquire);
+		}), streams.end());
+
+		//the ring holds ~0.7 seconds, so checking in every 10ms leaves plenty of slack:
+		streams_cv.wait_for(lock, std::chrono::milliseconds(10));
+	}
+}
+
 
 //helper: equal-power panning
 inline void compute_pan_weights(float pan, float *left, float *right) {
@@ -300,11 +640,125 @@ void step_direction_ramp(float step, Sound::Ramp< glm::vec3 > &ramp) {
 }
 
 
+//helper: left/right gains for a playing sample, given the global volume and listener:
+void compute_gains(Sound::PlayingSample const &playing_sample, float global_volume, glm::vec3 const &listener_position, glm::vec3 const &listener_right, float *left, float *right) {
+	if (!(playing_sample.pan.value == playing_sample.pan.value)) {
+		//3D panning
+		compute_pan_from_listener_and_position(
+			listener_position, listener_right,
+			playing_sample.position.value,
+			playing_sample.half_volume_radius.value,
+			left, right);
+	} else {
+		//2D panning
+		compute_pan_weights(playing_sample.pan.value, left, right);
+	}
+	*left *= global_volume * playing_sample.volume.value;
+	*right *= global_volume * playing_sample.volume.value;
+}
+
+//helper: which sample to give up first when there are too many -- lower priority, then quieter:
+bool less_important(Sound::PlayingSample const &a, Sound::PlayingSample const &b) {
+	if (a.priority != b.priority) return a.priority < b.priority;
+	return a.audibility < b.audibility;
+}
+
+//helper: mark a sample as done (the caller removes it from playing_samples):
+void finish_voice(Sound::PlayingSample &voice) {
+	voice.stopped.store(true, std::memory_order_relaxed);
+	if (voice.stream) voice.stream->abandoned.store(true, std::memory_order_release);
+	voice.in_use.store(false, std::memory_order_release); //(after this, the mixer doesn't touch it; see acquire_voice())
+}
+
+//helper: add a sample to playing_samples (stealing the place of a less important one if the list is full):
+void start_voice(std::shared_ptr< Sound::PlayingSample > &&voice) {
+	float left, right;
+	compute_gains(*voice, global_volume.value, listener_position.value, listener_right.value, &left, &right);
+	voice->audibility = std::max(left, right);
+
+	if (playing_samples.size() < MAX_PLAYING) {
+		playing_samples.emplace_back(std::move(voice));
+		return;
+	}
+
+	auto weakest = std::min_element(playing_samples.begin(), playing_samples.end(), [](auto const &a, auto const &b) {
+		return less_important(*a, *b);
+	});
+	if (less_important(*voice, **weakest)) {
+		//new sample is the least important of all, so it doesn't get to play:
+		finish_voice(*voice);
+	} else {
+		finish_voice(**weakest);
+		*weakest = std::move(voice);
+	}
+}
+
+//helper: play a sample at a rate other than 1.0 --
+// writes 'count' samples (or fewer, if a non-looping sample runs out) into 'out' using cubic (Hermite) interpolation,
+// with the rate starting at 'rate' and changing by 'rate_step' each sample;
+// if 'out' is null (for virtual samples) just moves the position along; returns true if the sample ran out:
+bool play_shifted(Sound::PlayingSample &playing_sample, float rate, float rate_step, uint32_t count, float *out, uint32_t *produced) {
+	std::vector< float > const &data = *playing_sample.data;
+	int64_t size = int64_t(data.size());
+	assert(playing_sample.i < size);
+	*produced = 0;
+
+	//helper: move position to 'next' (which may be past the end); returns false if playback is over:
+	auto move_to = [&](int64_t next) {
+		if (next >= size) {
+			if (!playing_sample.loop) return false;
+			next %= size;
+		}
+		playing_sample.i = uint32_t(next);
+		return true;
+	};
+
+	if (!out) {
+		//the rate changes linearly, so distance moved is count * (average rate):
+		double advance = double(playing_sample.i_fraction) + double(count) * double(rate) + double(rate_step) * double(count) * double(count - 1) * 0.5;
+		double whole = std::floor(advance);
+		playing_sample.i_fraction = float(advance - whole);
+		return !move_to(int64_t(playing_sample.i) + int64_t(whole));
+	}
+
+	//sample value at (possibly out-of-range) index:
+	auto at = [&](int64_t k) -> float {
+		if (playing_sample.loop) {
+			k %= size;
+			return data[k < 0 ? k + size : k];
+		}
+		return (k >= 0 && k < size ? data[k] : 0.0f);
+	};
+
+	for (uint32_t n = 0; n < count; ++n) {
+		int64_t i = playing_sample.i;
+		float t = playing_sample.i_fraction;
+		float y0 = at(i - 1), y1 = data[i], y2 = at(i + 1), y3 = at(i + 2);
+		float c1 = 0.5f * (y2 - y0);
+		float c2 = y0 - 2.5f * y1 + 2.0f * y2 - 0.5f * y3;
+		float c3 = 0.5f * (y3 - y0) + 1.5f * (y1 - y2);
+		out[n] = ((c3 * t + c2) * t + c1) * t + y1;
+		*produced = n + 1;
+
+		playing_sample.i_fraction += rate;
+		rate += rate_step;
+		float whole = std::floor(playing_sample.i_fraction);
+		playing_sample.i_fraction -= whole;
+		if (!move_to(i + int64_t(whole))) return true;
+	}
+	return false;
+}
+
 //The audio callback -- invoked by SDL when it needs more sound to play:
 void SDLCALL mix_audio(void *, SDL_AudioStream *stream_, int additional_amount, int total_amount) {
 	if (total_amount <= 0) return;
 	assert(stream_ == stream && "callback should only be used with our main stream");
 
+	auto before = std::chrono::steady_clock::now();
+
+	//pick up changes from the game:
+	apply_commands();
+
 	struct LR {
 		float l;
 		float r;
@@ -320,109 +774,191 @@ void SDLCALL mix_audio(void *, SDL_AudioStream *stream_, int additional_amount,
 	LR *buffer = reinterpret_cast< LR * >(buffer_);
 
 	//zero the output buffer:
-	for (uint32_t s = 0; s < samples; ++s) {
-		buffer[s].l = 0.0f;
-		buffer[s].r = 0.0f;
-	}
+	std::memset(buffer, 0, len);
 
 	//update global values:
-	float start_volume = Sound::volume.value;
-	glm::vec3 start_position =  Sound::listener.position.value;
-	glm::vec3 start_right =  Sound::listener.right.value;
+	float start_volume = global_volume.value;
+	glm::vec3 start_position =  listener_position.value;
+	glm::vec3 start_right =  listener_right.value;
 
 	const float elapsed = samples / float(AUDIO_RATE);
 
-	step_value_ramp(elapsed, Sound::volume);
-	step_position_ramp(elapsed, Sound::listener.position);
-	step_direction_ramp(elapsed, Sound::listener.right);
-
-	float end_volume = Sound::volume.value;
-	glm::vec3 end_position =  Sound::listener.position.value;
-	glm::vec3 end_right =  Sound::listener.right.value;
+	step_value_ramp(elapsed, global_volume);
+	step_position_ramp(elapsed, listener_position);
+	step_direction_ramp(elapsed, listener_right);
+
+	float end_volume = global_volume.value;
+	glm::vec3 end_position =  listener_position.value;
+	glm::vec3 end_right =  listener_right.value;
+
+	//Mixing happens in three passes:
+	// first, each playing sample's ramps are stepped, and its gains for this block are worked out;
+	// then the (at most MAX_MIXED) most important audible samples have their audio gathered into contiguous spans,
+	//  while the others ('virtual' samples) just move their playback position along;
+	// finally, the spans are mixed into the buffer by mix_span().
+	//Per-sample gains and spans are kept as structure-of-arrays (and reused between calls), so later passes just walk arrays:
+	static struct {
+		std::vector< float > gain_l, gain_r; //gain at the first sample of the block
+		std::vector< float > step_l, step_r; //gain change per sample
+		std::vector< float > rate, rate_step; //playback rate at the first sample, and change per sample
+		std::vector< uint8_t > shifted; //is this sample playing at a rate other than 1.0 (and so needs interpolation)?
+		std::vector< uint8_t > mixed; //is this sample heard this block?
+		void resize(size_t size) {
+			gain_l.resize(size); gain_r.resize(size); step_l.resize(size); step_r.resize(size);
+			rate.resize(size); rate_step.resize(size); shifted.resize(size);
+			mixed.assign(size, 0);
+		}
+	} voices;
+	voices.resize(playing_samples.size());
+
+	static struct {
+		std::vector< float const * > src; //source samples
+		std::vector< uint32_t > begin; //first output sample
+		std::vector< uint32_t > count; //number of samples
+		std::vector< float > gain_l, gain_r; //gain at the first sample
+		std::vector< float > step_l, step_r; //gain change per sample
+		void clear() {
+			src.clear(); begin.clear(); count.clear();
+			gain_l.clear(); gain_r.clear(); step_l.clear(); step_r.clear();
+		}
+	} spans;
+	spans.clear();
 
-	//add audio from each playing sample into the buffer:
-	for (auto si = playing_samples.begin(); si != playing_samples.end(); /* later */) {
-		Sound::PlayingSample &playing_sample = **si; //much more convenient than writing ** everywhere.
+	//(1) step ramps and compute gains:
+	static std::vector< uint32_t > audible; //indices of samples loud enough to hear
+	audible.clear();
+	for (uint32_t si = 0; si < playing_samples.size(); ++si) {
+		Sound::PlayingSample &playing_sample = *playing_samples[si];
 
 		//Figure out sample panning/volume at start...
 		LR start_pan;
-		if (!(playing_sample.pan.value == playing_sample.pan.value)) {
-			//3D panning
-			compute_pan_from_listener_and_position(
-				start_position, start_right,
-				playing_sample.position.value,
-				playing_sample.half_volume_radius.value,
-				&start_pan.l, &start_pan.r);
+		compute_gains(playing_sample, start_volume, start_position, start_right, &start_pan.l, &start_pan.r);
 
+		if (!(playing_sample.pan.value == playing_sample.pan.value)) {
 			step_position_ramp(elapsed, playing_sample.position);
 			step_value_ramp(elapsed, playing_sample.half_volume_radius);
 		} else {
-			//2D panning
-			compute_pan_weights(playing_sample.pan.value, &start_pan.l, &start_pan.r);
-
 			step_value_ramp(elapsed, playing_sample.pan);
 		}
-		start_pan.l *= start_volume * playing_sample.volume.value;
-		start_pan.r *= start_volume * playing_sample.volume.value;
-
 		step_value_ramp(elapsed, playing_sample.volume);
 
+		float start_rate = playing_sample.rate.value;
+		step_value_ramp(elapsed, playing_sample.rate);
+		voices.rate[si] = start_rate;
+		voices.rate_step[si] = (playing_sample.rate.value - start_rate) / samples;
+		voices.shifted[si] = !playing_sample.stream
+			&& !(start_rate == 1.0f && playing_sample.rate.value == 1.0f && playing_sample.i_fraction == 0.0f);
+
 		//..and end of the mix period:
 		LR end_pan;
-		if (!(playing_sample.pan.value == playing_sample.pan.value)) {
-			//3D panning
-			compute_pan_from_listener_and_position(
-				end_position, end_right,
-				playing_sample.position.value,
-				playing_sample.half_volume_radius.value,
-				&end_pan.l, &end_pan.r);
-		} else {
-			//2D panning
-			compute_pan_weights(playing_sample.pan.value, &end_pan.l, &end_pan.r);
-		}
-
-		end_pan.l *= end_volume * playing_sample.volume.value;
-		end_pan.r *= end_volume * playing_sample.volume.value;
+		compute_gains(playing_sample, end_volume, end_position, end_right, &end_pan.l, &end_pan.r);
 
 		//figure out a step to add at each sample so that pan will move smoothly from start to end:
-		LR pan = start_pan;
-		LR pan_step;
-		pan_step.l = (end_pan.l - start_pan.l) / samples;
-		pan_step.r = (end_pan.r - start_pan.r) / samples;
-
-		assert(playing_sample.i < playing_sample.data.size());
-
-		for (uint32_t i = 0; i < samples; ++i) {
-			//mix one sample based on current pan values:
-			buffer[i].l += pan.l * playing_sample.data[playing_sample.i];
-			buffer[i].r += pan.r * playing_sample.data[playing_sample.i];
-
-			//update position in sample:
-			playing_sample.i += 1;
-			if (playing_sample.i == playing_sample.data.size()) {
-				if (playing_sample.loop) {
-					playing_sample.i = 0;
-				} else {
-					break;
+		voices.gain_l[si] = start_pan.l;
+		voices.gain_r[si] = start_pan.r;
+		voices.step_l[si] = (end_pan.l - start_pan.l) / samples;
+		voices.step_r[si] = (end_pan.r - start_pan.r) / samples;
+
+		playing_sample.audibility = std::max(std::max(start_pan.l, start_pan.r), std::max(end_pan.l, end_pan.r));
+		if (playing_sample.audibility >= INAUDIBLE) audible.emplace_back(si);
+	}
+
+	//(2a) pick which samples to hear -- if there are too many, keep the most important:
+	if (audible.size() > MAX_MIXED) {
+		std::nth_element(audible.begin(), audible.begin() + MAX_MIXED, audible.end(), [](uint32_t a, uint32_t b) {
+			return less_important(*playing_samples[b], *playing_samples[a]);
+		});
+		audible.resize(MAX_MIXED);
+	}
+	for (uint32_t si : audible) {
+		voices.mixed[si] = 1;
+	}
+
+	//streamed samples are copied out of their ring buffers (and rate-shifted samples are interpolated) into here:
+	// (one block per such sample)
+	static std::vector< float > scratch;
+	uint32_t scratch_blocks = 0;
+	for (uint32_t si = 0; si < playing_samples.size(); ++si) {
+		if (playing_samples[si]->stream || voices.shifted[si]) ++scratch_blocks;
+	}
+	if (scratch.size() < size_t(scratch_blocks) * samples) {
+		scratch.resize(size_t(scratch_blocks) * samples);
+	}
+	scratch_blocks = 0;
+
+	//(2b) gather audio from each heard sample, and move every sample along:
+	uint32_t kept = 0;
+	for (uint32_t si = 0; si < playing_samples.size(); ++si) {
+		Sound::PlayingSample &playing_sample = *playing_samples[si];
+		bool mixed = voices.mixed[si];
+
+		auto add_span = [&](float const *src, uint32_t begin, uint32_t count) {
+			if (!mixed) return; //(virtual sample)
+			spans.src.emplace_back(src);
+			spans.begin.emplace_back(begin);
+			spans.count.emplace_back(count);
+			spans.gain_l.emplace_back(voices.gain_l[si] + begin * voices.step_l[si]);
+			spans.gain_r.emplace_back(voices.gain_r[si] + begin * voices.step_r[si]);
+			spans.step_l.emplace_back(voices.step_l[si]);
+			spans.step_r.emplace_back(voices.step_r[si]);
+		};
+
+		bool finished = false;
+		if (playing_sample.stream) {
+			Sound::Stream &s = *playing_sample.stream;
+			float *block = scratch.data() + size_t(scratch_blocks) * samples;
+			scratch_blocks += 1;
+			//(check this *before* reading, so that a short read after the decoder finished really is the end)
+			bool decoder_finished = s.finished.load(std::memory_order_acquire);
+			uint32_t count = uint32_t(s.ring.try_pop_n(block, samples));
+			if (count < samples) {
+				if (decoder_finished) finished = true;
+				else s.underruns.fetch_add(1, std::memory_order_relaxed); //(streaming thread will complain about this)
+			}
+			if (count) add_span(block, 0, count);
+		} else if (voices.shifted[si]) {
+			float *block = scratch.data() + size_t(scratch_blocks) * samples;
+			scratch_blocks += 1;
+			uint32_t count = 0;
+			finished = play_shifted(playing_sample, voices.rate[si], voices.rate_step[si], samples, (mixed ? block : nullptr), &count);
+			if (count) add_span(block, 0, count);
+		} else {
+			//one span per contiguous run of sample data (looping samples may wrap around during the block):
+			std::vector< float > const &data = *playing_sample.data;
+			uint32_t at = 0;
+			while (at < samples) {
+				assert(playing_sample.i < data.size());
+				uint32_t count = std::min(samples - at, uint32_t(data.size()) - playing_sample.i);
+				add_span(data.data() + playing_sample.i, at, count);
+				at += count;
+				playing_sample.i += count;
+				if (playing_sample.i == data.size()) {
+					if (playing_sample.loop) {
+						playing_sample.i = 0;
+					} else {
+						finished = true;
+						break;
+					}
 				}
 			}
-
-			//update pan values:
-			pan.l += pan_step.l;
-			pan.r += pan_step.r;
 		}
 
-		if (playing_sample.i >= playing_sample.data.size()
+		if (finished
 		 || (playing_sample.stopping && playing_sample.volume.value == 0.0f)) { //sample has finished
-		 	playing_sample.stopped = true;
-			//erase from list:
-			auto old = si;
-			++si;
-			playing_samples.erase(old);
+			finish_voice(playing_sample);
+			//(removed from the list by not keeping it)
 		} else {
-			++si;
+			if (kept != si) playing_samples[kept] = std::move(playing_samples[si]);
+			++kept;
 		}
 	}
+	playing_samples.resize(kept);
+
+	//(3) mix everything heard:
+	float *out = reinterpret_cast< float * >(buffer);
+	for (uint32_t i = 0; i < spans.src.size(); ++i) {
+		mix_span(spans.src[i], spans.count[i], out + 2 * spans.begin[i], spans.gain_l[i], spans.gain_r[i], spans.step_l[i], spans.step_r[i]);
+	}
 
 	/*//DEBUG: report output power:
 	float max_power = 0.0f;
@@ -434,6 +970,9 @@ void SDLCALL mix_audio(void *, SDL_AudioStream *stream_, int additional_amount,
 
 	SDL_PutAudioStreamData(stream, buffer_, len);
 	SDL_stack_free(buffer_);
-}
-
 
+	//keep track of how much of the audio thread's time mixing takes:
+	float took = std::chrono::duration< float >(std::chrono::steady_clock::now() - before).count();
+	float load = recent_mix_load.load(std::memory_order_relaxed);
+	recent_mix_load.store(load + 0.1f * (took / elapsed - load), std::memory_order_relaxed); //(smoothed over the last ten-ish calls)
+}
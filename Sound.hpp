@@ -1,7 +1,10 @@
 #pragma once
 
+#include "Pack.hpp"
+
 #include <glm/glm.hpp>
 
+#include <atomic>
 #include <memory>
 #include <vector>
 #include <string>
@@ -14,17 +17,41 @@ namespace Sound {
 
 //Sample objects hold mono (one-channel) audio.
 struct Sample {
+	//how a file's audio is kept around:
+	enum Storage {
+		Decoded, //decode the whole file when loading (best for short effects)
+		Streamed, //decode while playing, just ahead of the mixer ('.opus' only; best for long music)
+	};
+
 	//Load from a '.wav' or '.opus' file.
 	//  will warn and convert if sound is not already 48kHz mono:
-	Sample(std::string const &filename);
+	Sample(std::string const &filename, Storage storage = Decoded);
 	
 	//Directly supply an audio buffer:
 	Sample(std::vector< float > const &data);
 
+	//Copy audio the bake tool already decoded ('f32m' pack entries, made from '.wav' files):
+	Sample(Pack::Audio const &audio);
+
+	//Load 'name' from a pack (see Pack.hpp): decoded audio is copied, and '.opus' files are decoded from the pack's mapping
+	//  -- as they play, if Streamed (in which case the pack must outlive every stream played from the sample):
+	Sample(Pack const &pack, std::string const &name, Storage storage = Decoded);
+
 	//sample data is stored as 48kHz, mono, floating-point:
 	std::vector< float > data;
+
+	//Streamed samples leave 'data' empty and decode from this file each time they are played:
+	std::string stream_filename;
+	//...or from these bytes (of a pack), if set:
+	ChunkBytes stream_bytes;
+
+	//when more sounds are playing than the mixer handles, lower-priority sounds are cut (or go unheard) first:
+	int32_t priority = 0;
 };
 
+//Stream holds the decoder and buffered audio for one playing Streamed sample (see Sound.cpp):
+struct Stream;
+
 //Ramp<> manages values that should be smoothly interpolated
 //  to a target over a certain amount of time:
 template< typename T >
@@ -49,30 +76,40 @@ struct Ramp {
 };
 
 // 'PlayingSample' objects book-keep samples that are currently playing:
-struct PlayingSample {
-	//change the panning or volume of a playing sample (and do proper locking);
-	// value will change over 'ramp' seconds to avoid creating audible artifacts:
-	void set_volume(float new_volume, float ramp = 1.0f / 60.0f);
+struct PlayingSample : std::enable_shared_from_this< PlayingSample > {
+	//change the panning or volume of a playing sample (these queue the change for the audio callback, which applies it at its next mix);
+	// value will change over 'ramp' seconds to avoid creating audible artifacts.
+	// (like all the functions that send changes to the audio callback, these return false if the change was dropped
+	//  because the callback has fallen thousands of changes behind -- see Sound::update())
+	bool set_volume(float new_volume, float ramp = 1.0f / 60.0f);
 	//set the panning of a sample (use only on samples in "2D" mode; no effect on "3D" samples):
-	void set_pan(float new_pan, float ramp = 1.0f / 60.0f);
+	bool set_pan(float new_pan, float ramp = 1.0f / 60.0f);
 	//set the position of a sample (use only on samples in "3D" mode; no effect on "2D" samples):
-	void set_position(glm::vec3 const &new_position, float ramp = 1.0f / 60.0f);
+	bool set_position(glm::vec3 const &new_position, float ramp = 1.0f / 60.0f);
 	//set the half-volume radius (use only on "3D" playing sounds):
-	void set_half_volume_radius(float new_radius, float ramp = 1.0f / 60.0f);
+	bool set_half_volume_radius(float new_radius, float ramp = 1.0f / 60.0f);
+
+	//set the playback rate (1.0 is normal speed; 2.0 is twice as fast and an octave higher; 0.5 is half as fast and an octave lower)
+	// -- has no effect on Streamed samples:
+	bool set_rate(float new_rate, float ramp = 1.0f / 60.0f);
 
 	//'stop' will fade sample out over 'ramp' seconds and then remove it from the active samples:
-	void stop(float ramp = 1.0f / 60.0f);
+	bool stop(float ramp = 1.0f / 60.0f);
 
 	//internals:
 	//NOTE: PlayingSample is used in a separate thread; so setting these values directly
-	// may result in bad results. Instead, use the functions above, which perform locking!
-	std::vector< float > const &data; //reference to sample data being played
+	// may result in bad results. Instead, use the functions above, which send changes to the audio thread!
+	std::vector< float > const *data = nullptr; //sample data being played
+	std::shared_ptr< Stream > stream; //where audio comes from instead, if playing a Streamed sample
+	int32_t priority = 0; //copied from the sample
 	uint32_t i = 0; //next data value to read
+	float i_fraction = 0.0f; //how far past 'i' playback is (only non-zero when playing at rates other than 1.0)
 	bool loop = false; //should playback loop after data runs out?
 	bool stopping = false; //is playing stopping?
-	bool stopped = false; //was playback stopped (either by running out of sample, or by stop())?
+	std::atomic< bool > stopped{false}; //was playback stopped (either by running out of sample, or by stop())? (safe to read from any thread)
 
 	Ramp< float > volume = Ramp< float >(1.0f);
+	Ramp< float > rate = Ramp< float >(1.0f); //playback rate (see set_rate())
 
 	//2D playback panning control: ('NaN' if sound played in 3D mode)
 	Ramp< float > pan = Ramp< float >(std::numeric_limits< float >::quiet_NaN());
@@ -81,10 +118,9 @@ struct PlayingSample {
 	Ramp< glm::vec3 > position = Ramp< glm::vec3 >(std::numeric_limits< float >::quiet_NaN());
 	Ramp< float > half_volume_radius = std::numeric_limits< float >::quiet_NaN();
 
-	PlayingSample(Sample const &sample_, float volume_, float pan_, bool loop_)
-		: data(sample_.data), loop(loop_), volume(volume_), pan(pan_) { }
-	PlayingSample(Sample const &sample_, float volume_, glm::vec3 const &position_, float half_volume_radius_, bool loop_)
-		: data(sample_.data), loop(loop_), volume(volume_), position(position_), half_volume_radius(half_volume_radius_) { }
+	//voice book-keeping (PlayingSamples come from a fixed pool in Sound.cpp and are reused once nothing refers to them):
+	std::atomic< bool > in_use{false}; //taken from the pool (set by play functions, cleared by the mixer when done)
+	float audibility = 0.0f; //loudest gain during the last mix (used by the mixer to pick which voices to hear)
 };
 
 // ------- global functions -------
@@ -93,8 +129,14 @@ void init(); //call Sound::init() from main.cpp before using any member function
 
 void shutdown(); //call Sound::shutdown() from main.cpp to gracefully(-ish) exit
 
+//call Sound::update() once per frame from the main loop:
+// changes that didn't fit in the audio callback's queue wait in a fixed-size backlog, which this sends along.
+void update();
+
 //Call 'Sound::play' to play a sample once.
 //  if you hang on to the return value, you can change the panning, volume, or stop playback early.
+//NOTE: at most a fixed number of sounds are tracked (and fewer actually mixed) at once; when there are too many,
+//  the lowest-priority and quietest ones go silent ('virtual') or are cut, and new sounds may come back already stopped.
 std::shared_ptr< PlayingSample > play(
 	Sample const &sample,
 	float volume = 1.0f,
@@ -124,25 +166,25 @@ std::shared_ptr< PlayingSample > loop_3D(
 );
 
 //Listener controls the panning of "3D" samples (ones played using the "position" version of the play functions):
+// (the current position and direction belong to the audio callback, so there's no reading them back)
 struct Listener {
-	void set_position_right(glm::vec3 const &new_position, glm::vec3 const &new_right, float ramp = 1.0f / 60.0f);
-
-	//internals:
-	Ramp< glm::vec3 > position = Ramp< glm::vec3 >(0.0f); //listener's location
-	Ramp< glm::vec3 > right = Ramp< glm::vec3 >(1.0f, 0.0f, 0.0f); //unit vector pointing to listener's right
+	bool set_position_right(glm::vec3 const &new_position, glm::vec3 const &new_right, float ramp = 1.0f / 60.0f);
 };
 extern struct Listener listener;
 
 //"panic button" to shut off all currently playing sounds:
-void stop_all_samples();
+bool stop_all_samples();
 
 //set global volume:
-void set_volume(float new_volume, float ramp = 1.0f / 60.0f);
-extern Ramp< float > volume;
+bool set_volume(float new_volume, float ramp = 1.0f / 60.0f);
+
+//fraction of real time the audio callback has recently spent mixing
+// (e.g., 0.02 means mixing one second of audio takes 20ms of the audio thread's time):
+float mix_load();
 
 //the audio callback doesn't run between Sound::lock() and Sound::unlock()
-// the set_*/stop/play/... functions already use these helpers, so you shouldn't need
-// to call them unless your code is modifying values directly:
+// the set_*/stop/play/... functions don't need these (they queue changes for the audio callback instead),
+// so you shouldn't need to call them unless your code is modifying values directly:
 void lock();
 void unlock();
 
@@ -3,6 +3,10 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <stdexcept>
 #include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cassert>
 
 static unsigned int link_program(const char* vs_src, const char* fs_src) {
     unsigned int vs = glCreateShader(GL_VERTEX_SHADER);
@@ -32,65 +36,213 @@ static unsigned int link_program(const char* vs_src, const char* fs_src) {
     return prog;
 }
 
+// atlas pages are this big unless an image needs more:
+static constexpr uint32_t AtlasSize = 512;
+
 void SpriteRenderer::init() {
-    // unit quad [0,1]^2
-    struct V { float x,y; };
-    const V verts[6] = { {0,0},{1,0},{1,1}, {0,0},{1,1},{0,1} };
-    glGenVertexArrays(1,&quad_vao_);
-    glBindVertexArray(quad_vao_);
-    glGenBuffers(1,&quad_vbo_);
-    glBindBuffer(GL_ARRAY_BUFFER, quad_vbo_);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0,2,GL_FLOAT,GL_FALSE,sizeof(V),(void*)0);
-    glBindVertexArray(0);
+    glGenBuffers(1,&ibo_);
 
     static const char* vs =
         "#version 330 core\n"
         "layout(location=0) in vec2 aPos;\n"
+        "layout(location=1) in vec2 aUV;\n"
+        "layout(location=2) in vec4 aTint;\n"
         "uniform mat4 uW2C;\n"
-        "uniform vec3 uX, uY, uT;\n"
-        "out vec2 vUV;\n"
-        "void main(){ vUV=aPos; vec3 p=aPos.x*uX + aPos.y*uY + uT; gl_Position=uW2C*vec4(p.xy,0,1); }\n";
+        "out vec2 vUV; out vec4 vTint;\n"
+        "void main(){ vUV=aUV; vTint=aTint; gl_Position=uW2C*vec4(aPos,0,1); }\n";
     static const char* fs =
         "#version 330 core\n"
-        "in vec2 vUV; uniform sampler2D uTex; uniform vec4 uTint; out vec4 frag;\n"
-        "void main(){ vec4 s=texture(uTex,vUV); frag=vec4(uTint.rgb,uTint.a)*s; }\n";
+        "in vec2 vUV; in vec4 vTint; uniform sampler2D uTex; out vec4 frag;\n"
+        "void main(){ frag=vTint*texture(uTex,vUV); }\n";
 
     prog_ = link_program(vs, fs);
     loc_w2c_    = glGetUniformLocation(prog_,"uW2C");
-    loc_X_      = glGetUniformLocation(prog_,"uX");
-    loc_Y_      = glGetUniformLocation(prog_,"uY");
-    loc_T_      = glGetUniformLocation(prog_,"uT");
     loc_sampler_= glGetUniformLocation(prog_,"uTex");
-    loc_tint_   = glGetUniformLocation(prog_,"uTint");
 }
 
-void SpriteRenderer::draw(const glm::mat4 &w2c,
-                          unsigned int tex,
-                          glm::vec2 center,
-                          glm::vec2 size,
-                          float radians,
-                          glm::vec4 tint) {
+SpriteRenderer::Sprite SpriteRenderer::add_image(glm::uvec2 size, glm::u8vec4 const *pixels) {
+    glm::uvec2 padded = size + glm::uvec2(2);
+    std::vector< glm::u8vec4 > data(size_t(padded.x) * padded.y);
+    for (uint32_t y = 0; y < size.y; ++y) {
+        std::copy(pixels + size_t(y) * size.x, pixels + size_t(y + 1) * size.x, data.begin() + size_t(y + 1) * padded.x + 1);
+    }
+    return add_padded_image(size, data.data());
+}
+
+SpriteRenderer::Sprite SpriteRenderer::add_padded_image(glm::uvec2 size, glm::u8vec4 *data) {
+    // find a page with room (or start a new one):
+    glm::uvec2 at(0);
+    AtlasPage *page = nullptr;
+    for (auto &p : pages_) {
+        if (p.packer.pack(size, &at)) { page = &p; break; }
+    }
+    if (!page) {
+        glm::uvec2 page_size(std::max(AtlasSize, size.x + 2), std::max(AtlasSize, size.y + 2));
+        pages_.push_back(AtlasPage{ 0, ShelfPacker(page_size, 1) });
+        page = &pages_.back();
+
+        glGenTextures(1, &page->tex);
+        glBindTexture(GL_TEXTURE_2D, page->tex);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        std::vector< glm::u8vec4 > clear(size_t(page_size.x) * page_size.y, glm::u8vec4(0));
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, GLsizei(page_size.x), GLsizei(page_size.y), 0, GL_RGBA, GL_UNSIGNED_BYTE, clear.data());
+
+        if (!page->packer.pack(size, &at)) throw std::runtime_error("SpriteRenderer: image doesn't fit in an empty atlas page.");
+    }
+
+    // fill in a one-pixel border repeating the edge pixels, so linear filtering never picks up neighbors:
+    glm::uvec2 padded = size + glm::uvec2(2);
+    for (uint32_t y = 1; y <= size.y; ++y) {
+        data[y * padded.x] = data[y * padded.x + 1];
+        data[y * padded.x + padded.x - 1] = data[y * padded.x + padded.x - 2];
+    }
+    std::copy(data + padded.x, data + 2 * padded.x, data);
+    std::copy(data + size_t(padded.y - 2) * padded.x, data + size_t(padded.y - 1) * padded.x, data + size_t(padded.y - 1) * padded.x);
+
+    glBindTexture(GL_TEXTURE_2D, page->tex);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, GLint(at.x - 1), GLint(at.y - 1), GLsizei(padded.x), GLsizei(padded.y), GL_RGBA, GL_UNSIGNED_BYTE, data);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glm::vec2 page_size = glm::vec2(page->packer.size);
+    Sprite sprite;
+    sprite.tex = page->tex;
+    sprite.uv_min = glm::vec2(at) / page_size;
+    sprite.uv_max = glm::vec2(at + size) / page_size;
+    return sprite;
+}
+
+SpriteRenderer::Sprite SpriteRenderer::whole_texture(unsigned int tex) {
+    Sprite sprite;
+    sprite.tex = tex;
+    return sprite;
+}
+
+void SpriteRenderer::begin(const glm::mat4 &w2c) {
+    world_to_clip_ = w2c;
+    quads_.clear();
+    stats = Stats();
+}
+
+void SpriteRenderer::submit(const Sprite &sprite,
+                            glm::vec2 center,
+                            glm::vec2 size,
+                            float radians,
+                            glm::vec4 tint,
+                            uint32_t layer) {
     float c = std::cos(radians), s = std::sin(radians);
     glm::vec2 X = { c * size.x, s * size.x };
     glm::vec2 Y = {-s * size.y, c * size.y };
     glm::vec2 BL = center - 0.5f * (X + Y);
 
+    glm::u8vec4 color = glm::u8vec4(glm::round(glm::clamp(tint, 0.0f, 1.0f) * 255.0f));
+
+    quads_.emplace_back();
+    Quad &q = quads_.back();
+    q.key = (uint64_t(layer) << 32) | uint64_t(sprite.tex);
+    q.verts[0] = Vertex{ BL,         glm::vec2(sprite.uv_min.x, sprite.uv_min.y), color };
+    q.verts[1] = Vertex{ BL + X,     glm::vec2(sprite.uv_max.x, sprite.uv_min.y), color };
+    q.verts[2] = Vertex{ BL + X + Y, glm::vec2(sprite.uv_max.x, sprite.uv_max.y), color };
+    q.verts[3] = Vertex{ BL + Y,     glm::vec2(sprite.uv_min.x, sprite.uv_max.y), color };
+
+    stats.sprites += 1;
+}
+
+void SpriteRenderer::flush() {
+    if (quads_.empty()) return;
+    flush_to(&stream_);
+    draw(stream_, world_to_clip_);
+}
+
+void SpriteRenderer::flush_to(Batch *batch_) {
+    assert(batch_);
+    Batch &batch = *batch_;
+    batch.runs.clear();
+
+    if (batch.vao == 0) {
+        glGenVertexArrays(1,&batch.vao);
+        glBindVertexArray(batch.vao);
+        glGenBuffers(1,&batch.vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, batch.vbo);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0,2,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex, position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1,2,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex, uv));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2,4,GL_UNSIGNED_BYTE,GL_TRUE,sizeof(Vertex),(void*)offsetof(Vertex, color));
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_); // (element buffer binding is VAO state)
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    if (quads_.empty()) return;
+
+    // group by (layer, texture), keeping submission order within each group:
+    auto by_key = [](Quad const &a, Quad const &b) { return a.key < b.key; };
+    if (!std::is_sorted(quads_.begin(), quads_.end(), by_key)) {
+        std::stable_sort(quads_.begin(), quads_.end(), by_key);
+    }
+
+    stream_vertices_.clear();
+    stream_vertices_.reserve(quads_.size() * 4);
+    for (uint32_t i = 0; i < uint32_t(quads_.size()); ++i) {
+        Quad const &q = quads_[i];
+        stream_vertices_.insert(stream_vertices_.end(), q.verts, q.verts + 4);
+
+        // one run per stretch of quads sharing a texture:
+        unsigned int tex = unsigned(q.key & 0xffffffffu);
+        if (batch.runs.empty() || batch.runs.back().tex != tex) {
+            batch.runs.emplace_back();
+            batch.runs.back().tex = tex;
+            batch.runs.back().first_quad = i;
+        }
+        batch.runs.back().quad_count += 1;
+    }
+
+    // (indices never change, so the index buffer only gets rebuilt when it needs to cover more quads)
+    if (ibo_quads_ < quads_.size()) {
+        ibo_quads_ = std::max(quads_.size(), ibo_quads_ * 2);
+        std::vector< uint32_t > indices;
+        indices.reserve(ibo_quads_ * 6);
+        for (uint32_t i = 0; i < uint32_t(ibo_quads_); ++i) {
+            uint32_t b = i * 4;
+            indices.insert(indices.end(), { b+0, b+1, b+2, b+0, b+2, b+3 });
+        }
+        glBindVertexArray(batch.vao); // (already has ibo_ as its element buffer)
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+        glBindVertexArray(0);
+    }
+
+    // upload vertices (re-specifying the whole store each time lets the driver hand back fresh memory instead of waiting on the last draw):
+    size_t bytes = stream_vertices_.size() * sizeof(Vertex);
+    glBindBuffer(GL_ARRAY_BUFFER, batch.vbo);
+    if (batch.vbo_capacity < bytes) batch.vbo_capacity = std::max(bytes, batch.vbo_capacity * 2);
+    glBufferData(GL_ARRAY_BUFFER, batch.vbo_capacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, stream_vertices_.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    quads_.clear();
+}
+
+void SpriteRenderer::draw(const Batch &batch, const glm::mat4 &w2c) {
+    if (batch.runs.empty()) return;
+
     glUseProgram(prog_);
     glUniformMatrix4fv(loc_w2c_,1,GL_FALSE,glm::value_ptr(w2c));
-    glUniform3f(loc_X_, X.x, X.y, 0.0f);
-    glUniform3f(loc_Y_, Y.x, Y.y, 0.0f);
-    glUniform3f(loc_T_, BL.x, BL.y, 1.0f);
     glUniform1i(loc_sampler_, 0);
-    glUniform4fv(loc_tint_,1,glm::value_ptr(tint));
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, tex);
+    glBindVertexArray(batch.vao);
 
-    glBindVertexArray(quad_vao_);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
+    for (auto const &run : batch.runs) {
+        glBindTexture(GL_TEXTURE_2D, run.tex);
+        glDrawElements(GL_TRIANGLES, GLsizei(run.quad_count * 6), GL_UNSIGNED_INT, (void*)(size_t(run.first_quad) * 6 * sizeof(uint32_t)));
+        stats.draw_calls += 1;
+    }
 
+    glBindVertexArray(0);
     glBindTexture(GL_TEXTURE_2D, 0);
     glUseProgram(0);
 }
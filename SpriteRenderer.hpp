@@ -1,25 +1,103 @@
 //@ChatGPT used
 #pragma once
 #include "GL.hpp"
+#include "ShelfPacker.hpp"
 #include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
 
+// Batched sprite renderer. Per frame:
+//   sprites.begin(world_to_clip);
+//   sprites.submit(sprite, center, size, radians, tint); // ...as many as needed
+//   sprites.flush(); // one draw call per texture in use (and nothing at all if nothing was submitted)
+//
+// Images added with add_image() share atlas textures, so sprites made from them
+// normally all end up in a single draw call.
 struct SpriteRenderer {
-    void init(); // compile shaders and setup unit quad
-    // draw a textured sprite:
-    //  - tex: GL texture id (RGBA8)
+    // a rectangle of a texture:
+    struct Sprite {
+        unsigned int tex = 0;
+        glm::vec2 uv_min = glm::vec2(0.0f);
+        glm::vec2 uv_max = glm::vec2(1.0f);
+    };
+
+    void init(); // compile shaders and setup buffers
+
+    // copy an RGBA8 image (e.g. from load_png with LowerLeftOrigin) into an atlas page:
+    Sprite add_image(glm::uvec2 size, glm::u8vec4 const *pixels);
+    // same, for an image already laid out the way add_image() uploads it (skipping that copy):
+    //  'padded' is (size.x + 2) x (size.y + 2) pixels with the image at (1,1); the one-pixel border is filled in here
+    Sprite add_padded_image(glm::uvec2 size, glm::u8vec4 *padded);
+    // use a whole standalone texture as a sprite (won't batch with atlas sprites):
+    static Sprite whole_texture(unsigned int tex);
+
+    // start a frame (resets stats):
+    void begin(const glm::mat4 &world_to_clip);
+
+    // queue a textured sprite:
     //  - center: world-space center
     //  - size: (width,height) in world units
     //  - radians: rotation (counter-clockwise), texture assumed facing +X by default
     //  - tint: RGBA multiplier (default 1)
-    void draw(const glm::mat4 &world_to_clip,
-              unsigned int tex,
-              glm::vec2 center,
-              glm::vec2 size,
-              float radians,
-              glm::vec4 tint = glm::vec4(1.0f));
+    //  - layer: lower layers draw first. Within a layer sprites are grouped by texture,
+    //    so overlapping sprites from *different* textures should go in different layers.
+    void submit(const Sprite &sprite,
+                glm::vec2 center,
+                glm::vec2 size,
+                float radians,
+                glm::vec4 tint = glm::vec4(1.0f),
+                uint32_t layer = 0);
+
+    // draw everything queued since begin() / the last flush():
+    void flush();
+
+    // Sprites recorded once and then drawn any number of times (for things that rarely change, like UI):
+    struct Batch {
+        struct Run {
+            unsigned int tex = 0;
+            uint32_t first_quad = 0, quad_count = 0;
+        };
+        std::vector< Run > runs; // one draw call each
+        unsigned int vao = 0, vbo = 0;
+        size_t vbo_capacity = 0; // bytes
+    };
+    // move everything queued since begin() / the last flush() into 'batch' (replacing its contents) instead of drawing it:
+    void flush_to(Batch *batch);
+    // draw a recorded batch:
+    void draw(const Batch &batch, const glm::mat4 &world_to_clip);
+
+    struct Stats {
+        uint32_t sprites = 0;    // submitted since begin()
+        uint32_t draw_calls = 0; // issued since begin()
+    } stats;
 
 private:
+    struct Vertex {
+        glm::vec2 position;
+        glm::vec2 uv;
+        glm::u8vec4 color;
+    };
+    static_assert(sizeof(Vertex) == 4*2 + 4*2 + 1*4, "Vertex should be packed.");
+
+    struct Quad {
+        uint64_t key; // (layer << 32) | texture
+        Vertex verts[4];
+    };
+
+    struct AtlasPage {
+        unsigned int tex = 0;
+        ShelfPacker packer;
+    };
+
     unsigned int prog_ = 0;
-    int loc_w2c_ = -1, loc_X_ = -1, loc_Y_ = -1, loc_T_ = -1, loc_sampler_ = -1, loc_tint_ = -1;
-    unsigned int quad_vao_ = 0, quad_vbo_ = 0;
+    int loc_w2c_ = -1, loc_sampler_ = -1;
+    unsigned int ibo_ = 0;    // shared by all batches (quad indices never change)
+    size_t ibo_quads_ = 0;    // quads the index buffer covers
+    Batch stream_;            // what flush() records into and draws right away
+
+    glm::mat4 world_to_clip_ = glm::mat4(1.0f);
+    std::vector< Quad > quads_;     // queued this batch
+    std::vector< Vertex > stream_vertices_; // (scratch) vertices in draw order
+
+    std::vector< AtlasPage > pages_;
 };
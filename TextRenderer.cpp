@@ -1,29 +1,24 @@
 //@ChatGPT used
 #include "TextRenderer.hpp"
 #include "data_path.hpp"
+#include "read_write_chunk.hpp"
 
 #include <stdexcept>
 #include <cstring>
+#include <cstddef>
+#include <cassert>
 #include <algorithm>
-
-// -------------- Quad --------------
-void TextRenderer::Quad::init() {
-	struct V { glm::vec2 p; };
-	const V verts[6] = { {{0,0}},{{1,0}},{{1,1}}, {{0,0}},{{1,1}},{{0,1}} };
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(V), (void*)0);
-	glBindVertexArray(0);
-}
-void TextRenderer::Quad::draw() const {
-	glBindVertexArray(vao);
-	glDrawArrays(GL_TRIANGLES, 0, 6);
-	glBindVertexArray(0);
-}
+#include <iostream>
+#include <sstream>
+
+// FT_RENDER_MODE_SDF arrived in FreeType 2.11:
+#if FREETYPE_MAJOR > 2 || (FREETYPE_MAJOR == 2 && FREETYPE_MINOR >= 11)
+#define HAVE_FT_SDF 1
+#else
+#define HAVE_FT_SDF 0
+#endif
+// (SDF mode) how far from the outline distances are recorded, in px:
+static constexpr int SdfSpread = 6;
 
 // -------------- Shader --------------
 GLuint TextRenderer::link_program_(const char *vs_src, const char *fs_src) {
@@ -59,34 +54,48 @@ GLuint TextRenderer::link_program_(const char *vs_src, const char *fs_src) {
 	}
 	return prog;
 }
-void TextRenderer::Shader::init() {
-	static const char* vs =
-	"#version 330 core\n"
-	"layout(location=0) in vec2 aPos;\n"
-	"uniform mat4 uW2C;\n"
-	"uniform vec3 uX, uY, uT;\n"
-	"out vec2 vUV;\n"
-	"void main(){ vUV = aPos; vec3 p = aPos.x*uX + aPos.y*uY + uT; gl_Position = uW2C * vec4(p.xy,0,1); }\n";
-	static const char* fs =
-	"#version 330 core\n"
-	"in vec2 vUV;\n"
-	"uniform sampler2D uTex;\n"
-	"uniform vec4 uTint;\n"
-	"out vec4 frag;\n"
-	"void main(){ vec4 s = texture(uTex, vUV); frag = vec4(uTint.rgb, uTint.a * s.a); }\n";
-	prog = 0;
-	// link via owner
-}
-
 // -------------- Init / Destroy --------------
-void TextRenderer::init(const std::string &rel_path, int pixel_height) {
-	pixel_height_ = pixel_height;
+void TextRenderer::init(const std::string &rel_path, int pixel_height, Mode mode) {
+	load_font(rel_path, pixel_height, mode);
+	init_gl();
+}
 
-	if (FT_Init_FreeType(&ft_lib_) != 0) throw std::runtime_error("FT_Init_FreeType failed");
+void TextRenderer::load_font(const std::string &rel_path, int pixel_height, Mode mode, std::string const &preload) {
+	start_font_(pixel_height, mode);
 	std::string path = data_path(rel_path);
 	if (FT_New_Face(ft_lib_, path.c_str(), 0, &ft_face_) != 0) {
 		throw std::runtime_error("FT_New_Face failed for: " + rel_path);
 	}
+	finish_font_(preload);
+}
+
+void TextRenderer::load_font_data(char const *data, size_t size, int pixel_height, Mode mode, std::string const &preload) {
+	start_font_(pixel_height, mode);
+	if (FT_New_Memory_Face(ft_lib_, reinterpret_cast< FT_Byte const * >(data), FT_Long(size), 0, &ft_face_) != 0) {
+		throw std::runtime_error("FT_New_Memory_Face failed");
+	}
+	finish_font_(preload);
+}
+
+void TextRenderer::start_font_(int pixel_height, Mode mode) {
+	pixel_height_ = pixel_height;
+	mode_ = mode;
+
+	if (FT_Init_FreeType(&ft_lib_) != 0) throw std::runtime_error("FT_Init_FreeType failed");
+
+	if (mode_ == Mode::SDF) {
+#if HAVE_FT_SDF
+		// distances are stored out to SdfSpread px from the outline (also the padding around each glyph):
+		FT_Int spread = SdfSpread;
+		FT_Property_Set(ft_lib_, "bsdf", "spread", &spread);
+#else
+		std::cerr << "TextRenderer: this FreeType has no SDF renderer; using bitmaps." << std::endl;
+		mode_ = Mode::Bitmap;
+#endif
+	}
+}
+
+void TextRenderer::finish_font_(std::string const &preload) {
 	FT_Set_Pixel_Sizes(ft_face_, 0, pixel_height_);
 
 	// metrics in pixels
@@ -95,45 +104,94 @@ void TextRenderer::init(const std::string &rel_path, int pixel_height) {
 
 	// HarfBuzz font wrapping FT face
 	hb_font_ = hb_ft_font_create_referenced(ft_face_);
+	hb_buf_ = hb_buffer_create();
 
-	// GL state for uploads
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	// glyph atlas (starts small; grows when full). Only the CPU copy exists until init_gl():
+	grow_atlas_(atlas_packer_.size.y);
+
+	// rasterize the glyphs for 'preload' now, so that work happens here rather than at first draw:
+	for (unsigned char c : preload) {
+		get_glyph_(FT_Get_Char_Index(ft_face_, c));
+	}
+}
 
-	// quad + shader
-	quad_.init();
-	sh_.init();
+void TextRenderer::init_gl() {
+	glGenTextures(1, &atlas_tex_);
+	upload_atlas_();
+
+	// shader (atlas coordinates arrive in pixels; textureSize() turns them into uvs)
+	// Bitmap mode: the atlas holds coverage.
+	// SDF mode: the atlas holds distance to the outline (0.5 = on it, larger = inside);
+	//   fwidth() gives how much that changes per screen pixel, so the edge gets about one pixel of antialiasing at any scale.
 	sh_.prog = link_program_(
 		"#version 330 core\n"
 		"layout(location=0) in vec2 aPos;\n"
+		"layout(location=1) in vec2 aUV;\n"
+		"layout(location=2) in vec4 aTint;\n"
 		"uniform mat4 uW2C;\n"
-		"uniform vec3 uX, uY, uT;\n"
+		"uniform sampler2D uTex;\n"
 		"out vec2 vUV;\n"
-		"void main(){ vUV = aPos; vec3 p = aPos.x*uX + aPos.y*uY + uT; gl_Position = uW2C * vec4(p.xy,0,1); }\n",
+		"out vec4 vTint;\n"
+		"void main(){ vUV = aUV / vec2(textureSize(uTex, 0)); vTint = aTint; gl_Position = uW2C * vec4(aPos,0,1); }\n",
+		(mode_ == Mode::SDF ?
+		"#version 330 core\n"
+		"in vec2 vUV;\n"
+		"in vec4 vTint;\n"
+		"uniform sampler2D uTex;\n"
+		"out vec4 frag;\n"
+		"void main(){\n"
+		"	float dist = texture(uTex, vUV).r - 0.5;\n"
+		"	float aa = max(fwidth(dist), 1e-4);\n"
+		"	float coverage = clamp(dist / aa + 0.5, 0.0, 1.0);\n"
+		"	frag = vec4(vTint.rgb, vTint.a * coverage);\n"
+		"}\n"
+		:
 		"#version 330 core\n"
 		"in vec2 vUV;\n"
+		"in vec4 vTint;\n"
 		"uniform sampler2D uTex;\n"
-		"uniform vec4 uTint;\n"
 		"out vec4 frag;\n"
-		"void main(){ vec4 s = texture(uTex, vUV); frag = vec4(uTint.rgb, uTint.a * s.a); }\n"
+		"void main(){ float coverage = texture(uTex, vUV).r; frag = vec4(vTint.rgb, vTint.a * coverage); }\n")
 	);
 	sh_.loc_w2c    = glGetUniformLocation(sh_.prog, "uW2C");
-	sh_.loc_X      = glGetUniformLocation(sh_.prog, "uX");
-	sh_.loc_Y      = glGetUniformLocation(sh_.prog, "uY");
-	sh_.loc_T      = glGetUniformLocation(sh_.prog, "uT");
-	sh_.loc_tint   = glGetUniformLocation(sh_.prog, "uTint");
 	sh_.loc_sampler= glGetUniformLocation(sh_.prog, "uTex");
 }
 
 TextRenderer::~TextRenderer() {
-	for (auto &kv : cache_) {
-		if (kv.second.tex) glDeleteTextures(1, &kv.second.tex);
-	}
 	cache_.clear();
+	run_lookup_.clear();
+	runs_.clear();
+	if (hb_buf_) { hb_buffer_destroy(hb_buf_); hb_buf_ = nullptr; }
+	if (atlas_tex_) { glDeleteTextures(1, &atlas_tex_); atlas_tex_ = 0; }
+	if (stream_.vbo) { glDeleteBuffers(1, &stream_.vbo); stream_.vbo = 0; }
+	if (stream_.vao) { glDeleteVertexArrays(1, &stream_.vao); stream_.vao = 0; }
 	if (hb_font_) { hb_font_destroy(hb_font_); hb_font_ = nullptr; }
 	if (ft_face_) { FT_Done_Face(ft_face_); ft_face_ = nullptr; }
 	if (ft_lib_)  { FT_Done_FreeType(ft_lib_); ft_lib_ = nullptr; }
 }
 
+// -------------- Glyph atlas --------------
+// the atlas never gets taller than this; glyphs that don't fit after that are drawn blank:
+static constexpr uint32_t MaxAtlasHeight = 4096;
+
+void TextRenderer::grow_atlas_(uint32_t new_height) {
+	// packer grows upward, so existing rows (and glyph positions) stay put:
+	atlas_packer_.grow(new_height);
+	atlas_pixels_.resize(size_t(atlas_packer_.size.x) * atlas_packer_.size.y, 0);
+	if (atlas_tex_) upload_atlas_();
+}
+
+void TextRenderer::upload_atlas_() {
+	glBindTexture(GL_TEXTURE_2D, atlas_tex_);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, GLsizei(atlas_packer_.size.x), GLsizei(atlas_packer_.size.y), 0, GL_RED, GL_UNSIGNED_BYTE, atlas_pixels_.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
 // -------------- Glyph cache --------------
 TextRenderer::Glyph const &TextRenderer::get_glyph_(uint32_t glyph_index) {
 	auto it = cache_.find(glyph_index);
@@ -146,52 +204,170 @@ TextRenderer::Glyph const &TextRenderer::get_glyph_(uint32_t glyph_index) {
 	}
 	FT_GlyphSlot g = ft_face_->glyph;
 
+#if HAVE_FT_SDF
+	// re-rendering the coverage bitmap as an SDF uses FreeType's 'bsdf' rasterizer,
+	// which copes better with tiny features and overlapping contours than the outline-based 'sdf' one:
+	// (glyphs without a bitmap -- spaces -- have nothing to render)
+	if (mode_ == Mode::SDF && g->bitmap.width > 0 && g->bitmap.rows > 0) {
+		if (FT_Render_Glyph(g, FT_RENDER_MODE_SDF) != 0) {
+			std::cerr << "TextRenderer: couldn't render SDF for glyph " << glyph_index << "; it will be blank." << std::endl;
+			Glyph blank;
+			blank.advance26_6 = static_cast<uint32_t>(g->advance.x);
+			auto [it2, _] = cache_.emplace(glyph_index, blank);
+			return it2->second;
+		}
+	}
+#endif
+
 	const int rows  = int(g->bitmap.rows);
-    const int width = int(g->bitmap.width);
-    const int pitch = g->bitmap.pitch; // may be negative
-
-    std::vector<unsigned char> rgba(size_t(width) * size_t(rows) * 4, 255);
-
-    // Write destination as bottom-to-top for OpenGL's (0,0) at bottom-left.
-    for (int y = 0; y < rows; ++y) {
-        int src_y = (pitch >= 0) ? y : (rows - 1 - y);
-        const unsigned char* src = reinterpret_cast<const unsigned char*>(g->bitmap.buffer)
-                                + src_y * std::abs(pitch);
-
-        // ★ key change: bottom-up destination
-        int dst_y = (rows - 1 - y);
-
-        for (int x = 0; x < width; ++x) {
-            unsigned char cov = src[x];
-            size_t i = (size_t(dst_y) * size_t(width) + size_t(x)) * 4;
-            rgba[i + 0] = 255;
-            rgba[i + 1] = 255;
-            rgba[i + 2] = 255;
-            rgba[i + 3] = cov; // alpha = coverage
-        }
-    }
-
-
-	GLuint tex = 0;
-	glGenTextures(1, &tex);
-	glBindTexture(GL_TEXTURE_2D, tex);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, rows, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	const int width = int(g->bitmap.width);
+	const int pitch = g->bitmap.pitch; // may be negative
 
 	Glyph glyph;
-	glyph.tex         = tex;
 	glyph.size        = glm::ivec2(width, rows);
 	glyph.bearing     = glm::ivec2(g->bitmap_left, g->bitmap_top);
 	glyph.advance26_6 = static_cast<uint32_t>(g->advance.x);
 
+	if (width > 0 && rows > 0) {
+		glm::uvec2 at(0);
+		bool packed = atlas_packer_.pack(glm::uvec2(width, rows), &at);
+		while (!packed && atlas_packer_.size.y < MaxAtlasHeight) {
+			grow_atlas_(std::min(atlas_packer_.size.y * 2, MaxAtlasHeight));
+			packed = atlas_packer_.pack(glm::uvec2(width, rows), &at);
+		}
+		if (!packed) {
+			std::cerr << "TextRenderer: glyph atlas is full; glyph " << glyph_index << " will be blank." << std::endl;
+			glyph.size = glm::ivec2(0);
+		} else {
+			glyph.atlas_at = glm::ivec2(at);
+
+			// copy coverage into the atlas bottom-to-top, for OpenGL's (0,0) at bottom-left:
+			std::vector< uint8_t > coverage(size_t(width) * size_t(rows));
+			for (int y = 0; y < rows; ++y) {
+				int src_y = (pitch >= 0) ? y : (rows - 1 - y);
+				const unsigned char* src = reinterpret_cast<const unsigned char*>(g->bitmap.buffer)
+				                        + src_y * std::abs(pitch);
+				int dst_y = (rows - 1 - y);
+				std::memcpy(&coverage[size_t(dst_y) * width], src, size_t(width));
+				std::memcpy(&atlas_pixels_[(at.y + dst_y) * size_t(atlas_packer_.size.x) + at.x], src, size_t(width));
+			}
+
+			if (atlas_tex_) {
+				glBindTexture(GL_TEXTURE_2D, atlas_tex_);
+				glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+				glTexSubImage2D(GL_TEXTURE_2D, 0, GLint(at.x), GLint(at.y), width, rows, GL_RED, GL_UNSIGNED_BYTE, coverage.data());
+				glBindTexture(GL_TEXTURE_2D, 0);
+			}
+		}
+	}
+
 	auto [it2, _] = cache_.emplace(glyph_index, glyph);
 	return it2->second;
 }
 
+// -------------- Baked glyphs --------------
+// saved as chunks (see read_write_chunk.hpp): a header, the atlas packer's shelves, the glyphs, and the atlas pixels.
+namespace {
+	struct BakedHeader {
+		int32_t pixel_height;
+		uint32_t mode;
+		int32_t sdf_spread;
+		uint32_t atlas_width, atlas_height;
+		uint32_t padding, used_height;
+	};
+	static_assert(sizeof(BakedHeader) == 7*4, "BakedHeader is packed.");
+	struct BakedGlyph {
+		uint32_t glyph_index;
+		int32_t atlas_at[2], size[2], bearing[2];
+		uint32_t advance26_6;
+	};
+	static_assert(sizeof(BakedGlyph) == 8*4, "BakedGlyph is packed.");
+	static_assert(sizeof(ShelfPacker::Shelf) == 3*4, "Shelf is packed.");
+}
+
+std::string TextRenderer::baked_glyphs_name(const std::string &rel_path, int pixel_height, Mode mode) {
+	return rel_path + "@" + std::to_string(pixel_height) + (mode == Mode::SDF ? ".sdf" : ".bitmap");
+}
+
+void TextRenderer::save_glyphs(std::vector< char > *out_) const {
+	assert(out_);
+	std::vector< BakedHeader > header(1);
+	header[0].pixel_height = pixel_height_;
+	header[0].mode = uint32_t(mode_);
+	header[0].sdf_spread = SdfSpread;
+	header[0].atlas_width = atlas_packer_.size.x;
+	header[0].atlas_height = atlas_packer_.size.y;
+	header[0].padding = atlas_packer_.padding;
+	header[0].used_height = atlas_packer_.used_height;
+
+	std::vector< BakedGlyph > glyphs;
+	glyphs.reserve(cache_.size());
+	for (auto const &[glyph_index, g] : cache_) {
+		glyphs.emplace_back(BakedGlyph{ glyph_index,
+			{ g.atlas_at.x, g.atlas_at.y }, { g.size.x, g.size.y }, { g.bearing.x, g.bearing.y },
+			g.advance26_6 });
+	}
+
+	std::ostringstream out;
+	write_chunk("gh00", header, &out);
+	write_chunk("gs00", atlas_packer_.shelves, &out);
+	write_chunk("gg00", glyphs, &out);
+	write_chunk("ga00", atlas_pixels_, &out);
+	std::string const &str = out.str();
+	out_->assign(str.begin(), str.end());
+}
+
+bool TextRenderer::load_glyphs(char const *data, size_t size) {
+	ChunkBytes from{ data, data + size };
+	std::vector< BakedHeader > header;
+	read_chunk(&from, "gh00", &header);
+	if (header.size() != 1) throw std::runtime_error("TextRenderer: baked glyphs should have exactly one header");
+	if (header[0].pixel_height != pixel_height_ || header[0].mode != uint32_t(mode_)
+	 || (mode_ == Mode::SDF && header[0].sdf_spread != SdfSpread)) {
+		return false;
+	}
+
+	std::vector< ShelfPacker::Shelf > shelves;
+	read_chunk(&from, "gs00", &shelves);
+	std::vector< BakedGlyph > glyphs;
+	read_chunk(&from, "gg00", &glyphs);
+	std::vector< uint8_t > pixels;
+	read_chunk(&from, "ga00", &pixels);
+
+	glm::uvec2 atlas_size(header[0].atlas_width, header[0].atlas_height);
+	if (pixels.size() != size_t(atlas_size.x) * atlas_size.y || atlas_size.y > MaxAtlasHeight) {
+		throw std::runtime_error("TextRenderer: baked glyph atlas has the wrong size");
+	}
+	for (auto const &b : glyphs) {
+		if (b.size[0] < 0 || b.size[1] < 0 || b.atlas_at[0] < 0 || b.atlas_at[1] < 0
+		 || uint32_t(b.atlas_at[0] + b.size[0]) > atlas_size.x || uint32_t(b.atlas_at[1] + b.size[1]) > atlas_size.y) {
+			throw std::runtime_error("TextRenderer: baked glyph is outside the atlas");
+		}
+	}
+
+	atlas_packer_ = ShelfPacker(atlas_size, header[0].padding);
+	atlas_packer_.shelves = std::move(shelves);
+	atlas_packer_.used_height = header[0].used_height;
+	atlas_pixels_ = std::move(pixels);
+
+	cache_.clear();
+	for (auto const &b : glyphs) {
+		Glyph glyph;
+		glyph.atlas_at = glm::ivec2(b.atlas_at[0], b.atlas_at[1]);
+		glyph.size = glm::ivec2(b.size[0], b.size[1]);
+		glyph.bearing = glm::ivec2(b.bearing[0], b.bearing[1]);
+		glyph.advance26_6 = b.advance26_6;
+		cache_.emplace(b.glyph_index, glyph);
+	}
+
+	// shaped runs point at the old atlas:
+	run_lookup_.clear();
+	runs_.clear();
+
+	if (atlas_tex_) upload_atlas_();
+	return true;
+}
+
 // -------------- Draw --------------
 void TextRenderer::draw_text(glm::mat4 const &w2c,
 	glm::vec2 pos_world,
@@ -199,66 +375,149 @@ void TextRenderer::draw_text(glm::mat4 const &w2c,
 	glm::vec4 color,
 	std::string const &utf8_text)
 {
-	// 1) Shape with HarfBuzz
-	hb_buffer_t *buf = hb_buffer_create();
-	hb_buffer_set_direction(buf, HB_DIRECTION_LTR);   // default LTR; can be changed if needed
-	hb_buffer_set_script(buf, HB_SCRIPT_UNKNOWN);
-	hb_buffer_set_language(buf, hb_language_get_default());
-	hb_buffer_add_utf8(buf, utf8_text.c_str(), int(utf8_text.size()), 0, int(utf8_text.size()));
-	hb_shape(hb_font_, buf, nullptr, 0);
+	queue_text(pos_world, H_world, color, utf8_text);
+	flush(w2c);
+}
 
-	unsigned int glyph_count = 0;
-	hb_glyph_info_t const *infos = hb_buffer_get_glyph_infos(buf, &glyph_count);
-	hb_glyph_position_t const *pos = hb_buffer_get_glyph_positions(buf, &glyph_count);
+TextRenderer::ShapedRun const &TextRenderer::shape_(std::string const &utf8_text) {
+	// recently used? move to front and return:
+	auto found = run_lookup_.find(RunKey{ utf8_text, pixel_height_ });
+	if (found != run_lookup_.end()) {
+		runs_.splice(runs_.begin(), runs_, found->second);
+		stats.cache_hits += 1;
+		return found->second->run;
+	}
 
-	// 2) Pixel→world scale based on (ascender - descender)
-	float layout_px = ascender_px_ - descender_px_;
-	if (layout_px <= 0.0f) layout_px = float(pixel_height_);
-	float px_to_world = H_world / layout_px;
+	// make room by dropping the least recently used run:
+	if (runs_.size() >= RunCacheSize) {
+		run_lookup_.erase(RunKey{ runs_.back().text, runs_.back().pixel_height });
+		runs_.pop_back();
+	}
 
-	// 3) GL state
-	glUseProgram(sh_.prog);
-	glUniformMatrix4fv(sh_.loc_w2c, 1, GL_FALSE, glm::value_ptr(w2c));
-	glUniform4fv(sh_.loc_tint, 1, glm::value_ptr(color));
-	glUniform1i(sh_.loc_sampler, 0);
+	runs_.emplace_front();
+	RunEntry &entry = runs_.front();
+	entry.text = utf8_text;
+	entry.pixel_height = pixel_height_;
+	run_lookup_.emplace(RunKey{ entry.text, entry.pixel_height }, runs_.begin());
 
-	// Baseline advance in world units
-	glm::vec2 pen = pos_world;
+	// 1) Shape with HarfBuzz
+	hb_buffer_clear_contents(hb_buf_);
+	hb_buffer_set_direction(hb_buf_, HB_DIRECTION_LTR);   // default LTR; can be changed if needed
+	hb_buffer_set_script(hb_buf_, HB_SCRIPT_UNKNOWN);
+	hb_buffer_set_language(hb_buf_, hb_language_get_default());
+	hb_buffer_add_utf8(hb_buf_, utf8_text.c_str(), int(utf8_text.size()), 0, int(utf8_text.size()));
+	hb_shape(hb_font_, hb_buf_, nullptr, 0);
+	stats.shaped += 1;
 
+	unsigned int glyph_count = 0;
+	hb_glyph_info_t const *infos = hb_buffer_get_glyph_infos(hb_buf_, &glyph_count);
+	hb_glyph_position_t const *pos = hb_buffer_get_glyph_positions(hb_buf_, &glyph_count);
+
+	// 2) Lay out glyph quads in pixels
+	glm::vec2 pen_px = glm::vec2(0.0f);
+	entry.run.quads.reserve(glyph_count);
 	for (unsigned int i = 0; i < glyph_count; ++i) {
 		uint32_t glyph_index = infos[i].codepoint;
 
 		// glyph offsets/advances from HB are 26.6 fixed
-		float x_off_px = float(pos[i].x_offset) / 64.0f;
-		float y_off_px = float(pos[i].y_offset) / 64.0f;
-		float x_adv_px = float(pos[i].x_advance) / 64.0f;
-		float y_adv_px = float(pos[i].y_advance) / 64.0f;
+		glm::vec2 offset_px = glm::vec2(float(pos[i].x_offset), float(pos[i].y_offset)) / 64.0f;
+		glm::vec2 advance_px = glm::vec2(float(pos[i].x_advance), float(pos[i].y_advance)) / 64.0f;
 
 		Glyph const &g = get_glyph_(glyph_index);
-		if (g.tex) {
-			glm::vec2 size_world(g.size.x * px_to_world, g.size.y * px_to_world);
-			glm::vec2 bearing_world(g.bearing.x * px_to_world, g.bearing.y * px_to_world);
-
+		if (g.size.x > 0 && g.size.y > 0) {
 			// baseline + HB offset + bearing, bitmap is top-aligned relative to bearing
-			glm::vec2 bl = pen
-				+ glm::vec2(x_off_px * px_to_world, y_off_px * px_to_world)
-				+ glm::vec2(bearing_world.x, bearing_world.y - size_world.y);
-
-			glm::vec3 X(size_world.x, 0, 0), Y(0, size_world.y, 0), T(bl.x, bl.y, 1.0f);
-			glUniform3fv(sh_.loc_X, 1, glm::value_ptr(X));
-			glUniform3fv(sh_.loc_Y, 1, glm::value_ptr(Y));
-			glUniform3fv(sh_.loc_T, 1, glm::value_ptr(T));
-
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, g.tex);
-			quad_.draw();
+			ShapedRun::Quad quad;
+			quad.min_px = pen_px + offset_px + glm::vec2(float(g.bearing.x), float(g.bearing.y - g.size.y));
+			quad.max_px = quad.min_px + glm::vec2(g.size);
+			quad.uv_min = glm::vec2(g.atlas_at);
+			quad.uv_max = glm::vec2(g.atlas_at + g.size);
+			entry.run.quads.emplace_back(quad);
 		}
 
-		pen += glm::vec2(x_adv_px * px_to_world, y_adv_px * px_to_world);
+		pen_px += advance_px;
+	}
+
+	return entry.run;
+}
+
+void TextRenderer::queue_text(glm::vec2 pos_world,
+	float H_world,
+	glm::vec4 color,
+	std::string const &utf8_text)
+{
+	ShapedRun const &run = shape_(utf8_text);
+
+	// Pixel→world scale based on (ascender - descender)
+	float layout_px = ascender_px_ - descender_px_;
+	if (layout_px <= 0.0f) layout_px = float(pixel_height_);
+	float px_to_world = H_world / layout_px;
+
+	glm::u8vec4 tint = glm::u8vec4(glm::round(glm::clamp(color, 0.0f, 1.0f) * 255.0f));
+
+	for (auto const &quad : run.quads) {
+		glm::vec2 bl = pos_world + quad.min_px * px_to_world;
+		glm::vec2 tr = pos_world + quad.max_px * px_to_world;
+
+		Vertex v00{ bl, quad.uv_min, tint };
+		Vertex v10{ glm::vec2(tr.x, bl.y), glm::vec2(quad.uv_max.x, quad.uv_min.y), tint };
+		Vertex v11{ tr, quad.uv_max, tint };
+		Vertex v01{ glm::vec2(bl.x, tr.y), glm::vec2(quad.uv_min.x, quad.uv_max.y), tint };
+		batch_.insert(batch_.end(), { v00, v10, v11, v00, v11, v01 });
 	}
+}
+
+void TextRenderer::flush(glm::mat4 const &w2c) {
+	if (batch_.empty()) return;
+	flush_to(&stream_);
+	draw(stream_, w2c);
+}
+
+void TextRenderer::flush_to(Batch *batch_out) {
+	assert(batch_out);
+	Batch &batch = *batch_out;
+
+	if (batch.vao == 0) {
+		glGenVertexArrays(1, &batch.vao);
+		glBindVertexArray(batch.vao);
+		glGenBuffers(1, &batch.vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, batch.vbo);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	batch.vertex_count = GLsizei(batch_.size());
+	if (batch_.empty()) return;
+
+	// upload vertices (orphaning the old store so the driver doesn't wait on the last draw):
+	size_t bytes = batch_.size() * sizeof(Vertex);
+	glBindBuffer(GL_ARRAY_BUFFER, batch.vbo);
+	if (batch.vbo_capacity < bytes) batch.vbo_capacity = std::max(bytes, batch.vbo_capacity * 2);
+	glBufferData(GL_ARRAY_BUFFER, batch.vbo_capacity, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, batch_.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	batch_.clear();
+}
+
+void TextRenderer::draw(Batch const &batch, glm::mat4 const &w2c) {
+	if (batch.vertex_count == 0) return;
+
+	glUseProgram(sh_.prog);
+	glUniformMatrix4fv(sh_.loc_w2c, 1, GL_FALSE, glm::value_ptr(w2c));
+	glUniform1i(sh_.loc_sampler, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, atlas_tex_);
+
+	glBindVertexArray(batch.vao);
+	glDrawArrays(GL_TRIANGLES, 0, batch.vertex_count);
+	glBindVertexArray(0);
 
 	glBindTexture(GL_TEXTURE_2D, 0);
 	glUseProgram(0);
-
-	hb_buffer_destroy(buf);
 }
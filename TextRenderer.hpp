@@ -2,10 +2,13 @@
 #pragma once
 
 #include "GL.hpp"
+#include "ShelfPacker.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include <string>
+#include <string_view>
+#include <list>
 #include <unordered_map>
 #include <vector>
 #include <cstdint>
@@ -13,53 +16,150 @@
 // HarfBuzz + FreeType
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include FT_MODULE_H
 #include <hb.h>
 #include <hb-ft.h>
 
 // Tiny text renderer using HarfBuzz shaping + FreeType rasterization.
 // World-space baseline placement; height in world units maps to (ascender - descender).
+// Glyphs live in one single-channel atlas texture (grown as needed), and text is drawn
+// in batches: each draw_text() is one draw call, and queue_text() + flush() draws any
+// number of strings with one draw call.
 struct TextRenderer {
+	enum class Mode {
+		Bitmap, // coverage bitmaps: sharpest at pixel_height, blurry when drawn much larger
+		SDF,    // signed distance fields: a small pixel_height stays crisp at any drawn size
+	};
+
 	// Init with a font at data/<rel_path>, e.g. "fonts/Font.ttf"
 	// pixel_height is the nominal FT pixel size used for glyph rasterization.
-	void init(const std::string &rel_path, int pixel_height = 48);
+	void init(const std::string &rel_path, int pixel_height = 48, Mode mode = Mode::Bitmap);
+
+	// init() in two steps, for loading off the main thread:
+	// load_font() opens the font and rasterizes the glyphs for the (ASCII) characters in 'preload' (no OpenGL calls; any thread),
+	// init_gl() then creates the atlas texture and shader (on the GL thread):
+	void load_font(const std::string &rel_path, int pixel_height = 48, Mode mode = Mode::Bitmap, std::string const &preload = "");
+	void init_gl();
+
+	// Same as load_font(), with the font file already in memory (e.g. a Pack entry);
+	// 'data' must stay valid for as long as the renderer exists:
+	void load_font_data(char const *data, size_t size, int pixel_height = 48, Mode mode = Mode::Bitmap, std::string const &preload = "");
+
+	// Pre-rasterized glyphs (the 'bake' tool stores these in a Pack, under baked_glyphs_name()):
+	// save_glyphs() writes out the atlas + glyphs rasterized so far (after load_font*),
+	// load_glyphs() replaces this renderer's atlas + glyphs with saved ones (after load_font* with the same font, size and mode).
+	// load_glyphs() returns false (and changes nothing) if the saved glyphs were made with a different size or mode.
+	void save_glyphs(std::vector< char > *out) const;
+	bool load_glyphs(char const *data, size_t size);
+	static std::string baked_glyphs_name(const std::string &rel_path, int pixel_height, Mode mode);
 
 	// Draw UTF-8 text at world baseline position 'pos_world'.
 	// H_world is total line height in world units (mapped to ascender - descender).
 	// Color is RGBA.
+	// (draws right away, along with anything already queued)
 	void draw_text(glm::mat4 const &world_to_clip,
 		glm::vec2 pos_world,
 		float H_world,
 		glm::vec4 color,
 		std::string const &utf8_text);
 
+	// Same as draw_text, but only queues the text for the next flush():
+	void queue_text(glm::vec2 pos_world,
+		float H_world,
+		glm::vec4 color,
+		std::string const &utf8_text);
+
+	// Draw all queued text:
+	void flush(glm::mat4 const &world_to_clip);
+
+	// Text recorded once and then drawn any number of times (for things that rarely change, like UI):
+	struct Batch {
+		GLuint vao = 0, vbo = 0;
+		size_t vbo_capacity = 0; // bytes
+		GLsizei vertex_count = 0;
+	};
+	// move all queued text into 'batch' (replacing its contents) instead of drawing it:
+	void flush_to(Batch *batch);
+	// draw a recorded batch (still valid after the glyph atlas grows):
+	void draw(Batch const &batch, glm::mat4 const &world_to_clip);
+
+	// Shaping work (strings seen recently are served from a cache instead of being re-shaped):
+	struct Stats {
+		uint64_t shaped = 0;     // strings run through HarfBuzz
+		uint64_t cache_hits = 0; // strings served from the shaping cache
+	} stats;
+
 	~TextRenderer();
 
 private:
 	struct Glyph {
-		GLuint tex = 0;                 // GL texture (GL_RGBA8)
+		glm::ivec2 atlas_at = glm::ivec2(0); // lower-left of bitmap in atlas (px)
 		glm::ivec2 size = glm::ivec2(0);    // bitmap size (px)
 		glm::ivec2 bearing = glm::ivec2(0); // (left, top) in px relative to baseline
 		uint32_t advance26_6 = 0;       // x advance in 26.6
 	};
 
-	struct Quad {
-		GLuint vao = 0, vbo = 0;
-		void init();
-		void draw() const;
-	} quad_;
+	struct Vertex {
+		glm::vec2 position; // world
+		glm::vec2 uv;       // atlas pixels (shader normalizes, so the atlas can grow mid-batch)
+		glm::u8vec4 color;
+	};
+	static_assert(sizeof(Vertex) == 4*2 + 4*2 + 1*4, "Vertex should be packed.");
 
 	struct Shader {
 		GLuint prog = 0;
-		GLint loc_w2c = -1, loc_X = -1, loc_Y = -1, loc_T = -1;
-		GLint loc_tint = -1, loc_sampler = -1;
-		void init();
+		GLint loc_w2c = -1, loc_sampler = -1;
 	} sh_;
 
 	GLuint link_program_(const char *vs_src, const char *fs_src);
 
+	// load_font*() is: start_font_() (FreeType setup), open the face, finish_font_() (metrics, HarfBuzz, atlas, preload):
+	void start_font_(int pixel_height, Mode mode);
+	void finish_font_(std::string const &preload);
+
 	// Glyph cache by glyph index (from HarfBuzz)
 	Glyph const &get_glyph_(uint32_t glyph_index);
 
+	// A shaped string, laid out in pixels relative to its baseline origin:
+	struct ShapedRun {
+		struct Quad {
+			glm::vec2 min_px, max_px; // corners relative to the pen's start
+			glm::vec2 uv_min, uv_max; // atlas pixels (stable: the atlas only grows)
+		};
+		std::vector< Quad > quads;
+	};
+
+	// Shaping cache, keyed by (text, pixel size) with least-recently-used eviction:
+	struct RunKey {
+		std::string_view text;
+		int pixel_height;
+		bool operator==(RunKey const &o) const { return pixel_height == o.pixel_height && text == o.text; }
+	};
+	struct RunKeyHash {
+		size_t operator()(RunKey const &k) const { return std::hash< std::string_view >()(k.text) ^ (size_t(k.pixel_height) * 0x9e3779b97f4a7c15ull); }
+	};
+	struct RunEntry {
+		std::string text; // (RunKeys in run_lookup_ view this)
+		int pixel_height = 0;
+		ShapedRun run;
+	};
+	ShapedRun const &shape_(std::string const &utf8_text);
+	static constexpr size_t RunCacheSize = 256;
+	std::list< RunEntry > runs_; // most recently used first
+	std::unordered_map< RunKey, std::list< RunEntry >::iterator, RunKeyHash > run_lookup_;
+	hb_buffer_t *hb_buf_ = nullptr; // reused for every shape
+
+	// Atlas (GL_R8 coverage; 'atlas_pixels_' mirrors the texture so it can be re-uploaded when grown):
+	void grow_atlas_(uint32_t new_height);
+	void upload_atlas_(); // (whole atlas; once init_gl() has made the texture)
+	ShelfPacker atlas_packer_ = ShelfPacker(glm::uvec2(512, 128), 1);
+	std::vector< uint8_t > atlas_pixels_;
+	GLuint atlas_tex_ = 0;
+
+	// Queued text, and the batch flush() records it into:
+	std::vector< Vertex > batch_;
+	Batch stream_;
+
 	// FT / HB handles
 	FT_Library ft_lib_ = nullptr;
 	FT_Face    ft_face_ = nullptr;
@@ -67,6 +167,7 @@ private:
 
 	// Metrics (pixel units)
 	int pixel_height_ = 48;
+	Mode mode_ = Mode::Bitmap;
 	float ascender_px_ = 0.0f;
 	float descender_px_ = 0.0f; // negative
 
@@ -0,0 +1,95 @@
+#include "Widgets.hpp"
+
+#include <algorithm>
+
+void Widget::clear_children() {
+	if (children.empty()) return;
+	children.clear();
+	mark_dirty();
+}
+
+void Widget::set_offset(glm::vec2 offset_) {
+	if (offset == offset_) return;
+	offset = offset_;
+	mark_dirty();
+}
+
+void Widget::set_visible(bool visible_) {
+	if (visible == visible_) return;
+	visible = visible_;
+	mark_dirty();
+}
+
+void Widget::mark_dirty() {
+	//(stops early: if this widget is dirty, so is everything above it)
+	for (Widget *w = this; w && !w->dirty; w = w->parent) {
+		w->dirty = true;
+	}
+}
+
+void Widget::build_tree(SpriteRenderer &sprites, TextRenderer &text, glm::vec2 origin, bool emit) {
+	//(hidden subtrees are still walked, so their dirty flags get cleared and later changes propagate up again)
+	dirty = false;
+	emit = emit && visible;
+	glm::vec2 at = origin + offset;
+	if (emit) build(sprites, text, at);
+	for (auto &child : children) {
+		child->build_tree(sprites, text, at, emit);
+	}
+}
+
+//------------------------------------------
+
+void LabelWidget::set_text(std::string_view text_) {
+	if (text == text_) return;
+	text = text_;
+	mark_dirty();
+}
+
+void LabelWidget::set_color(glm::vec4 color_) {
+	if (color == color_) return;
+	color = color_;
+	mark_dirty();
+}
+
+void LabelWidget::build(SpriteRenderer &, TextRenderer &text_renderer, glm::vec2 at) const {
+	if (!text.empty()) text_renderer.queue_text(at, height, color, text);
+}
+
+void IconWidget::set_sprite(SpriteRenderer::Sprite const &sprite_) {
+	if (sprite.tex == sprite_.tex && sprite.uv_min == sprite_.uv_min && sprite.uv_max == sprite_.uv_max) return;
+	sprite = sprite_;
+	mark_dirty();
+}
+
+void IconWidget::build(SpriteRenderer &sprites, TextRenderer &, glm::vec2 at) const {
+	sprites.submit(sprite, at, size, 0.0f, tint);
+}
+
+void BarWidget::set_fraction(float fraction_) {
+	fraction_ = std::clamp(fraction_, 0.0f, 1.0f);
+	if (fraction == fraction_) return;
+	fraction = fraction_;
+	mark_dirty();
+}
+
+void BarWidget::build(SpriteRenderer &sprites, TextRenderer &, glm::vec2 at) const {
+	sprites.submit(white, at + 0.5f * size, size, 0.0f, back);
+	if (fraction > 0.0f) {
+		glm::vec2 filled = glm::vec2(size.x * fraction, size.y);
+		sprites.submit(white, at + 0.5f * filled, filled, 0.0f, fill);
+	}
+}
+
+//------------------------------------------
+
+void WidgetTree::draw(SpriteRenderer &sprites, TextRenderer &text, glm::mat4 const &world_to_clip) {
+	if (root.dirty) {
+		root.build_tree(sprites, text, glm::vec2(0.0f));
+		sprites.flush_to(&sprite_batch);
+		text.flush_to(&text_batch);
+		rebuilds += 1;
+	}
+	sprites.draw(sprite_batch, world_to_clip);
+	text.draw(text_batch, world_to_clip);
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+/*
+ * A tiny retained-mode UI: a tree of widgets whose geometry is only rebuilt when something changes.
+ *
+ * Setters compare against the current value and only mark the tree dirty on an actual change.
+ * WidgetTree::draw() re-records its sprite + text batches when the tree is dirty, and otherwise
+ * just redraws the batches it already has (two draw calls, no CPU-side geometry work).
+ *
+ * WidgetTree hud;
+ * Widget *panel = hud.root.add< Widget >(glm::vec2(-1.75f, 0.8f));
+ * LabelWidget *hearts = panel->add< LabelWidget >(glm::vec2(0.0f, -0.12f), 0.12f, glm::vec4(1.0f));
+ * ...every frame:
+ * hearts->set_text(...); //no-op if unchanged
+ * hud.draw(sprites, text, world_to_clip);
+ */
+
+#include "SpriteRenderer.hpp"
+#include "TextRenderer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct Widget {
+	explicit Widget(glm::vec2 offset_ = glm::vec2(0.0f)) : offset(offset_) { }
+	virtual ~Widget() = default;
+
+	//add a child (constructed with 'args'); returns a pointer that stays valid as long as the parent does:
+	template< typename W, typename... Args >
+	W *add(Args&&... args) {
+		children.emplace_back(std::make_unique< W >(std::forward< Args >(args)...));
+		children.back()->parent = this;
+		mark_dirty();
+		return static_cast< W * >(children.back().get());
+	}
+	void clear_children();
+
+	void set_offset(glm::vec2 offset);
+	void set_visible(bool visible);
+
+	//append this widget's geometry (at world position 'at') to the renderers' queues:
+	virtual void build(SpriteRenderer &, TextRenderer &, glm::vec2 at) const { (void)at; }
+
+	//build this widget and children (only emitting geometry for visible ones):
+	void build_tree(SpriteRenderer &sprites, TextRenderer &text, glm::vec2 origin, bool emit = true);
+
+	//flags this widget and everything above it as needing a rebuild:
+	void mark_dirty();
+
+	glm::vec2 offset; //relative to parent
+	bool visible = true;
+	bool dirty = true;
+	Widget *parent = nullptr;
+	std::vector< std::unique_ptr< Widget > > children;
+};
+
+struct LabelWidget : Widget {
+	LabelWidget(glm::vec2 offset_, float height_, glm::vec4 color_, std::string_view text_ = "")
+		: Widget(offset_), text(text_), height(height_), color(color_) { }
+	void set_text(std::string_view text);
+	void set_color(glm::vec4 color);
+	void build(SpriteRenderer &, TextRenderer &, glm::vec2 at) const override;
+
+	std::string text;
+	float height; //line height (world units; see TextRenderer::draw_text)
+	glm::vec4 color;
+};
+
+struct IconWidget : Widget {
+	IconWidget(glm::vec2 offset_, glm::vec2 size_, SpriteRenderer::Sprite const &sprite_ = SpriteRenderer::Sprite())
+		: Widget(offset_), size(size_), sprite(sprite_) { }
+	void set_sprite(SpriteRenderer::Sprite const &sprite);
+	void build(SpriteRenderer &, TextRenderer &, glm::vec2 at) const override;
+
+	glm::vec2 size; //centered on the widget's position
+	SpriteRenderer::Sprite sprite;
+	glm::vec4 tint = glm::vec4(1.0f);
+};
+
+//horizontal bar, filled from the left by 'fraction':
+struct BarWidget : Widget {
+	BarWidget(glm::vec2 offset_, glm::vec2 size_, SpriteRenderer::Sprite const &white_, glm::vec4 fill_, glm::vec4 back_)
+		: Widget(offset_), size(size_), white(white_), fill(fill_), back(back_) { }
+	void set_fraction(float fraction);
+	void build(SpriteRenderer &, TextRenderer &, glm::vec2 at) const override;
+
+	glm::vec2 size; //(full bar) extends right and up from the widget's position
+	SpriteRenderer::Sprite white; //solid white sprite, tinted to draw the bar
+	glm::vec4 fill, back;
+	float fraction = 0.0f;
+};
+
+struct WidgetTree {
+	Widget root;
+
+	//draw the tree, re-recording its geometry first if anything changed.
+	// (expects nothing else to be queued in 'sprites' or 'text')
+	void draw(SpriteRenderer &sprites, TextRenderer &text, glm::mat4 const &world_to_clip);
+
+	uint32_t rebuilds = 0; //how often draw() had to regenerate geometry
+
+	//internals:
+	SpriteRenderer::Batch sprite_batch;
+	TextRenderer::Batch text_batch;
+};
@@ -0,0 +1,126 @@
+//bake converts the assets in a directory (usually dist/) into a single Pack (see Pack.hpp):
+// scenes/bake dist dist/assets.pack
+//
+// .png -> decoded RGBA pixels (bottom row first, as the game loads them)
+// .wav -> decoded 48kHz mono float audio (short effects)
+// .opus, .ttf, .otf, .pnct, .pnci, .scene, .w -> copied as-is (already fine to use in place)
+// fonts listed in BakedFonts (below) also get a pre-rasterized glyph atlas
+// (anything else -- executables, readmes, other packs -- is skipped)
+
+#include "Pack.hpp"
+#include "MappedFile.hpp"
+#include "TextRenderer.hpp"
+#include "load_save_png.hpp"
+#include "load_wav.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//fonts to pre-rasterize glyphs for; should match what the game loads (see 'load_text' in PlayMode.cpp):
+struct BakedFont {
+	char const *rel_path;
+	int pixel_height;
+	TextRenderer::Mode mode;
+};
+static BakedFont const BakedFonts[] = {
+	{ "fonts/Font.ttf", 32, TextRenderer::Mode::SDF },
+};
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	//when compiled on windows, unhandled exceptions don't have their message printed, which can make debugging simple issues difficult.
+	try {
+#endif
+
+	if (argc != 3) {
+		std::cerr << "Usage:\n\t" << argv[0] << " <path/to/dist> <path/to/assets.pack>\nBakes the assets in a directory into a pack file." << std::endl;
+		return 1;
+	}
+	std::filesystem::path in_dir = argv[1];
+	std::string out_file = argv[2];
+
+	auto before = std::chrono::high_resolution_clock::now();
+
+	//gather files (sorted, so the same assets always make the same pack):
+	std::vector< std::string > names;
+	for (auto const &entry : std::filesystem::recursive_directory_iterator(in_dir)) {
+		if (!entry.is_regular_file()) continue;
+		names.emplace_back(entry.path().lexically_relative(in_dir).generic_string());
+	}
+	std::sort(names.begin(), names.end());
+
+	PackWriter pack;
+	uint32_t skipped = 0;
+
+	auto copy_file = [](std::string const &path) {
+		MappedFile file(path);
+		return std::vector< char >(file.data(), file.data() + file.size());
+	};
+
+	for (auto const &name : names) {
+		std::string path = (in_dir / name).string();
+		std::string ext = std::filesystem::path(name).extension().string();
+		std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c){ return char(std::tolower(c)); });
+
+		if (ext == ".png") {
+			glm::uvec2 size;
+			std::vector< glm::u8vec4 > pixels;
+			load_png(path, &size, &pixels, LowerLeftOrigin);
+			pack.add_image(name, size, pixels);
+		} else if (ext == ".wav") {
+			std::vector< float > samples;
+			load_wav(path, &samples);
+			pack.add_audio(name, samples);
+		} else if (ext == ".opus" || ext == ".ttf" || ext == ".otf" || ext == ".pnct" || ext == ".pnci" || ext == ".scene" || ext == ".w") {
+			//(opus is mostly music, which is ~10x bigger decoded -- so it stays compressed, and Sound::Sample decodes it from the pack)
+			pack.add(name, "file", copy_file(path));
+		} else {
+			skipped += 1;
+			continue;
+		}
+		std::cout << "  " << name << " (" << std::string(pack.added.back().type, 4) << ", " << pack.added.back().data.size() << " bytes)" << std::endl;
+	}
+
+	//pre-rasterize glyphs:
+	std::string ascii;
+	for (char c = ' '; c <= '~'; ++c) ascii += c;
+	for (auto const &font : BakedFonts) {
+		if (!std::binary_search(names.begin(), names.end(), std::string(font.rel_path))) {
+			std::cerr << "WARNING: font '" << font.rel_path << "' isn't in '" << in_dir.string() << "'; not baking its glyphs." << std::endl;
+			continue;
+		}
+		MappedFile file((in_dir / font.rel_path).string());
+		TextRenderer text; //(only CPU-side work happens here; no OpenGL context needed)
+		text.load_font_data(file.data(), file.size(), font.pixel_height, font.mode, ascii);
+		std::vector< char > glyphs;
+		text.save_glyphs(&glyphs);
+		std::string name = TextRenderer::baked_glyphs_name(font.rel_path, font.pixel_height, font.mode);
+		pack.add(name, "glyf", std::move(glyphs));
+		std::cout << "  " << name << " (glyf, " << pack.added.back().data.size() << " bytes)" << std::endl;
+	}
+
+	pack.write(out_file);
+
+	auto after = std::chrono::high_resolution_clock::now();
+	std::cout << "Baked " << pack.added.size() << " entries into '" << out_file << "' in "
+	          << std::chrono::duration< double, std::milli >(after - before).count() << " ms"
+	          << " (skipped " << skipped << " other file" << (skipped == 1 ? "" : "s") << ")." << std::endl;
+
+	return 0;
+
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
@@ -0,0 +1,143 @@
+//bench-instancing compares Scene::draw frame times with and without instanced drawing:
+// bench/bench-instancing [copies] [frames]
+//
+// the phone-bank scene (lots of repeated rail pieces) is loaded 'copies' times, stacked in place, and drawn:
+//  - with LitColorTextureProgram, which takes per-object uniforms (one draw call per drawable)
+//  - with ShowSceneProgram, which reads object matrices from an instance buffer (one draw call per repeated mesh)
+
+#include "bench_window.hpp"
+#include "LitColorTextureProgram.hpp"
+#include "ShowSceneProgram.hpp"
+#include "Mesh.hpp"
+#include "Scene.hpp"
+#include "data_path.hpp"
+
+#include <SDL3/SDL_main.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+	struct Result {
+		std::string name;
+		Scene::DrawStats stats;
+		double cpu_ms = 0.0; //Scene::draw, per frame
+		double total_ms = 0.0; //...through glFinish(), per frame
+	};
+
+	Result run(std::string const &name, Scene const &scene, Scene::Camera const &camera, uint32_t frames) {
+		using Clock = std::chrono::steady_clock;
+		Result result;
+		result.name = name;
+
+		glEnable(GL_DEPTH_TEST);
+		glDepthFunc(GL_LESS);
+		double cpu = 0.0, total = 0.0;
+		for (uint32_t frame = 0; frame < frames + 1; ++frame) {
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClearDepth(1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glFinish();
+
+			auto before = Clock::now();
+			scene.draw(camera);
+			auto submitted = Clock::now();
+			glFinish();
+			auto after = Clock::now();
+
+			if (frame == 0) continue; //(first frame sorts the hierarchy and grows buffers)
+			cpu += std::chrono::duration< double, std::milli >(submitted - before).count();
+			total += std::chrono::duration< double, std::milli >(after - before).count();
+		}
+		glDisable(GL_DEPTH_TEST);
+
+		result.stats = scene.draw_stats;
+		result.cpu_ms = cpu / frames;
+		result.total_ms = total / frames;
+		return result;
+	}
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	//when compiled on windows, unhandled exceptions don't have their message printed, which can make debugging simple issues difficult.
+	try {
+#endif
+
+	uint32_t copies = 16;
+	uint32_t frames = 200;
+	if (argc > 3) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [copies] [frames]\nCompares instanced and non-instanced Scene::draw frame times." << std::endl;
+		return 1;
+	}
+	if (argc > 1) copies = std::max(1u, uint32_t(std::strtoul(argv[1], nullptr, 10)));
+	if (argc > 2) frames = std::max(1u, uint32_t(std::strtoul(argv[2], nullptr, 10)));
+
+	BenchWindow window("bench-instancing");
+
+	MeshBuffer meshes(data_path("../dist/phone-bank.pnct"));
+
+	//load phone-bank 'copies' times with drawables using 'pipeline' (and a vertex array made for its program):
+	auto make_scene = [&](Scene::Drawable::Pipeline const &pipeline) {
+		GLuint vao = meshes.make_vao_for_program(pipeline.program);
+		Scene scene;
+		for (uint32_t copy = 0; copy < copies; ++copy) {
+			scene.load(data_path("../dist/phone-bank.scene"), [&](Scene &scene, Scene::Transform *transform, std::string const &mesh_name) {
+				Mesh const &mesh = meshes.lookup(mesh_name);
+
+				scene.drawables.emplace_back(transform);
+				Scene::Drawable &drawable = scene.drawables.back();
+				drawable.pipeline = pipeline;
+				drawable.pipeline.vao = vao;
+				drawable.pipeline.type = mesh.type;
+				drawable.pipeline.start = mesh.start;
+				drawable.pipeline.count = mesh.count;
+				drawable.pipeline.index_type = mesh.index_type;
+				drawable.bounds_min = mesh.min;
+				drawable.bounds_max = mesh.max;
+			});
+		}
+		if (scene.cameras.empty()) throw std::runtime_error("phone-bank.scene has no camera.");
+		scene.cameras.front().aspect = float(window.size.x) / float(window.size.y);
+		return scene;
+	};
+
+	std::vector< Result > results;
+	{
+		Scene scene = make_scene(lit_color_texture_program_pipeline);
+		results.emplace_back(run("per-object uniforms", scene, scene.cameras.front(), frames));
+	}
+	{
+		Scene scene = make_scene(show_scene_program_pipeline);
+		results.emplace_back(run("instanced", scene, scene.cameras.front(), frames));
+	}
+
+	std::cout << "phone-bank x" << copies << ", " << frames << " frames, per frame:" << std::endl;
+	std::cout << "  " << std::left << std::setw(22) << "drawn with" << std::right
+	          << std::setw(10) << "drawables" << std::setw(8) << "culled" << std::setw(8) << "draws"
+	          << std::setw(10) << "cpu ms" << std::setw(10) << "+gpu ms" << std::endl;
+	for (auto const &result : results) {
+		std::cout << "  " << std::left << std::setw(22) << result.name << std::right
+		          << std::setw(10) << result.stats.drawables << std::setw(8) << result.stats.culled << std::setw(8) << result.stats.draws
+		          << std::fixed << std::setprecision(3) << std::setw(10) << result.cpu_ms << std::setw(10) << result.total_ms << std::endl;
+	}
+	std::cout << "(the two programs shade differently, so compare cpu ms; +gpu ms is only a sanity check)" << std::endl;
+
+	return 0;
+
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
@@ -0,0 +1,136 @@
+//bench-loopback measures round-trip latency over loopback TCP for several SocketOptions configurations:
+// bench/bench-loopback [round-trips-per-config] [first-port]
+//
+// a Server on a background thread echoes every C2S_InputMessage frame it gets; the client sends
+// two frames per round trip in separate polls (like an input sent immediately on a key press and
+// then again on the next tick), which is the pattern where Nagle's algorithm and delayed ACKs add
+// the most latency.
+
+#include "Connection.hpp"
+#include "Game.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+	struct Config {
+		char const *name;
+		SocketOptions options;
+	};
+
+	SocketOptions make_options(bool no_delay, int buffer_bytes, int busy_poll_us) {
+		SocketOptions options;
+		options.no_delay = no_delay;
+		options.send_buffer_bytes = buffer_bytes;
+		options.recv_buffer_bytes = buffer_bytes;
+		options.busy_poll_us = busy_poll_us;
+		return options;
+	}
+
+	//run 'rounds' round trips with 'options' on both ends; returns per-round latencies in microseconds:
+	std::vector< double > measure(SocketOptions const &options, std::string const &port, uint32_t rounds) {
+		std::atomic< bool > stop{false};
+		std::atomic< bool > listening{false};
+
+		std::thread server_thread([&]() {
+			Server server(port, options);
+			listening = true;
+			while (!stop) {
+				server.poll([](Connection *c, Connection::Event event) {
+					if (event != Connection::OnRecv) return;
+					C2S_InputMessage message;
+					while (recv_frame(&c->recv_buffer, &message)) {
+						send_frame(message, &c->send_buffer);
+					}
+				}, 0.01);
+			}
+		});
+		while (!listening) std::this_thread::yield();
+
+		std::vector< double > latencies;
+		latencies.reserve(rounds);
+		{
+			Client client("localhost", port, options);
+
+			C2S_InputMessage message;
+			for (uint32_t round = 0; round < rounds; ++round) {
+				auto before = std::chrono::steady_clock::now();
+
+				uint32_t echoed = 0;
+				for (uint32_t i = 0; i < 2; ++i) {
+					message.tick = round * 2 + i;
+					send_frame(message, &client.connection.send_buffer);
+					client.poll(nullptr, 0.0);
+				}
+				while (echoed < 2) {
+					client.poll([&](Connection *c, Connection::Event event) {
+						if (event == Connection::OnClose) throw std::runtime_error("Lost connection to the echo server.");
+						if (event != Connection::OnRecv) return;
+						C2S_InputMessage reply;
+						while (recv_frame(&c->recv_buffer, &reply)) echoed += 1;
+					}, 0.01);
+				}
+
+				auto after = std::chrono::steady_clock::now();
+				latencies.emplace_back(std::chrono::duration< double, std::micro >(after - before).count());
+			}
+		}
+
+		stop = true;
+		server_thread.join();
+		return latencies;
+	}
+}
+
+int main(int argc, char **argv) {
+	uint32_t rounds = 2000;
+	uint32_t first_port = 15466;
+	if (argc > 3) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [round-trips-per-config] [first-port]\nMeasures loopback round-trip latency for several socket option configurations." << std::endl;
+		return 1;
+	}
+	if (argc > 1) rounds = uint32_t(std::max(1ul, std::strtoul(argv[1], nullptr, 10)));
+	if (argc > 2) first_port = uint32_t(std::strtoul(argv[2], nullptr, 10));
+
+	std::vector< Config > configs{
+		{ "defaults (TCP_NODELAY)", SocketOptions() },
+		{ "Nagle (no TCP_NODELAY)", make_options(false, 0, 0) },
+		{ "TCP_NODELAY, 4k buffers", make_options(true, 4 * 1024, 0) },
+		{ "TCP_NODELAY, 256k buffers", make_options(true, 256 * 1024, 0) },
+		{ "TCP_NODELAY, 50us busy poll", make_options(true, 0, 50) },
+	};
+
+	struct Result {
+		char const *name;
+		double p50, p99, max;
+	};
+	std::vector< Result > results;
+	for (auto const &config : configs) {
+		//(Server doesn't close its listening socket, so each config gets its own port)
+		std::string port = std::to_string(first_port + results.size());
+		std::vector< double > latencies = measure(config.options, port, rounds);
+		std::sort(latencies.begin(), latencies.end());
+		auto percentile = [&](double p) {
+			return latencies[std::min(latencies.size() - 1, size_t(p * double(latencies.size())))];
+		};
+		results.emplace_back(Result{ config.name, percentile(0.5), percentile(0.99), latencies.back() });
+	}
+
+	//(printed after all the runs, so it isn't interleaved with Server/Client connection chatter)
+	std::cout << "\nLoopback round trips (2 frames each, " << rounds << " per config), microseconds:" << std::endl;
+	std::cout << "  " << std::left << std::setw(32) << "config" << std::right << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "max" << std::endl;
+	for (auto const &result : results) {
+		std::cout << "  " << std::left << std::setw(32) << result.name << std::right << std::fixed << std::setprecision(1)
+		          << std::setw(10) << result.p50 << std::setw(10) << result.p99 << std::setw(10) << result.max << std::endl;
+	}
+
+	return 0;
+}
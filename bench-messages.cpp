@@ -0,0 +1,103 @@
+//bench-messages measures encode/decode throughput of the messages in Game.hpp:
+// bench/bench-messages [seconds-per-test]
+//
+// each test encodes (or decodes) the same message into a preallocated buffer in a tight loop,
+// which is what the server and client do once per tick per connection.
+
+#include "Game.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+	//keeps the optimizer from throwing away results:
+	volatile size_t sink = 0;
+
+	//call 'step' in batches until 'seconds' have passed; report steps per second and bytes per second:
+	template< typename F >
+	void run(std::string const &label, size_t bytes_per_step, double seconds, F const &step) {
+		using Clock = std::chrono::steady_clock;
+		constexpr uint32_t Batch = 1024;
+
+		for (uint32_t i = 0; i < Batch; ++i) step(); //warm up
+
+		uint64_t steps = 0;
+		auto before = Clock::now();
+		double elapsed = 0.0;
+		while (elapsed < seconds) {
+			for (uint32_t i = 0; i < Batch; ++i) step();
+			steps += Batch;
+			elapsed = std::chrono::duration< double >(Clock::now() - before).count();
+		}
+
+		double per_second = double(steps) / elapsed;
+		std::cout << "  " << std::left << std::setw(40) << label << std::right
+		          << std::setw(8) << std::fixed << std::setprecision(1) << (1e9 / per_second) << " ns/msg"
+		          << std::setw(10) << std::setprecision(2) << (per_second / 1e6) << " M msg/s"
+		          << std::setw(10) << std::setprecision(1) << (per_second * double(bytes_per_step) / (1024.0 * 1024.0)) << " MiB/s"
+		          << " (" << bytes_per_step << " bytes/frame)" << std::endl;
+	}
+
+	template< typename M >
+	void bench_message(std::string const &name, M const &message, double seconds) {
+		std::vector< uint8_t > frame;
+		send_frame(message, &frame);
+
+		std::vector< uint8_t > buffer(frame.size());
+		run("encode " + name, frame.size(), seconds, [&]() {
+			sink = sink + encode_frame(message, buffer.data(), buffer.size());
+		});
+
+		M decoded;
+		run("decode " + name, frame.size(), seconds, [&]() {
+			sink = sink + decode_frame(frame.data(), frame.size(), &decoded);
+		});
+	}
+}
+
+int main(int argc, char **argv) {
+	double seconds = 1.0;
+	if (argc > 2) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [seconds-per-test]\nMeasures message encode/decode throughput." << std::endl;
+		return 1;
+	}
+	if (argc > 1) seconds = std::strtod(argv[1], nullptr);
+
+	C2S_InputMessage input;
+	input.tick = 12345;
+	input.left = 0x81;
+	input.actions = Action_Attack;
+
+	//a mid-round snapshot, as the server sends every tick:
+	S2C_StateMessage state;
+	state.phase = Phase::Playing;
+	for (auto name : { "Player One", "Player Two" }) {
+		auto &player = *state.players.push_back();
+		player.position = glm::vec2(1.5f, 2.5f);
+		player.velocity = glm::vec2(0.25f, -0.5f);
+		player.color = glm::vec3(0.8f, 0.2f, 0.1f);
+		player.name.assign(name);
+		player.ready = 1;
+		player.hp = 3;
+	}
+
+	//worst case: a full list with full-length names:
+	S2C_StateMessage full = state;
+	while (full.players.push_back()) { }
+	for (auto &player : full.players) player.name.assign(std::string(255, 'x'));
+
+	S2C_FailMessage fail;
+	fail.text.assign("Server is full.");
+
+	std::cout << "Message throughput (" << seconds << " s per test):" << std::endl;
+	bench_message("C2S_Input", input, seconds);
+	bench_message("S2C_State (2 players)", state, seconds);
+	bench_message("S2C_State (8 players, long names)", full, seconds);
+	bench_message("S2C_Fail", fail, seconds);
+
+	return 0;
+}
@@ -0,0 +1,123 @@
+//bench-mixer times the audio callback's mixing kernel (mix_span.hpp) with hundreds of voices per block:
+// bench/bench-mixer [voices] [blocks]
+//
+// every voice adds one block of its own (ramping) audio into a shared stereo buffer, as the mixer's final pass does;
+// each kernel this build has is timed, and the one Sound actually uses on this CPU is marked.
+// (by default, sweeps a few voice counts)
+
+#include "mix_span.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+	constexpr uint32_t AudioRate = 48000;
+	constexpr uint32_t BlockSamples = 512; //(about what SDL asks for per callback)
+
+	struct Kernel {
+		char const *name;
+		MixSpanFn fn;
+	};
+
+	struct Voice {
+		float const *src;
+		float gain_l, gain_r;
+		float step_l, step_r;
+	};
+
+	//mix 'blocks' blocks of 'voices' into 'out'; returns microseconds per block:
+	double run(MixSpanFn fn, std::vector< Voice > const &voices, uint32_t blocks, std::vector< float > *out) {
+		using Clock = std::chrono::steady_clock;
+		auto before = Clock::now();
+		for (uint32_t block = 0; block < blocks; ++block) {
+			std::fill(out->begin(), out->end(), 0.0f);
+			for (auto const &v : voices) {
+				fn(v.src, BlockSamples, out->data(), v.gain_l, v.gain_r, v.step_l, v.step_r);
+			}
+		}
+		auto after = Clock::now();
+		return std::chrono::duration< double, std::micro >(after - before).count() / blocks;
+	}
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	//when compiled on windows, unhandled exceptions don't have their message printed, which can make debugging simple issues difficult.
+	try {
+#endif
+
+	std::vector< uint32_t > voice_counts{ 64, 256, 1024 };
+	uint32_t blocks = 2000;
+	if (argc > 3) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [voices] [blocks]\nTimes the audio mixing kernels." << std::endl;
+		return 1;
+	}
+	if (argc > 1) voice_counts = { std::max(1u, uint32_t(std::strtoul(argv[1], nullptr, 10))) };
+	if (argc > 2) blocks = std::max(1u, uint32_t(std::strtoul(argv[2], nullptr, 10)));
+
+	std::vector< Kernel > kernels{ { "scalar", mix_span_scalar } };
+	if (mix_span_sse2) kernels.emplace_back(Kernel{ "sse2", mix_span_sse2 });
+	if (mix_span_avx && cpu_has_avx()) kernels.emplace_back(Kernel{ "avx", mix_span_avx });
+
+	//plenty of different source audio, so voices don't all read the same (cached) samples:
+	std::mt19937 mt(0xa0d10);
+	std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+	uint32_t const max_voices = *std::max_element(voice_counts.begin(), voice_counts.end());
+	std::vector< float > audio(size_t(max_voices) * BlockSamples + 3);
+	for (auto &s : audio) s = unit(mt);
+
+	double const block_us = 1e6 * BlockSamples / AudioRate;
+	std::cout << BlockSamples << "-sample blocks (" << std::fixed << std::setprecision(0) << block_us << "us of audio), "
+	          << blocks << " blocks per run; Sound uses '" << mix_span_name << "' on this CPU." << std::endl;
+	std::cout << "  " << std::right << std::setw(8) << "voices" << std::setw(10) << "kernel"
+	          << std::setw(14) << "us/block" << std::setw(14) << "% realtime" << std::setw(14) << "max error" << std::endl;
+
+	for (uint32_t count : voice_counts) {
+		std::vector< Voice > voices(count);
+		for (uint32_t i = 0; i < count; ++i) {
+			Voice &v = voices[i];
+			v.src = audio.data() + size_t(i) * BlockSamples + (i % 4); //(unaligned, like real spans)
+			v.gain_l = 0.5f + 0.5f * unit(mt);
+			v.gain_r = 0.5f + 0.5f * unit(mt);
+			v.step_l = 1e-4f * unit(mt);
+			v.step_r = 1e-4f * unit(mt);
+		}
+
+		std::vector< float > reference(2 * BlockSamples);
+		run(mix_span_scalar, voices, 1, &reference);
+
+		for (auto const &kernel : kernels) {
+			std::vector< float > out(2 * BlockSamples);
+			run(kernel.fn, voices, 1, &out); //(warm up)
+			double us = run(kernel.fn, voices, blocks, &out);
+
+			float error = 0.0f;
+			for (uint32_t i = 0; i < out.size(); ++i) error = std::max(error, std::abs(out[i] - reference[i]));
+
+			std::string name = std::string(kernel.name) + (kernel.fn == mix_span ? "*" : "");
+			std::cout << "  " << std::setw(8) << count << std::setw(10) << name
+			          << std::fixed << std::setprecision(2) << std::setw(14) << us << std::setw(14) << 100.0 * us / block_us
+			          << std::scientific << std::setprecision(1) << std::setw(14) << error << std::endl;
+		}
+	}
+	std::cout << "(* = the kernel Sound uses; error is against the scalar kernel)" << std::endl;
+
+	return 0;
+
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
@@ -0,0 +1,114 @@
+//bench-png times decoding every PNG in dist/ with load_png:
+// bench/bench-png [iterations]
+//
+// each image is decoded two ways:
+//  - from its file into a std::vector (the load_png most code uses)
+//  - from an already-mapped file straight into a padded atlas-style buffer (what PlayMode's loaders do),
+//    which skips opening the file and the copy into SpriteRenderer's layout
+
+#include "load_save_png.hpp"
+#include "MappedFile.hpp"
+#include "data_path.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+	struct Result {
+		std::string name;
+		glm::uvec2 size = glm::uvec2(0);
+		double file_ms = 0.0; //per decode
+		double mapped_ms = 0.0; //per decode
+	};
+
+	template< typename F >
+	double time_ms(uint32_t iterations, F const &decode) {
+		using Clock = std::chrono::steady_clock;
+		decode(); //(warm up the file cache and allocator)
+		auto before = Clock::now();
+		for (uint32_t i = 0; i < iterations; ++i) decode();
+		auto after = Clock::now();
+		return std::chrono::duration< double, std::milli >(after - before).count() / iterations;
+	}
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	//when compiled on windows, unhandled exceptions don't have their message printed, which can make debugging simple issues difficult.
+	try {
+#endif
+
+	uint32_t iterations = 200;
+	if (argc > 2) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [iterations]\nTimes decoding the PNGs in dist/." << std::endl;
+		return 1;
+	}
+	if (argc > 1) iterations = std::max(1u, uint32_t(std::strtoul(argv[1], nullptr, 10)));
+
+	std::vector< std::string > paths;
+	for (auto const &entry : std::filesystem::directory_iterator(data_path("../dist"))) {
+		if (entry.is_regular_file() && entry.path().extension() == ".png") paths.emplace_back(entry.path().string());
+	}
+	std::sort(paths.begin(), paths.end());
+	if (paths.empty()) {
+		std::cerr << "No PNGs found in '" << data_path("../dist") << "'." << std::endl;
+		return 1;
+	}
+
+	std::vector< Result > results;
+	for (auto const &path : paths) {
+		Result result;
+		result.name = std::filesystem::path(path).filename().string();
+
+		std::vector< glm::u8vec4 > data;
+		result.file_ms = time_ms(iterations, [&]() {
+			load_png(path, &result.size, &data, LowerLeftOrigin);
+		});
+
+		MappedFile file(path);
+		std::vector< glm::u8vec4 > padded;
+		result.mapped_ms = time_ms(iterations, [&]() {
+			load_png(file.data(), file.size(), [&](glm::uvec2 size) {
+				padded.resize(size_t(size.x + 2) * (size.y + 2));
+				return PNGDestination{ padded.data() + size.x + 2 + 1, size.x + 2 };
+			}, LowerLeftOrigin);
+		});
+
+		results.emplace_back(result);
+	}
+
+	std::cout << paths.size() << " images, " << iterations << " decodes each, per decode:" << std::endl;
+	std::cout << "  " << std::left << std::setw(16) << "image" << std::right << std::setw(12) << "size"
+	          << std::setw(12) << "file ms" << std::setw(12) << "mapped ms" << std::setw(12) << "MPix/s" << std::endl;
+	double total_file = 0.0, total_mapped = 0.0;
+	for (auto const &result : results) {
+		double pixels = double(result.size.x) * double(result.size.y);
+		std::cout << "  " << std::left << std::setw(16) << result.name << std::right
+		          << std::setw(12) << (std::to_string(result.size.x) + "x" + std::to_string(result.size.y))
+		          << std::fixed << std::setprecision(3) << std::setw(12) << result.file_ms << std::setw(12) << result.mapped_ms
+		          << std::setprecision(1) << std::setw(12) << pixels / (result.mapped_ms * 1000.0) << std::endl;
+		total_file += result.file_ms;
+		total_mapped += result.mapped_ms;
+	}
+	std::cout << "  " << std::left << std::setw(28) << "all" << std::right << std::fixed << std::setprecision(3)
+	          << std::setw(12) << total_file << std::setw(12) << total_mapped << std::endl;
+	std::cout << "(MPix/s is for the mapped decode)" << std::endl;
+
+	return 0;
+
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
@@ -0,0 +1,200 @@
+//bench-scene-binds draws the phone-bank scene and reports how much pipeline state Scene::draw switches:
+// bench/bench-scene-binds [copies] [frames]
+//
+// for each setup, the binds drawing in list order would need are compared against the binds Scene::draw
+// actually issued after sorting its render queue, along with CPU/GPU frame time:
+//  - "phone-bank": the scene as exported (one program, one vertex array, the default white texture)
+//  - "mixed state": drawables alternate between two vertex arrays and four textures, so list order
+//    switches state on nearly every drawable
+// the scene is loaded 'copies' times (stacked in place) to make the frame heavier.
+
+#include "bench_window.hpp"
+#include "LitColorTextureProgram.hpp"
+#include "Mesh.hpp"
+#include "Scene.hpp"
+#include "data_path.hpp"
+
+#include <SDL3/SDL_main.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+	struct Binds {
+		uint32_t program = 0, vao = 0, texture = 0;
+	};
+
+	//binds needed to draw 'scene' in list order, only re-binding what changed:
+	Binds list_order_binds(Scene const &scene) {
+		Binds binds;
+		Scene::Drawable::Pipeline const *prev = nullptr;
+		for (auto const &drawable : scene.drawables) {
+			auto const &pipeline = drawable.pipeline;
+			if (!prev || pipeline.program != prev->program) binds.program += 1;
+			if (!prev || pipeline.vao != prev->vao) binds.vao += 1;
+			for (uint32_t i = 0; i < Scene::Drawable::Pipeline::TextureCount; ++i) {
+				if (pipeline.textures[i].texture == 0) continue;
+				if (!prev || pipeline.textures[i].texture != prev->textures[i].texture) binds.texture += 1;
+			}
+			prev = &pipeline;
+		}
+		return binds;
+	}
+
+	struct Result {
+		std::string name;
+		uint32_t drawables = 0;
+		Binds list_order;
+		Scene::DrawStats stats;
+		double cpu_ms = 0.0; //Scene::draw, per frame
+		double total_ms = 0.0; //...through glFinish(), per frame
+	};
+
+	Result run(std::string const &name, Scene const &scene, Scene::Camera const &camera, uint32_t frames) {
+		using Clock = std::chrono::steady_clock;
+		Result result;
+		result.name = name;
+		result.list_order = list_order_binds(scene);
+
+		glEnable(GL_DEPTH_TEST);
+		glDepthFunc(GL_LESS);
+		double cpu = 0.0, total = 0.0;
+		for (uint32_t frame = 0; frame < frames + 1; ++frame) {
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClearDepth(1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glFinish();
+
+			auto before = Clock::now();
+			scene.draw(camera);
+			auto submitted = Clock::now();
+			glFinish();
+			auto after = Clock::now();
+
+			if (frame == 0) continue; //(first frame sorts the hierarchy and grows buffers)
+			cpu += std::chrono::duration< double, std::milli >(submitted - before).count();
+			total += std::chrono::duration< double, std::milli >(after - before).count();
+		}
+		glDisable(GL_DEPTH_TEST);
+
+		result.drawables = scene.draw_stats.drawables + scene.draw_stats.culled;
+		result.stats = scene.draw_stats;
+		result.cpu_ms = cpu / frames;
+		result.total_ms = total / frames;
+		return result;
+	}
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	//when compiled on windows, unhandled exceptions don't have their message printed, which can make debugging simple issues difficult.
+	try {
+#endif
+
+	uint32_t copies = 4;
+	uint32_t frames = 200;
+	if (argc > 3) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [copies] [frames]\nMeasures pipeline state switches when drawing the phone-bank scene." << std::endl;
+		return 1;
+	}
+	if (argc > 1) copies = std::max(1u, uint32_t(std::strtoul(argv[1], nullptr, 10)));
+	if (argc > 2) frames = std::max(1u, uint32_t(std::strtoul(argv[2], nullptr, 10)));
+
+	BenchWindow window("bench-scene-binds");
+
+	MeshBuffer plain(data_path("../dist/phone-bank.pnct"));
+	MeshBuffer indexed(data_path("../dist/phone-bank.pnci"));
+	GLuint vaos[2] = {
+		plain.make_vao_for_program(lit_color_texture_program->program),
+		indexed.make_vao_for_program(lit_color_texture_program->program),
+	};
+	MeshBuffer const *buffers[2] = { &plain, &indexed };
+
+	//a few 1-pixel textures for the mixed setup:
+	GLuint textures[4];
+	glGenTextures(4, textures);
+	for (uint32_t i = 0; i < 4; ++i) {
+		glm::u8vec4 texel(uint8_t(0xff - 0x30 * i), 0xff, uint8_t(0x40 * i), 0xff);
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &texel);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	//load phone-bank 'copies' times; 'mixed' picks each drawable's vertex array and texture round-robin:
+	auto make_scene = [&](bool mixed) {
+		Scene scene;
+		uint32_t index = 0;
+		for (uint32_t copy = 0; copy < copies; ++copy) {
+			scene.load(data_path("../dist/phone-bank.scene"), [&](Scene &scene, Scene::Transform *transform, std::string const &mesh_name) {
+				uint32_t which = (mixed ? index % 2 : 0);
+				Mesh const &mesh = buffers[which]->lookup(mesh_name);
+
+				scene.drawables.emplace_back(transform);
+				Scene::Drawable &drawable = scene.drawables.back();
+				drawable.pipeline = lit_color_texture_program_pipeline;
+				drawable.pipeline.vao = vaos[which];
+				drawable.pipeline.type = mesh.type;
+				drawable.pipeline.start = mesh.start;
+				drawable.pipeline.count = mesh.count;
+				drawable.pipeline.index_type = mesh.index_type;
+				if (mixed) drawable.pipeline.textures[0].texture = textures[(index / 2) % 4];
+				drawable.bounds_min = mesh.min;
+				drawable.bounds_max = mesh.max;
+				index += 1;
+			});
+		}
+		if (scene.cameras.empty()) throw std::runtime_error("phone-bank.scene has no camera.");
+		scene.cameras.front().aspect = float(window.size.x) / float(window.size.y);
+		return scene;
+	};
+
+	std::vector< Result > results;
+	{
+		Scene scene = make_scene(false);
+		results.emplace_back(run("phone-bank", scene, scene.cameras.front(), frames));
+	}
+	{
+		Scene scene = make_scene(true);
+		results.emplace_back(run("mixed state", scene, scene.cameras.front(), frames));
+	}
+
+	std::cout << "phone-bank x" << copies << ", " << frames << " frames; binds are 'list order -> Scene::draw':" << std::endl;
+	std::cout << "  " << std::left << std::setw(14) << "setup" << std::right
+	          << std::setw(10) << "drawables" << std::setw(8) << "culled" << std::setw(8) << "draws"
+	          << std::setw(14) << "programs" << std::setw(14) << "vaos" << std::setw(14) << "textures"
+	          << std::setw(10) << "cpu ms" << std::setw(10) << "+gpu ms" << std::endl;
+	for (auto const &result : results) {
+		auto binds = [](uint32_t before, uint32_t after) {
+			return std::to_string(before) + " -> " + std::to_string(after);
+		};
+		std::cout << "  " << std::left << std::setw(14) << result.name << std::right
+		          << std::setw(10) << result.drawables << std::setw(8) << result.stats.culled << std::setw(8) << result.stats.draws
+		          << std::setw(14) << binds(result.list_order.program, result.stats.program_binds)
+		          << std::setw(14) << binds(result.list_order.vao, result.stats.vao_binds)
+		          << std::setw(14) << binds(result.list_order.texture, result.stats.texture_binds)
+		          << std::fixed << std::setprecision(3) << std::setw(10) << result.cpu_ms << std::setw(10) << result.total_ms << std::endl;
+	}
+	std::cout << "(list order binds count every drawable; Scene::draw skips culled ones)" << std::endl;
+
+	glDeleteTextures(4, textures);
+
+	return 0;
+
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
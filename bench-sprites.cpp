@@ -0,0 +1,160 @@
+//bench-sprites draws a few thousand sprites per frame with SpriteRenderer and reports draw calls and frame times:
+// bench/bench-sprites [sprites] [frames]
+//
+// the same sprites are drawn three ways:
+//  - from atlas images (add_image), which should batch into a single draw call
+//  - from separate textures (whole_texture), which costs one draw call per texture
+//  - from separate textures with every sprite on its own layer, which defeats grouping entirely (the worst case)
+
+#include "bench_window.hpp"
+#include "SpriteRenderer.hpp"
+
+#include <SDL3/SDL_main.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+	constexpr uint32_t ImageCount = 8;
+	constexpr uint32_t ImageSize = 32;
+
+	//a distinctly-colored square with a darker border, so the output is at least recognizable in a debugger:
+	std::vector< glm::u8vec4 > make_image(uint32_t index) {
+		glm::u8vec4 fill(uint8_t(64 + 24 * index), uint8_t(255 - 24 * index), uint8_t(index * 97), 0xff);
+		std::vector< glm::u8vec4 > pixels(ImageSize * ImageSize, fill);
+		for (uint32_t y = 0; y < ImageSize; ++y) {
+			for (uint32_t x = 0; x < ImageSize; ++x) {
+				if (x == 0 || y == 0 || x + 1 == ImageSize || y + 1 == ImageSize) pixels[y * ImageSize + x] = glm::u8vec4(fill.r / 2, fill.g / 2, fill.b / 2, 0xff);
+			}
+		}
+		return pixels;
+	}
+
+	struct Placement {
+		glm::vec2 center;
+		float radians;
+		uint32_t image;
+	};
+
+	struct Result {
+		std::string name;
+		uint32_t draw_calls = 0;
+		double cpu_ms = 0.0; //begin() through flush(), per frame
+		double total_ms = 0.0; //...through glFinish(), per frame
+	};
+
+	Result run(std::string const &name, SpriteRenderer &sprites, std::vector< SpriteRenderer::Sprite > const &images, std::vector< Placement > const &placements, bool layer_per_sprite, uint32_t frames) {
+		using Clock = std::chrono::steady_clock;
+		glm::mat4 world_to_clip(1.0f); //(placements are already in clip space)
+		glm::vec2 size(0.02f, 0.02f);
+
+		Result result;
+		result.name = name;
+		double cpu = 0.0, total = 0.0;
+		for (uint32_t frame = 0; frame < frames + 1; ++frame) {
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			glFinish();
+
+			auto before = Clock::now();
+			sprites.begin(world_to_clip);
+			for (uint32_t i = 0; i < placements.size(); ++i) {
+				Placement const &p = placements[i];
+				sprites.submit(images[p.image], p.center, size, p.radians, glm::vec4(1.0f), layer_per_sprite ? i : 0);
+			}
+			sprites.flush();
+			auto submitted = Clock::now();
+			glFinish();
+			auto after = Clock::now();
+
+			if (frame == 0) continue; //(first frame grows buffers)
+			cpu += std::chrono::duration< double, std::milli >(submitted - before).count();
+			total += std::chrono::duration< double, std::milli >(after - before).count();
+			result.draw_calls = sprites.stats.draw_calls;
+		}
+		result.cpu_ms = cpu / frames;
+		result.total_ms = total / frames;
+		return result;
+	}
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+	//when compiled on windows, unhandled exceptions don't have their message printed, which can make debugging simple issues difficult.
+	try {
+#endif
+
+	uint32_t sprite_count = 5000;
+	uint32_t frames = 200;
+	if (argc > 3) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [sprites] [frames]\nMeasures SpriteRenderer draw calls and frame times." << std::endl;
+		return 1;
+	}
+	if (argc > 1) sprite_count = uint32_t(std::strtoul(argv[1], nullptr, 10));
+	if (argc > 2) frames = std::max(1u, uint32_t(std::strtoul(argv[2], nullptr, 10)));
+
+	BenchWindow window("bench-sprites");
+
+	SpriteRenderer sprites;
+	sprites.init();
+
+	std::vector< SpriteRenderer::Sprite > atlas_images;
+	std::vector< SpriteRenderer::Sprite > texture_images;
+	for (uint32_t i = 0; i < ImageCount; ++i) {
+		std::vector< glm::u8vec4 > pixels = make_image(i);
+		atlas_images.emplace_back(sprites.add_image(glm::uvec2(ImageSize), pixels.data()));
+
+		GLuint tex = 0;
+		glGenTextures(1, &tex);
+		glBindTexture(GL_TEXTURE_2D, tex);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, ImageSize, ImageSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		texture_images.emplace_back(SpriteRenderer::whole_texture(tex));
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	//random placements, with images interleaved (as they would be in a real scene):
+	std::mt19937 mt(0x5917e5);
+	std::uniform_real_distribution< float > coord(-1.0f, 1.0f);
+	std::vector< Placement > placements(sprite_count);
+	for (uint32_t i = 0; i < sprite_count; ++i) {
+		placements[i] = Placement{ glm::vec2(coord(mt), coord(mt)), coord(mt) * 3.14159f, uint32_t(mt() % ImageCount) };
+	}
+
+	std::vector< Result > results{
+		run("atlas", sprites, atlas_images, placements, false, frames),
+		run("separate textures", sprites, texture_images, placements, false, frames),
+		run("separate textures, layer each", sprites, texture_images, placements, true, frames),
+	};
+
+	std::cout << sprite_count << " sprites (" << ImageCount << " images), " << frames << " frames, per frame:" << std::endl;
+	std::cout << "  " << std::left << std::setw(32) << "sprites from" << std::right << std::setw(12) << "draw calls" << std::setw(12) << "cpu ms" << std::setw(12) << "+gpu ms" << std::endl;
+	for (auto const &result : results) {
+		std::cout << "  " << std::left << std::setw(32) << result.name << std::right << std::setw(12) << result.draw_calls
+		          << std::fixed << std::setprecision(3) << std::setw(12) << result.cpu_ms << std::setw(12) << result.total_ms << std::endl;
+	}
+
+	for (auto const &sprite : texture_images) {
+		glDeleteTextures(1, &sprite.tex);
+	}
+
+	return 0;
+
+#ifdef _WIN32
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	} catch (...) {
+		std::cerr << "Unhandled exception (unknown type)." << std::endl;
+		throw;
+	}
+#endif
+}
@@ -0,0 +1,79 @@
+#include "bench_window.hpp"
+
+#include "Mode.hpp"
+#include "Load.hpp"
+#include "gl_errors.hpp"
+
+#include <stdexcept>
+#include <string>
+
+BenchWindow::BenchWindow(char const *title, glm::uvec2 size_) : size(size_) {
+	if (!SDL_Init(SDL_INIT_VIDEO)) {
+		throw std::runtime_error("Error initializing SDL: " + std::string(SDL_GetError()));
+	}
+
+	//same context as the game asks for (see client.cpp):
+	SDL_GL_ResetAttributes();
+	SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+	SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+
+	Mode::window = SDL_CreateWindow(title, int(size.x), int(size.y), SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+	if (!Mode::window) {
+		throw std::runtime_error("Error creating SDL window: " + std::string(SDL_GetError()));
+	}
+
+	context = SDL_GL_CreateContext(Mode::window);
+	if (!context) {
+		SDL_DestroyWindow(Mode::window);
+		Mode::window = nullptr;
+		throw std::runtime_error("Error creating OpenGL context: " + std::string(SDL_GetError()));
+	}
+
+	//On windows, load OpenGL entrypoints: (does nothing on other platforms)
+	init_GL();
+
+	SDL_GL_SetSwapInterval(0);
+
+	//offscreen framebuffer to draw into:
+	glGenRenderbuffers(1, &color_renderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, color_renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_SRGB8_ALPHA8, GLsizei(size.x), GLsizei(size.y));
+	glGenRenderbuffers(1, &depth_renderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth_renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, GLsizei(size.x), GLsizei(size.y));
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_renderbuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth_renderbuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		throw std::runtime_error("Benchmark framebuffer is incomplete.");
+	}
+	glViewport(0, 0, GLsizei(size.x), GLsizei(size.y));
+	glEnable(GL_FRAMEBUFFER_SRGB);
+	GL_ERRORS();
+
+	call_load_functions();
+}
+
+BenchWindow::~BenchWindow() {
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &color_renderbuffer);
+	glDeleteRenderbuffers(1, &depth_renderbuffer);
+
+	SDL_GL_DestroyContext(context);
+	context = nullptr;
+
+	SDL_DestroyWindow(Mode::window);
+	Mode::window = nullptr;
+}
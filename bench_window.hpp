@@ -0,0 +1,32 @@
+#pragma once
+
+/*
+ * BenchWindow sets up what the OpenGL benchmarks (bench-*.cpp) need:
+ *  - a hidden window with an OpenGL 3.3 core context (no vsync, so frames aren't paced by the display)
+ *  - an offscreen framebuffer of 'size' pixels, bound for drawing (a hidden window's own framebuffer may never be drawn)
+ *  - Load<> resources (e.g., shader programs), via call_load_functions()
+ *
+ * BenchWindow window("bench-something");
+ * //...draw things, calling glFinish() when timings should include the GPU...
+ *
+ */
+
+#include "GL.hpp"
+
+#include <SDL3/SDL.h>
+#include <glm/glm.hpp>
+
+struct BenchWindow {
+	//throws std::runtime_error if the window or context can't be created:
+	explicit BenchWindow(char const *title, glm::uvec2 size = glm::uvec2(1280, 720));
+	~BenchWindow();
+
+	BenchWindow(BenchWindow const &) = delete;
+	BenchWindow &operator=(BenchWindow const &) = delete;
+
+	glm::uvec2 size;
+	SDL_GLContext context = nullptr;
+	GLuint framebuffer = 0;
+	GLuint color_renderbuffer = 0;
+	GLuint depth_renderbuffer = 0;
+};
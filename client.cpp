@@ -17,6 +17,8 @@
 #include <stdexcept>
 #include <memory>
 #include <algorithm>
+#include <cstdlib>
+#include <string>
 
 #ifdef _WIN32
 extern "C" { uint32_t GetACP(); }
@@ -37,10 +39,25 @@ int main(int argc, char **argv) {
 	try {
 #endif
 	//------------ command line arguments ------------
-	if (argc != 3) {
-		std::cerr << "Usage:\n\t./client <host> <port>" << std::endl;
+	auto usage = [&]() {
+		std::cerr << "Usage:\n\t./client <host> <port> [--load-timing] [--load-workers <count>]" << std::endl;
+	};
+	if (argc < 3) {
+		usage();
 		return 1;
 	}
+	for (int arg = 3; arg < argc; ++arg) {
+		std::string flag = argv[arg];
+		if (flag == "--load-timing") {
+			print_load_timing = true;
+		} else if (flag == "--load-workers" && arg + 1 < argc) {
+			load_worker_count = uint32_t(std::max(1l, std::strtol(argv[arg + 1], nullptr, 10)));
+			arg += 1;
+		} else {
+			usage();
+			return 1;
+		}
+	}
 
 	//------------ connect to server --------------
 	Client client(argv[1], argv[2]);
@@ -182,6 +199,9 @@ int main(int argc, char **argv) {
 
 			Mode::current->update(elapsed);
 			if (!Mode::current) break;
+
+			//send along any sound changes that are still waiting for room in the mixer's queue:
+			Sound::update();
 		}
 
 		{ //(3) call the current mode's "draw" function to produce output:
@@ -0,0 +1,183 @@
+//fuzz-messages throws random and mutated frames at the decoders in message_codec.hpp:
+// bench/fuzz-messages [iterations] [seed]
+//
+// every input is handed to peek_frame() and to decode_frame() for every message type in Game.hpp;
+// a decoder may accept the frame, say it isn't complete yet, or throw std::runtime_error -- anything
+// else (a crash, some other exception, reading past the end, or a decoded message that doesn't
+// re-encode to the same bytes) is a bug, and the fuzzer stops with the offending input.
+
+#include "Game.hpp"
+#include "hex_dump.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+	std::mt19937 mt;
+
+	uint8_t random_byte() {
+		return uint8_t(mt());
+	}
+
+	template< size_t N >
+	void random_str8(Str8< N > *str) {
+		std::string text(mt() % (N + 1), ' ');
+		for (auto &c : text) c = char(random_byte());
+		str->assign(text);
+	}
+
+	//well-formed messages with random contents:
+	C2S_InputMessage random_input() {
+		C2S_InputMessage message;
+		message.tick = uint32_t(mt());
+		message.left = random_byte();
+		message.right = random_byte();
+		message.up = random_byte();
+		message.down = random_byte();
+		message.jump = random_byte();
+		message.actions = random_byte();
+		return message;
+	}
+
+	S2C_StateMessage random_state() {
+		S2C_StateMessage message;
+		message.phase = Phase(mt() % (uint32_t(FrameEnum< Phase >::Max) + 1));
+		message.winner_index = int8_t(random_byte());
+		uint32_t count = mt() % 9;
+		for (uint32_t i = 0; i < count; ++i) {
+			auto &player = *message.players.push_back();
+			player.position = glm::vec2(float(mt() % 1000), float(mt() % 1000));
+			player.velocity = glm::vec2(float(mt() % 1000), float(mt() % 1000));
+			player.color = glm::vec3(float(mt() % 256), float(mt() % 256), float(mt() % 256)) / 255.0f;
+			random_str8(&player.name);
+			player.ready = random_byte();
+			player.hp = random_byte();
+		}
+		return message;
+	}
+
+	S2C_FailMessage random_fail() {
+		S2C_FailMessage message;
+		random_str8(&message.text);
+		return message;
+	}
+
+	//damage a (usually well-formed) frame in one of a few ways:
+	void mutate(std::vector< uint8_t > *frame_) {
+		auto &frame = *frame_;
+		switch (mt() % 6) {
+			case 0: //flip some bits:
+				for (uint32_t n = 1 + mt() % 4; n > 0 && !frame.empty(); --n) {
+					frame[mt() % frame.size()] ^= uint8_t(1 << (mt() % 8));
+				}
+				break;
+			case 1: //overwrite some bytes:
+				for (uint32_t n = 1 + mt() % 4; n > 0 && !frame.empty(); --n) {
+					frame[mt() % frame.size()] = random_byte();
+				}
+				break;
+			case 2: //truncate:
+				frame.resize(mt() % (frame.size() + 1));
+				break;
+			case 3: //append junk:
+				for (uint32_t n = 1 + mt() % 16; n > 0; --n) frame.emplace_back(random_byte());
+				break;
+			case 4: //lie about the payload size:
+				if (frame.size() >= FrameHeaderSize) {
+					uint32_t size = mt() % (frame.size() + 32);
+					frame[1] = uint8_t(size);
+					frame[2] = uint8_t(size >> 8);
+					frame[3] = uint8_t(size >> 16);
+				}
+				break;
+			case 5: //change the type byte:
+				if (!frame.empty()) frame[0] = random_byte();
+				break;
+		}
+	}
+
+	//run one decoder over 'input'; returns false if it misbehaved:
+	template< typename M >
+	bool try_decode(std::vector< uint8_t > const &input, char const *name, uint32_t *accepted, uint32_t *rejected) {
+		//decode from an exactly-sized heap copy, so reads past the end show up under a sanitizer:
+		std::vector< uint8_t > exact(input);
+		M message;
+		size_t used = 0;
+		try {
+			used = decode_frame(exact.data(), exact.size(), &message);
+		} catch (std::runtime_error const &) {
+			*rejected += 1;
+			return true;
+		} catch (std::exception const &e) {
+			std::cerr << "decode_frame< " << name << " > threw something other than std::runtime_error: " << e.what() << std::endl;
+			return false;
+		}
+		if (used == 0) return true;
+		if (used > exact.size()) {
+			std::cerr << "decode_frame< " << name << " > claimed " << used << " bytes of a " << exact.size() << "-byte input." << std::endl;
+			return false;
+		}
+		*accepted += 1;
+
+		//anything accepted must re-encode to exactly the bytes it came from:
+		std::vector< uint8_t > again;
+		send_frame(message, &again);
+		if (again.size() != used || !std::equal(again.begin(), again.end(), exact.begin())) {
+			std::cerr << "decode_frame< " << name << " > accepted a frame that re-encodes differently:\n" << hex_dump(again.data(), again.size()) << std::endl;
+			return false;
+		}
+		return true;
+	}
+}
+
+int main(int argc, char **argv) {
+	uint32_t iterations = 1000000;
+	uint32_t seed = 0x5eed;
+	if (argc > 3) {
+		std::cerr << "Usage:\n\t" << argv[0] << " [iterations] [seed]\nFeeds random and mutated frames to the message decoders." << std::endl;
+		return 1;
+	}
+	if (argc > 1) iterations = uint32_t(std::strtoul(argv[1], nullptr, 10));
+	if (argc > 2) seed = uint32_t(std::strtoul(argv[2], nullptr, 10));
+	mt.seed(seed);
+
+	uint32_t accepted = 0, rejected = 0;
+	std::vector< uint8_t > input;
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+		input.clear();
+		uint32_t kind = mt() % 4;
+		if (kind == 0) {
+			//pure noise:
+			for (uint32_t n = mt() % 64; n > 0; --n) input.emplace_back(random_byte());
+		} else {
+			//a damaged copy of a real frame:
+			if (kind == 1) send_frame(random_input(), &input);
+			else if (kind == 2) send_frame(random_state(), &input);
+			else send_frame(random_fail(), &input);
+			for (uint32_t n = 1 + mt() % 3; n > 0; --n) mutate(&input);
+		}
+
+		uint8_t type = 0;
+		uint32_t payload_size = 0;
+		if (peek_frame(input.data(), input.size(), &type, &payload_size) && payload_size > MaxFramePayload) {
+			std::cerr << "peek_frame returned a payload size larger than a frame can hold." << std::endl;
+			return 1;
+		}
+
+		bool ok = try_decode< C2S_InputMessage >(input, "C2S_InputMessage", &accepted, &rejected)
+		       && try_decode< S2C_StateMessage >(input, "S2C_StateMessage", &accepted, &rejected)
+		       && try_decode< S2C_FailMessage >(input, "S2C_FailMessage", &accepted, &rejected);
+		if (!ok) {
+			std::cerr << "Failing input (iteration " << iteration << ", seed " << seed << "):\n" << hex_dump(input.data(), input.size()) << std::endl;
+			return 1;
+		}
+	}
+
+	std::cout << "Fuzzed " << iterations << " inputs: " << accepted << " decoded, " << rejected << " rejected as malformed, no failures." << std::endl;
+	return 0;
+}
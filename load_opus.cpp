@@ -3,30 +3,26 @@
 #include <opusfile.h>
 
 #include <cassert>
-#include <memory>
+#include <algorithm>
 #include <cmath>
 #include <stdexcept>
 #include <iostream>
 
-void load_opus(std::string const &filename, std::vector< float > *data_) {
+void load_opus(std::string const &filename, std::vector< float > *data) {
+	load_opus(filename, nullptr, 0, data);
+}
+
+void load_opus(std::string const &filename, char const *opus_data, size_t opus_size, std::vector< float > *data_) {
 	assert(data_);
 	auto &data = *data_;
 	data.clear();
 
 	std::cout << "loading '" << filename << "'..."; std::cout.flush();
 
-	//will hold opusfile * int a std::unique_ptr so that it will automatically be deleted:
-	int err = 0;
-	std::unique_ptr< OggOpusFile, decltype(&op_free) > op(
-		op_open_file(filename.c_str(), &err), //pointer to hold
-		op_free //deletion function
-	);
-	if (err != 0) {
-		throw std::runtime_error("opusfile error " + std::to_string(err) + " opening \"" + filename + "\".");
-	}
+	OpusStream opus(filename, opus_data, opus_size);
 
 	//get length in samples:
-	ogg_int64_t length = op_pcm_total(op.get(), -1);
+	int64_t length = opus.length();
 	if (length >= 0) {
 		data.reserve(length);
 	} else {
@@ -35,20 +31,65 @@ void load_opus(std::string const &filename, std::vector< float > *data_) {
 		data.reserve(2*48000);
 	}
 
-	std::vector< float > pcm(2*48000*2, 0.0f); //seems like reads are generally 960 samples so this is definitely overkill
 	for (;;) {
-		int ret = op_read_float_stereo(op.get(), pcm.data(), int(pcm.size()));
-		if (ret >= 0) {
-			//positive return values are the number of samples read per channel; copy into data:
-			data.reserve(data.size() + ret);
+		//decode directly onto the end of data:
+		size_t at = data.size();
+		data.resize(at + 48000);
+		uint32_t ret = opus.read(data.data() + at, 48000);
+		data.resize(at + ret);
+		if (ret == 0) break;
+	}
+
+	std::cout << " done." << std::endl;
+}
+
+//------------------------------------------
+
+OpusStream::OpusStream(std::string const &filename_, char const *opus_data, size_t opus_size) : filename(filename_) {
+	int err = 0;
+	if (opus_data) {
+		op = op_open_memory(reinterpret_cast< unsigned char const * >(opus_data), opus_size, &err);
+	} else {
+		op = op_open_file(filename.c_str(), &err);
+	}
+	if (err != 0 || op == nullptr) {
+		if (op) op_free(op);
+		throw std::runtime_error("opusfile error " + std::to_string(err) + " opening \"" + filename + "\".");
+	}
+	pcm.resize(2*5760); //(5760 samples is the longest an opus packet can be)
+}
+
+OpusStream::~OpusStream() {
+	op_free(op);
+}
+
+uint32_t OpusStream::read(float *data, uint32_t count) {
+	uint32_t total = 0;
+	while (total < count) {
+		int want = int(std::min< size_t >(pcm.size(), 2 * size_t(count - total)));
+		int ret = op_read_float_stereo(op, pcm.data(), want);
+		if (ret > 0) {
+			//positive return values are the number of samples read per channel; downmix to mono by averaging:
 			for (uint32_t i = 0; i < uint32_t(ret); ++i) {
-				data.emplace_back((pcm[2*i] + pcm[2*i+1]) * 0.5f); //downmix to mono by averaging
+				data[total + i] = (pcm[2*i] + pcm[2*i+1]) * 0.5f;
 			}
-			if (ret == 0) break;
+			total += uint32_t(ret);
+		} else if (ret == 0) {
+			break; //end of file
 		} else {
 			throw std::runtime_error("opusfile read error " + std::to_string(ret) + " reading \"" + filename + "\".");
 		}
 	}
+	return total;
+}
 
-	std::cout << " done." << std::endl;
+void OpusStream::rewind() {
+	int ret = op_pcm_seek(op, 0);
+	if (ret != 0) {
+		throw std::runtime_error("opusfile error " + std::to_string(ret) + " seeking to the start of \"" + filename + "\".");
+	}
+}
+
+int64_t OpusStream::length() const {
+	return int64_t(op_pcm_total(op, -1));
 }
@@ -2,6 +2,35 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
 
 //Load an opus file as 48kHz floating-point mono; throws on error:
 void load_opus(std::string const &filename, std::vector< float > *data);
+//...the same, for an opus file that is already in memory (e.g. a Pack entry; 'name' is only used in messages):
+void load_opus(std::string const &name, char const *opus_data, size_t opus_size, std::vector< float > *data);
+
+//Decode an opus file a little at a time (e.g., for music, which is large once fully decoded):
+struct OggOpusFile;
+struct OpusStream {
+	//open 'filename'; throws on error:
+	// (or, if 'opus_data' is given, decode from those bytes -- which must outlive the OpusStream -- and use 'filename' only in messages)
+	explicit OpusStream(std::string const &filename, char const *opus_data = nullptr, size_t opus_size = 0);
+	~OpusStream();
+	OpusStream(OpusStream const &) = delete;
+	OpusStream &operator=(OpusStream const &) = delete;
+
+	//decode up to 'count' samples of 48kHz floating-point mono into 'data';
+	// returns the number of samples decoded (0 at the end of the file); throws on error:
+	uint32_t read(float *data, uint32_t count);
+
+	//go back to the start of the file; throws on error:
+	void rewind();
+
+	//length in samples (or -1 if it can't be determined):
+	int64_t length() const;
+
+	//internals:
+	std::string filename;
+	OggOpusFile *op = nullptr;
+	std::vector< float > pcm; //stereo samples (before downmixing)
+};
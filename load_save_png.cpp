@@ -1,27 +1,43 @@
 #include "load_save_png.hpp"
 
+#include "MappedFile.hpp"
+
 #include <png.h>
 
 #include <iostream>
 #include <fstream>
 #include <cassert>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
 #include <vector>
 
 #define LOG_ERROR( X ) std::cerr << X << std::endl
 
 using std::vector;
 
-bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vector< glm::u8vec4 > *data, OriginLocation origin);
 void save_png(std::ostream &to, unsigned int width, unsigned int height, glm::u8vec4 const *data, OriginLocation origin);
 
 void load_png(std::string filename, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin) {
 	assert(size);
+	assert(data);
 
-	std::ifstream file(filename.c_str(), std::ios::binary);
-	if (!file) {
+	//libpng reads straight from the mapping (rather than through many small stream reads):
+	std::unique_ptr< MappedFile > file;
+	try {
+		file = std::make_unique< MappedFile >(filename);
+	} catch (std::exception &) {
 		throw std::runtime_error("Failed to open PNG image file '" + filename + "'.");
 	}
-	if (!load_png(file, &size->x, &size->y, data, origin)) {
+	try {
+		load_png(file->data(), file->size(), [&](glm::uvec2 size_) {
+			*size = size_;
+			data->resize(size_t(size_.x) * size_.y);
+			return PNGDestination{ data->data(), 0 };
+		}, origin);
+	} catch (std::exception &) {
+		*size = glm::uvec2(0);
+		data->clear();
 		throw std::runtime_error("Failed to read PNG image from '" + filename + "'.");
 	}
 }
@@ -32,12 +48,21 @@ void save_png(std::string filename, glm::uvec2 size, glm::u8vec4 const *data, Or
 }
 
 
-static void user_read_data(png_structp png_ptr, png_bytep data, png_size_t length) {
-	std::istream *from = reinterpret_cast< std::istream * >(png_get_io_ptr(png_ptr));
+namespace {
+	struct MemoryReader {
+		char const *at;
+		char const *end;
+	};
+}
+
+static void user_read_memory(png_structp png_ptr, png_bytep data, png_size_t length) {
+	MemoryReader *from = reinterpret_cast< MemoryReader * >(png_get_io_ptr(png_ptr));
 	assert(from);
-	if (!from->read(reinterpret_cast< char * >(data), length)) {
-		png_error(png_ptr, "Error reading.");
+	if (size_t(from->end - from->at) < length) {
+		png_error(png_ptr, "Error reading (unexpected end of data).");
 	}
+	std::memcpy(data, from->at, length);
+	from->at += length;
 }
 
 static void user_write_data(png_structp png_ptr, png_bytep data, png_size_t length) {
@@ -57,38 +82,27 @@ static void user_flush_data(png_structp png_ptr) {
 }
 
 
-bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vector< glm::u8vec4 > *data, OriginLocation origin) {
-	assert(data);
-	uint32_t local_width, local_height;
-	if (width == nullptr) width = &local_width;
-	if (height == nullptr) height = &local_height;
-	*width = *height = 0;
-	data->clear();
-	//..... load file ......
+void load_png(char const *png_data, size_t png_size, std::function< PNGDestination(glm::uvec2 size) > const &destination, OriginLocation origin) {
+	MemoryReader from{ png_data, png_data + png_size };
+
 	//Load a png file, as per the libpng docs:
 	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, (png_voidp)NULL, (png_error_ptr)NULL, (png_error_ptr)NULL);
-
-	png_set_read_fn(png, &from, user_read_data);
-
 	if (!png) {
-		LOG_ERROR("  cannot alloc read struct.");
-		return false;
+		throw std::runtime_error("Cannot alloc PNG read struct.");
 	}
+	png_set_read_fn(png, &from, user_read_memory);
+
 	png_infop info = png_create_info_struct(png);
 	if (!info) {
-		LOG_ERROR("  cannot alloc info struct.");
 		png_destroy_read_struct(&png, (png_infopp)NULL, (png_infopp)NULL);
-		return false;
+		throw std::runtime_error("Cannot alloc PNG info struct.");
 	}
-	png_bytep *row_pointers = NULL;
+	//NOTE: locals changed between a setjmp() and the longjmp() back to it are indeterminate afterward,
+	// so nothing below is changed after the setjmp() that guards it (and row_pointers gets its own, below).
 	if (setjmp(png_jmpbuf(png))) {
-		LOG_ERROR("  png interal error.");
 		png_destroy_read_struct(&png, &info, (png_infopp)NULL);
-		if (row_pointers != NULL) delete[] row_pointers;
-		data->clear();
-		return false;
+		throw std::runtime_error("PNG internal error.");
 	}
-	//not needed with custom read/write functions: png_init_io(png, NULL);
 	png_read_info(png, info);
 	unsigned int w = png_get_image_width(png, info);
 	unsigned int h = png_get_image_height(png, info);
@@ -107,24 +121,34 @@ bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vec
 	png_read_update_info(png, info);
 	size_t rowbytes = png_get_rowbytes(png, info);
 	//Make sure it's the format we think it is...
-	assert(rowbytes == w*sizeof(uint32_t));
+	assert(rowbytes == w*sizeof(uint32_t)); (void)rowbytes;
+
+	PNGDestination to;
+	try {
+		to = destination(glm::uvec2(w, h));
+	} catch (...) {
+		png_destroy_read_struct(&png, &info, NULL);
+		throw;
+	}
+	size_t stride = (to.stride ? to.stride : w);
+	assert(stride >= w);
 
-	data->resize(w*h);
-	row_pointers = new png_bytep[h];
+	//rows are decoded directly into place, bottom-up or top-down as requested:
+	std::vector< png_bytep > row_pointers(h);
 	for (unsigned int r = 0; r < h; ++r) {
 		if (origin == LowerLeftOrigin) {
-			row_pointers[h-1-r] = (png_bytep)(&(*data)[r*w]);
+			row_pointers[h-1-r] = (png_bytep)(to.pixels + size_t(r) * stride);
 		} else {
-			row_pointers[r] = (png_bytep)(&(*data)[r*w]);
+			row_pointers[r] = (png_bytep)(to.pixels + size_t(r) * stride);
 		}
 	}
-	png_read_image(png, row_pointers);
+	//(re-armed now that row_pointers is filled in, so an error while decoding leaves it intact to be destroyed)
+	if (setjmp(png_jmpbuf(png))) {
+		png_destroy_read_struct(&png, &info, (png_infopp)NULL);
+		throw std::runtime_error("PNG internal error.");
+	}
+	png_read_image(png, row_pointers.data());
 	png_destroy_read_struct(&png, &info, NULL);
-	delete[] row_pointers;
-
-	*width = w;
-	*height = h;
-	return true;
 }
 
 
@@ -2,6 +2,7 @@
 
 #include <glm/glm.hpp>
 
+#include <functional>
 #include <string>
 #include <vector>
 #include <stdint.h>
@@ -17,4 +18,14 @@ enum OriginLocation {
 
 //NOTE: load_png will throw on error
 void load_png(std::string filename, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin);
+
+//Decode a PNG that is already in memory (e.g. a MappedFile's bytes), writing each row straight to its final place:
+// 'destination' is called once the image size is known, and returns where to put the pixels:
+// row r (counting from 'origin') starts at pixels + r * stride.
+// (doesn't touch any shared state, so several images can be decoded at once on different threads)
+struct PNGDestination {
+	glm::u8vec4 *pixels = nullptr;
+	size_t stride = 0; //in pixels; 0 means size.x (rows packed together)
+};
+void load_png(char const *png_data, size_t png_size, std::function< PNGDestination(glm::uvec2 size) > const &destination, OriginLocation origin);
 void save_png(std::string filename, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin);
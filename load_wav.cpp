@@ -1,4 +1,5 @@
 #include "load_wav.hpp"
+#include "resample.hpp"
 
 #include <SDL3/SDL.h>
 
@@ -19,11 +20,15 @@ void load_wav(std::string const &filename, std::vector< float > *data_) {
 	if (!SDL_LoadWAV(filename.c_str(), &audio_spec, &audio_buf, &audio_len)) {
 		throw std::runtime_error("Failed to load WAV file '" + filename + "'; SDL says \"" + std::string(SDL_GetError()) + "\"");
 	}
-	SDL_AudioSpec out_spec{ .format=SDL_AUDIO_F32, .channels=1, .freq=AUDIO_RATE };
-	if (audio_spec.format != out_spec.format || audio_spec.channels != out_spec.channels || audio_spec.freq != out_spec.freq) {
+	if (audio_spec.format != SDL_AUDIO_F32 || audio_spec.channels != 1 || audio_spec.freq != int(AUDIO_RATE)) {
+		std::cout << "WAV file '" + filename + "' didn't load as " + std::to_string(AUDIO_RATE) + " Hz, float32, mono; converting." << std::endl;
+	}
+
+	//SDL handles sample format and channel conversion (but not rate conversion -- see below):
+	SDL_AudioSpec out_spec{ .format=SDL_AUDIO_F32, .channels=1, .freq=audio_spec.freq };
+	if (audio_spec.format != out_spec.format || audio_spec.channels != out_spec.channels) {
 		Uint8 *out_buf = NULL;
 		int out_len = 0;
-		std::cout << "WAV file '" + filename + "' didn't load as " + std::to_string(AUDIO_RATE) + " Hz, float32, mono; converting." << std::endl;
 
 		if (!SDL_ConvertAudioSamples(&audio_spec, audio_buf, audio_len, &out_spec, &out_buf, &out_len)) {
 			//shouldn't happen, but if it does treat as fatal
@@ -44,6 +49,13 @@ void load_wav(std::string const &filename, std::vector< float > *data_) {
 	SDL_free(audio_buf);
 	audio_buf = NULL;
 
+	//rate conversion uses our own resampler (a high-quality windowed-sinc filter):
+	if (audio_spec.freq != int(AUDIO_RATE)) {
+		std::vector< float > converted;
+		resample(data, uint32_t(audio_spec.freq), AUDIO_RATE, &converted);
+		data = std::move(converted);
+	}
+
 	/* DEBUG: give audio range info:
 	float min = 0.0f;
 	float max = 0.0f;
@@ -0,0 +1,315 @@
+#pragma once
+
+/*
+ * Encoding/decoding for the framed messages sent over a Connection.
+ *
+ * Every frame on the wire looks like:
+ * |ty|s0|s1|s2| <-- one-byte message type, then 24-bit (little-endian) payload size
+ * |payload....| <-- 'size' bytes: the message's fields in order (native endian, no padding)
+ *
+ * A message struct declares its type byte and its fields exactly once;
+ * the encoder and decoder are generated from that declaration:
+ *
+ * struct Ping {
+ *     static constexpr uint8_t Type = 'p';
+ *     uint32_t id = 0;
+ *     Str8< 32 > note;
+ *     static constexpr auto Fields = std::make_tuple(&Ping::id, &Ping::note);
+ * };
+ *
+ * send_frame(ping, &connection.send_buffer); //append one frame
+ * if (recv_frame(&connection.recv_buffer, &ping)) { ... } //pop a frame if a complete 'Ping' is first in the buffer
+ *
+ * Fields may be:
+ *  - any trivially-copyable type (integers, enums, glm vectors, fixed-size arrays) -- copied bytewise
+ *    (enum fields must also specialize FrameEnum< E > so the decoder can range-check them)
+ *  - Str8< N > -- up to N (<= 255) bytes of text, sent with a one-byte length
+ *  - List8< T, N > -- up to N (<= 255) T's, sent with a one-byte count
+ *  - another struct with its own 'Fields'
+ *
+ * Messages built only from fixed-size fields have a compile-time payload size and are decoded
+ * after a single bounds check. Nothing here allocates, other than send_frame growing its vector.
+ * Malformed payloads (bad lengths, trailing bytes, out-of-range enums) throw std::runtime_error.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+#include <stdexcept>
+#include <type_traits>
+#include <algorithm>
+#include <cassert>
+
+//fixed-capacity string (no heap), sent as a one-byte length followed by the bytes:
+template< size_t N >
+struct Str8 {
+	static_assert(N <= 255, "Str8 length must fit in one byte.");
+	uint8_t size = 0;
+	char data[N];
+
+	//(silently truncates to N bytes)
+	void assign(std::string_view str) {
+		size = uint8_t(std::min(str.size(), N));
+		std::memcpy(data, str.data(), size);
+	}
+	std::string_view view() const { return std::string_view(data, size); }
+};
+
+//fixed-capacity list (no heap), sent as a one-byte count followed by the elements:
+template< typename T, size_t N >
+struct List8 {
+	static_assert(N <= 255, "List8 count must fit in one byte.");
+	uint8_t size = 0;
+	T data[N];
+
+	//returns nullptr if the list is full:
+	T *push_back() { return (size < N ? &data[size++] : nullptr); }
+	T *begin() { return data; }
+	T *end() { return data + size; }
+	T const *begin() const { return data; }
+	T const *end() const { return data + size; }
+};
+
+//valid range of an enum field, [0, Max], checked on decode:
+// template< > struct FrameEnum< Phase > { static constexpr Phase Max = Phase::RoundEnd; };
+template< typename E >
+struct FrameEnum;
+
+constexpr size_t FrameHeaderSize = 4;
+constexpr uint32_t MaxFramePayload = (1u << 24) - 1;
+
+namespace frame_detail {
+	template< typename T, typename = void > struct has_fields : std::false_type { };
+	template< typename T > struct has_fields< T, std::void_t< decltype(T::Fields) > > : std::true_type { };
+
+	template< typename T > struct is_str8 : std::false_type { };
+	template< size_t N > struct is_str8< Str8< N > > : std::true_type { };
+
+	template< typename T, typename = void > struct has_frame_enum : std::false_type { };
+	template< typename T > struct has_frame_enum< T, std::void_t< decltype(FrameEnum< T >::Max) > > : std::true_type { };
+
+	template< typename T > struct is_list8 : std::false_type { };
+	template< typename T, size_t N > struct is_list8< List8< T, N > > : std::true_type {
+		using Element = T;
+		static constexpr size_t Capacity = N;
+	};
+
+	//does T always encode to the same number of bytes?
+	template< typename T >
+	constexpr bool is_fixed() {
+		if constexpr (has_fields< T >::value) {
+			return std::apply([](auto... members) {
+				return (is_fixed< std::remove_cv_t< std::remove_reference_t< decltype(std::declval< T const & >().*members) > > >() && ...);
+			}, T::Fields);
+		} else if constexpr (is_str8< T >::value || is_list8< T >::value) {
+			return false;
+		} else {
+			static_assert(std::is_trivially_copyable_v< T >, "Message fields must be trivially copyable, Str8, List8, or structs with 'Fields'.");
+			static_assert(!std::is_enum_v< T > || has_frame_enum< T >::value, "Enum message fields need a FrameEnum< E > specialization giving their range.");
+			return true;
+		}
+	}
+
+	//encoded size of fixed-size T:
+	template< typename T >
+	constexpr size_t fixed_size() {
+		static_assert(is_fixed< T >(), "fixed_size() only makes sense for fixed-size types");
+		if constexpr (has_fields< T >::value) {
+			return std::apply([](auto... members) {
+				return (size_t(0) + ... + fixed_size< std::remove_cv_t< std::remove_reference_t< decltype(std::declval< T const & >().*members) > > >());
+			}, T::Fields);
+		} else {
+			return sizeof(T);
+		}
+	}
+
+	template< typename T >
+	size_t encoded_size(T const &value) {
+		if constexpr (is_fixed< T >()) {
+			return fixed_size< T >();
+		} else if constexpr (has_fields< T >::value) {
+			return std::apply([&](auto... members) {
+				return (size_t(0) + ... + encoded_size(value.*members));
+			}, T::Fields);
+		} else if constexpr (is_str8< T >::value) {
+			return 1 + size_t(value.size);
+		} else { static_assert(is_list8< T >::value);
+			using Element = typename is_list8< T >::Element;
+			if constexpr (is_fixed< Element >()) {
+				return 1 + size_t(value.size) * fixed_size< Element >();
+			} else {
+				size_t total = 1;
+				for (auto const &element : value) total += encoded_size(element);
+				return total;
+			}
+		}
+	}
+
+	//write 'value' at 'at' (caller guarantees encoded_size(value) bytes of room); returns end of written data:
+	template< typename T >
+	uint8_t *write(uint8_t *at, T const &value) {
+		if constexpr (has_fields< T >::value) {
+			std::apply([&](auto... members) {
+				((at = write(at, value.*members)), ...);
+			}, T::Fields);
+			return at;
+		} else if constexpr (is_str8< T >::value) {
+			*at = value.size;
+			std::memcpy(at + 1, value.data, value.size);
+			return at + 1 + value.size;
+		} else if constexpr (is_list8< T >::value) {
+			*(at++) = value.size;
+			for (auto const &element : value) at = write(at, element);
+			return at;
+		} else {
+			std::memcpy(at, &value, sizeof(T));
+			return at + sizeof(T);
+		}
+	}
+
+	//read a 'T' from [at, end); returns end of read data, or nullptr if the data doesn't fit/is invalid.
+	// with Checked == false, the caller has already verified that fixed_size< T >() bytes are available.
+	template< bool Checked, typename T >
+	uint8_t const *read(uint8_t const *at, uint8_t const *end, T *value) {
+		if constexpr (Checked && is_fixed< T >()) {
+			//one bounds check for the whole (fixed-size) thing, then read it unchecked:
+			if (size_t(end - at) < fixed_size< T >()) return nullptr;
+			return read< false >(at, end, value);
+		} else if constexpr (has_fields< T >::value) {
+			std::apply([&](auto... members) {
+				(((at = (at ? read< Checked >(at, end, &(value->*members)) : nullptr))), ...);
+			}, T::Fields);
+			return at;
+		} else if constexpr (is_str8< T >::value) {
+			if (at == end) return nullptr;
+			uint8_t size = *at;
+			if (size > sizeof(value->data) || size_t(end - at - 1) < size) return nullptr;
+			value->size = size;
+			std::memcpy(value->data, at + 1, size);
+			return at + 1 + size;
+		} else if constexpr (is_list8< T >::value) {
+			using Element = typename is_list8< T >::Element;
+			if (at == end) return nullptr;
+			uint8_t count = *(at++);
+			if (count > is_list8< T >::Capacity) return nullptr;
+			value->size = count;
+			if constexpr (is_fixed< Element >()) {
+				if (size_t(end - at) < count * fixed_size< Element >()) return nullptr;
+				for (auto &element : *value) {
+					at = read< false >(at, end, &element);
+					if (!at) return nullptr;
+				}
+			} else {
+				for (auto &element : *value) {
+					at = read< true >(at, end, &element);
+					if (!at) return nullptr;
+				}
+			}
+			return at;
+		} else if constexpr (std::is_enum_v< T >) {
+			using U = std::underlying_type_t< T >;
+			U raw;
+			std::memcpy(&raw, at, sizeof(U));
+			if constexpr (std::is_signed_v< U >) {
+				if (raw < U(0)) return nullptr;
+			}
+			if (raw > U(FrameEnum< T >::Max)) return nullptr;
+			*value = T(raw);
+			return at + sizeof(T);
+		} else {
+			std::memcpy(value, at, sizeof(T));
+			return at + sizeof(T);
+		}
+	}
+
+	template< typename M >
+	constexpr uint8_t type_byte() {
+		return uint8_t(M::Type);
+	}
+}
+
+//payload size of 'message' (not counting the header):
+template< typename M >
+size_t frame_payload_size(M const &message) {
+	return frame_detail::encoded_size(message);
+}
+
+//encode 'message' as a frame into [dst, dst + capacity); returns bytes written, or 0 if it doesn't fit:
+template< typename M >
+size_t encode_frame(M const &message, uint8_t *dst, size_t capacity) {
+	size_t size = frame_detail::encoded_size(message);
+	if (size > MaxFramePayload) throw std::runtime_error("Message too large for a frame.");
+	if (capacity < FrameHeaderSize + size) return 0;
+	dst[0] = frame_detail::type_byte< M >();
+	dst[1] = uint8_t(size);
+	dst[2] = uint8_t(size >> 8);
+	dst[3] = uint8_t(size >> 16);
+	uint8_t *end = frame_detail::write(dst + FrameHeaderSize, message);
+	assert(end == dst + FrameHeaderSize + size);
+	(void)end;
+	return FrameHeaderSize + size;
+}
+
+//append 'message' as a frame to the end of 'to':
+template< typename M >
+void send_frame(M const &message, std::vector< uint8_t > *to_) {
+	assert(to_);
+	auto &to = *to_;
+	size_t size = frame_detail::encoded_size(message);
+	size_t begin = to.size();
+	to.resize(begin + FrameHeaderSize + size);
+	encode_frame(message, to.data() + begin, FrameHeaderSize + size);
+}
+
+//read the header of the frame at the start of [data, data + size):
+// returns false if there aren't enough bytes for a header yet.
+inline bool peek_frame(uint8_t const *data, size_t size, uint8_t *type, uint32_t *payload_size) {
+	if (size < FrameHeaderSize) return false;
+	*type = data[0];
+	*payload_size = uint32_t(data[1]) | (uint32_t(data[2]) << 8) | (uint32_t(data[3]) << 16);
+	return true;
+}
+
+//decode a frame of type 'M' at the start of [data, data + size):
+// returns the number of bytes the frame used, or 0 if the data starts with some other type of frame or the frame isn't complete yet.
+// throws on malformed frames.
+template< typename M >
+size_t decode_frame(uint8_t const *data, size_t size, M *message) {
+	assert(message);
+	uint8_t type = 0;
+	uint32_t payload_size = 0;
+	if (!peek_frame(data, size, &type, &payload_size)) return 0;
+	if (type != frame_detail::type_byte< M >()) return 0;
+
+	if constexpr (frame_detail::is_fixed< M >()) {
+		//fixed-size messages can be rejected before the rest of the payload arrives:
+		if (payload_size != frame_detail::fixed_size< M >()) {
+			throw std::runtime_error("Message of type " + std::to_string(int(type)) + " with size " + std::to_string(payload_size) + " != " + std::to_string(frame_detail::fixed_size< M >()) + "!");
+		}
+	}
+	if (size - FrameHeaderSize < payload_size) return 0;
+
+	uint8_t const *begin = data + FrameHeaderSize;
+	uint8_t const *end = begin + payload_size;
+	uint8_t const *at = frame_detail::read< !frame_detail::is_fixed< M >() >(begin, end, message);
+	if (!at) throw std::runtime_error("Malformed message of type " + std::to_string(int(type)) + ".");
+	if (at != end) throw std::runtime_error("Trailing data in message of type " + std::to_string(int(type)) + ".");
+
+	return FrameHeaderSize + payload_size;
+}
+
+//decode a frame of type 'M' from the start of 'from' and erase it:
+// returns false (and leaves 'from' alone) if 'from' starts with some other type of frame or the frame isn't complete yet.
+// throws on malformed frames.
+template< typename M >
+bool recv_frame(std::vector< uint8_t > *from_, M *message) {
+	assert(from_);
+	auto &from = *from_;
+	size_t used = decode_frame(from.data(), from.size(), message);
+	if (used == 0) return false;
+	from.erase(from.begin(), from.begin() + used);
+	return true;
+}
@@ -0,0 +1,110 @@
+#include "mix_span.hpp"
+
+//x86 builds get SSE2 and AVX mixing kernels (picked between at runtime, below):
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIX_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define MIX_TARGET_AVX //(MSVC allows AVX intrinsics anywhere)
+#else
+#define MIX_TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+void mix_span_scalar(float const *src, uint32_t count, float *out, float gain_l, float gain_r, float step_l, float step_r) {
+	for (uint32_t i = 0; i < count; ++i) {
+		out[2 * i + 0] += gain_l * src[i];
+		out[2 * i + 1] += gain_r * src[i];
+		gain_l += step_l;
+		gain_r += step_r;
+	}
+}
+
+#if defined(MIX_X86)
+namespace {
+	//four stereo samples at a time with SSE2 (which every x86-64 CPU has):
+	void sse2_kernel(float const *src, uint32_t count, float *out, float gain_l, float gain_r, float step_l, float step_r) {
+		uint32_t i = 0;
+		//lanes are (l0, r0, l1, r1) and (l2, r2, l3, r3):
+		__m128 gain_lo = _mm_setr_ps(gain_l, gain_r, gain_l + step_l, gain_r + step_r);
+		__m128 gain_hi = _mm_setr_ps(gain_l + 2.0f * step_l, gain_r + 2.0f * step_r, gain_l + 3.0f * step_l, gain_r + 3.0f * step_r);
+		__m128 step4 = _mm_setr_ps(4.0f * step_l, 4.0f * step_r, 4.0f * step_l, 4.0f * step_r);
+		for (; i + 4 <= count; i += 4) {
+			__m128 s = _mm_loadu_ps(src + i);
+			//duplicate each mono sample into both channels:
+			__m128 s_lo = _mm_unpacklo_ps(s, s);
+			__m128 s_hi = _mm_unpackhi_ps(s, s);
+			_mm_storeu_ps(out + 2 * i, _mm_add_ps(_mm_loadu_ps(out + 2 * i), _mm_mul_ps(s_lo, gain_lo)));
+			_mm_storeu_ps(out + 2 * i + 4, _mm_add_ps(_mm_loadu_ps(out + 2 * i + 4), _mm_mul_ps(s_hi, gain_hi)));
+			gain_lo = _mm_add_ps(gain_lo, step4);
+			gain_hi = _mm_add_ps(gain_hi, step4);
+		}
+		//leftovers:
+		mix_span_scalar(src + i, count - i, out + 2 * i, gain_l + float(i) * step_l, gain_r + float(i) * step_r, step_l, step_r);
+	}
+
+	//...and with AVX (compiled for AVX whatever the build flags, so only called if the CPU has it):
+	MIX_TARGET_AVX void avx_kernel(float const *src, uint32_t count, float *out, float gain_l, float gain_r, float step_l, float step_r) {
+		uint32_t i = 0;
+		//eight stereo samples per step; lanes are (l0, r0, l1, r1, l2, r2, l3, r3) and (l4, r4, ..., l7, r7):
+		__m256 gain_lo = _mm256_setr_ps(
+			gain_l, gain_r,
+			gain_l + 1.0f * step_l, gain_r + 1.0f * step_r,
+			gain_l + 2.0f * step_l, gain_r + 2.0f * step_r,
+			gain_l + 3.0f * step_l, gain_r + 3.0f * step_r);
+		__m256 step4 = _mm256_setr_ps(
+			4.0f * step_l, 4.0f * step_r, 4.0f * step_l, 4.0f * step_r,
+			4.0f * step_l, 4.0f * step_r, 4.0f * step_l, 4.0f * step_r);
+		__m256 gain_hi = _mm256_add_ps(gain_lo, step4);
+		__m256 step8 = _mm256_add_ps(step4, step4);
+		for (; i + 8 <= count; i += 8) {
+			__m256 s = _mm256_loadu_ps(src + i);
+			//duplicate each mono sample into both channels (unpack works within 128-bit halves, so the halves get swapped back into order):
+			__m256 s_a = _mm256_unpacklo_ps(s, s); //(s0, s0, s1, s1, s4, s4, s5, s5)
+			__m256 s_b = _mm256_unpackhi_ps(s, s); //(s2, s2, s3, s3, s6, s6, s7, s7)
+			__m256 s_lo = _mm256_permute2f128_ps(s_a, s_b, 0x20);
+			__m256 s_hi = _mm256_permute2f128_ps(s_a, s_b, 0x31);
+			_mm256_storeu_ps(out + 2 * i, _mm256_add_ps(_mm256_loadu_ps(out + 2 * i), _mm256_mul_ps(s_lo, gain_lo)));
+			_mm256_storeu_ps(out + 2 * i + 8, _mm256_add_ps(_mm256_loadu_ps(out + 2 * i + 8), _mm256_mul_ps(s_hi, gain_hi)));
+			gain_lo = _mm256_add_ps(gain_lo, step8);
+			gain_hi = _mm256_add_ps(gain_hi, step8);
+		}
+		//(clear the upper halves of the ymm registers before running non-AVX code, or every SSE instruction after this pays
+		// for the transition -- the compiler doesn't always do this itself when it can see the callee, as it can here)
+		_mm256_zeroupper();
+		//leftovers:
+		mix_span_scalar(src + i, count - i, out + 2 * i, gain_l + float(i) * step_l, gain_r + float(i) * step_r, step_l, step_r);
+	}
+}
+
+//does this CPU (and OS) support AVX?
+bool cpu_has_avx() {
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 1);
+	bool avx = (info[2] & (1 << 28)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0; //(and the OS saves the ymm registers -- checked below)
+	return avx && osxsave && (_xgetbv(0) & 0x6) == 0x6;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx");
+#endif
+}
+
+MixSpanFn const mix_span_sse2 = sse2_kernel;
+MixSpanFn const mix_span_avx = avx_kernel;
+
+MixSpanFn const mix_span = (cpu_has_avx() ? avx_kernel : sse2_kernel);
+char const *const mix_span_name = (cpu_has_avx() ? "avx" : "sse2");
+#else
+bool cpu_has_avx() {
+	return false;
+}
+
+MixSpanFn const mix_span_sse2 = nullptr;
+MixSpanFn const mix_span_avx = nullptr;
+
+MixSpanFn const mix_span = mix_span_scalar;
+char const *const mix_span_name = "scalar";
+#endif
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+//Mixing kernel used by Sound's audio callback:
+// add 'count' mono samples from 'src' into interleaved stereo 'out' (LRLR...),
+// scaled by left/right gains that start at 'gain_l'/'gain_r' and change by 'step_l'/'step_r' each sample.
+using MixSpanFn = void (*)(float const *src, uint32_t count, float *out, float gain_l, float gain_r, float step_l, float step_r);
+
+//the fastest version this CPU can run (picked once, at startup):
+extern MixSpanFn const mix_span;
+extern char const *const mix_span_name; //"avx", "sse2", or "scalar"
+
+//the individual versions (for comparing them; mix_span_sse2/mix_span_avx are nullptr on builds that don't have them,
+// and mix_span_avx must only be called if cpu_has_avx()):
+void mix_span_scalar(float const *src, uint32_t count, float *out, float gain_l, float gain_r, float step_l, float step_r);
+extern MixSpanFn const mix_span_sse2;
+extern MixSpanFn const mix_span_avx;
+bool cpu_has_avx();
@@ -3,7 +3,10 @@
 #include <iostream>
 #include <vector>
 #include <stdexcept>
+#include <string>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 
 //helper function that reads an array of structures preceded by a simple header:
 //Expected format:
@@ -41,6 +44,61 @@ void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *
 }
 
 
+//Chunks can also be read in place from memory (e.g. from a MappedFile), without copying:
+// (read_chunk_view advances 'from' past the chunk and returns its bytes)
+struct ChunkBytes {
+	char const *begin = nullptr;
+	char const *end = nullptr;
+	size_t size() const { return size_t(end - begin); }
+	bool empty() const { return begin == end; }
+};
+
+//n.b. chunk data has no particular alignment, so read elements out of a view with memcpy (or just hand the bytes to OpenGL):
+inline ChunkBytes read_chunk_view(ChunkBytes *from_, std::string const &magic, size_t element_size) {
+	assert(from_);
+	auto &from = *from_;
+
+	struct ChunkHeader {
+		char magic[4] = {'\0', '\0', '\0', '\0'};
+		uint32_t size = 0;
+	};
+	static_assert(sizeof(ChunkHeader) == 8, "header is packed");
+
+	ChunkHeader header;
+	if (from.size() < sizeof(header)) {
+		throw std::runtime_error("Failed to read chunk header");
+	}
+	std::memcpy(&header, from.begin, sizeof(header));
+	if (std::string(header.magic,4) != magic) {
+		throw std::runtime_error("Unexpected magic number in chunk");
+	}
+
+	if (header.size % element_size != 0) {
+		throw std::runtime_error("Size of chunk not divisible by element size");
+	}
+	if (from.size() - sizeof(header) < header.size) {
+		throw std::runtime_error("Failed to read chunk data.");
+	}
+
+	ChunkBytes chunk;
+	chunk.begin = from.begin + sizeof(header);
+	chunk.end = chunk.begin + header.size;
+	from.begin = chunk.end;
+	return chunk;
+}
+
+//same as the std::istream version, reading from memory:
+template< typename T >
+void read_chunk(ChunkBytes *from, std::string const &magic, std::vector< T > *to_) {
+	assert(to_);
+	auto &to = *to_;
+
+	ChunkBytes chunk = read_chunk_view(from, magic, sizeof(T));
+	to.resize(chunk.size() / sizeof(T));
+	if (!chunk.empty()) std::memcpy(reinterpret_cast< char * >(to.data()), chunk.begin, chunk.size());
+}
+
+
 //helper function to write a chunk of data in the same format as read_chunk:
 template< typename T >
 void write_chunk(std::string const &magic, std::vector< T > const &from, std::ostream *to_) {
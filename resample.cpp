@@ -0,0 +1,169 @@
+#include "resample.hpp"
+#include "mix_span.hpp" //(for cpu_has_avx)
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+//x86 builds get SSE2 and AVX dot products (picked between at runtime, like mix_span's kernels):
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RESAMPLE_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define RESAMPLE_TARGET_AVX //(MSVC allows AVX intrinsics anywhere)
+#else
+#define RESAMPLE_TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+//The resampler treats output sample n as lying at input position n * M / L (L and M are the rates with common factors removed).
+//Each output sample is a weighted sum of the input samples around that position, with weights from a
+// Kaiser-windowed sinc filter. There are only L distinct fractional positions ('phases'), so each phase's
+// weights are computed once up front.
+
+namespace {
+	//filter half-width, in input samples (when not downsampling):
+	constexpr uint32_t const HALF_TAPS = 16;
+	//phases are limited to this many (for strange rate pairs, positions are rounded to the nearest phase):
+	constexpr uint32_t const MAX_PHASES = 4096;
+	//Kaiser window shape parameter (~90dB of stopband attenuation):
+	constexpr double const KAISER_BETA = 9.0;
+
+	constexpr double const Pi = 3.14159265358979323846;
+
+	//zeroth-order modified Bessel function of the first kind (for the Kaiser window):
+	double bessel_i0(double x) {
+		double sum = 1.0;
+		double term = 1.0;
+		for (uint32_t k = 1; k < 50; ++k) {
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+			if (term < sum * 1e-12) break;
+		}
+		return sum;
+	}
+
+	//helpers: dot product of 'count' floats:
+	using DotFn = float (*)(float const *a, float const *b, uint32_t count);
+
+#if defined(RESAMPLE_X86)
+	float dot_sse2(float const *a, float const *b, uint32_t count) {
+		uint32_t i = 0;
+		__m128 acc0 = _mm_setzero_ps();
+		__m128 acc1 = _mm_setzero_ps();
+		for (; i + 8 <= count; i += 8) {
+			acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+			acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+		}
+		float lanes[4];
+		_mm_storeu_ps(lanes, _mm_add_ps(acc0, acc1));
+		float total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+		for (; i < count; ++i) {
+			total += a[i] * b[i];
+		}
+		return total;
+	}
+
+	//only called if cpu_has_avx():
+	RESAMPLE_TARGET_AVX float dot_avx(float const *a, float const *b, uint32_t count) {
+		uint32_t i = 0;
+		__m256 acc0 = _mm256_setzero_ps();
+		__m256 acc1 = _mm256_setzero_ps();
+		for (; i + 16 <= count; i += 16) {
+			acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+			acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+		}
+		acc0 = _mm256_add_ps(acc0, acc1);
+		__m128 acc4 = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+		_mm256_zeroupper(); //(avoid the AVX -> SSE transition penalty in the caller)
+		float lanes[4];
+		_mm_storeu_ps(lanes, acc4);
+		float total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+		for (; i < count; ++i) {
+			total += a[i] * b[i];
+		}
+		return total;
+	}
+
+	DotFn pick_dot() {
+		return (cpu_has_avx() ? dot_avx : dot_sse2);
+	}
+#else
+	float dot_scalar(float const *a, float const *b, uint32_t count) {
+		float total = 0.0f;
+		for (uint32_t i = 0; i < count; ++i) {
+			total += a[i] * b[i];
+		}
+		return total;
+	}
+
+	DotFn pick_dot() {
+		return dot_scalar;
+	}
+#endif
+}
+
+void resample(std::vector< float > const &in, uint32_t from_rate, uint32_t to_rate, std::vector< float > *out_) {
+	assert(out_);
+	auto &out = *out_;
+	if (from_rate == 0 || to_rate == 0) {
+		throw std::runtime_error("Can't resample from " + std::to_string(from_rate) + " Hz to " + std::to_string(to_rate) + " Hz.");
+	}
+	if (from_rate == to_rate) {
+		out = in;
+		return;
+	}
+
+	uint64_t g = std::gcd(from_rate, to_rate);
+	uint64_t L = to_rate / g; //output step, in input samples, is M / L
+	uint64_t M = from_rate / g;
+
+	//when downsampling, the filter cuts off at the (lower) output Nyquist frequency, so it needs to be wider:
+	double cutoff = std::min(1.0, double(to_rate) / double(from_rate));
+	uint32_t half = uint32_t(std::ceil(HALF_TAPS / cutoff));
+	uint32_t taps = 2 * half;
+
+	//filter weights for each phase -- phase p is for output positions that are p/phases past an input sample:
+	uint32_t phases = uint32_t(std::min< uint64_t >(L, MAX_PHASES));
+	std::vector< float > weights(size_t(phases) * taps);
+	for (uint32_t p = 0; p < phases; ++p) {
+		double offset = double(p) / double(phases);
+		float *w = weights.data() + size_t(p) * taps;
+		double sum = 0.0;
+		for (uint32_t t = 0; t < taps; ++t) {
+			//distance from the output position to input sample (position - half + 1 + t):
+			double x = offset + double(half) - 1.0 - double(t);
+			double sinc = (x == 0.0 ? 1.0 : std::sin(Pi * cutoff * x) / (Pi * cutoff * x));
+			double r = x / double(half);
+			double window = (std::abs(r) >= 1.0 ? 0.0 : bessel_i0(KAISER_BETA * std::sqrt(1.0 - r * r)) / bessel_i0(KAISER_BETA));
+			w[t] = float(sinc * window);
+			sum += w[t];
+		}
+		//normalize so a constant signal stays constant:
+		for (uint32_t t = 0; t < taps; ++t) {
+			w[t] = float(w[t] / sum);
+		}
+	}
+
+	//the filter reads up to 'half' samples past either end (one more at the end, if the last position rounds up to the next input sample), so pad with silence:
+	std::vector< float > padded(in.size() + 2 * size_t(half) + 1, 0.0f);
+	std::copy(in.begin(), in.end(), padded.begin() + half);
+
+	DotFn const dot = pick_dot();
+	out.resize(size_t((uint64_t(in.size()) * L + M - 1) / M));
+	for (size_t n = 0; n < out.size(); ++n) {
+		uint64_t at = uint64_t(n) * M;
+		uint64_t whole = at / L;
+		//nearest phase (which may be the next input sample's phase 0):
+		uint64_t phase = ((at % L) * phases + L / 2) / L;
+		if (phase == phases) {
+			phase = 0;
+			whole += 1;
+		}
+		//first input sample used is whole - half + 1, which is index whole + 1 in 'padded':
+		out[n] = dot(padded.data() + whole + 1, weights.data() + size_t(phase) * taps, taps);
+	}
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+//Convert mono audio from 'from_rate' to 'to_rate' samples per second (e.g., 44100 -> 48000):
+// uses a polyphase windowed-sinc filter (so is meant for load time, not for every mix)
+void resample(std::vector< float > const &in, uint32_t from_rate, uint32_t to_rate, std::vector< float > *out);
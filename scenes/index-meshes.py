@@ -0,0 +1,234 @@
+#!/usr/bin/env python
+
+#Converts a '.pnct' mesh file (a triangle soup of full-float vertices) into an indexed '.pnci' file:
+# - vertices are quantized (see below) and then de-duplicated within each mesh
+# - triangles are reordered for the post-transform vertex cache (Tom Forsyth's "Linear-Speed Vertex Cache Optimisation")
+# - vertices are reordered by first use, so vertex fetches walk forward through the buffer
+#
+#Note: plain python3 script (no blender needed), run as:
+#python3 index-meshes.py <infile.pnct> <outfile.pnci>
+#
+#.pnci layout (loaded by MeshBuffer, see Mesh.cpp):
+# 'pnq0' chunk: 24-byte vertices:
+#    Position: 3x float32
+#    Normal: snorm 10:10:10 packed into a uint32 (as GL_INT_2_10_10_10_REV; w bits are zero)
+#    Color: 4x uint8
+#    TexCoord: 2x float16
+# 'ix16' or 'ix32' chunk: uint16 (if there are at most 65536 vertices) or uint32 indices
+# 'str0' chunk: mesh names
+# 'idx1' chunk: per-mesh entries of uint32 name_begin, name_end, index_begin, index_end, vertex_begin, vertex_end
+
+import sys,struct
+
+if len(sys.argv) != 3:
+	print("\n\nUsage:\npython3 index-meshes.py <infile.pnct> <outfile.pnci>\nConverts a pnct mesh blob to an indexed, quantized pnci mesh blob.\n")
+	exit(1)
+
+infile = sys.argv[1]
+outfile = sys.argv[2]
+
+assert infile.endswith(".pnct")
+assert outfile.endswith(".pnci")
+
+#--- read the input ---
+
+def read_chunks(path):
+	chunks = []
+	with open(path, 'rb') as f:
+		blob = f.read()
+	at = 0
+	while at < len(blob):
+		assert at + 8 <= len(blob), "truncated chunk header"
+		magic, size = struct.unpack_from('4sI', blob, at)
+		at += 8
+		assert at + size <= len(blob), "truncated chunk"
+		chunks.append((magic, blob[at:at+size]))
+		at += size
+	return chunks
+
+chunks = read_chunks(infile)
+assert [c[0] for c in chunks] == [b'pnct', b'str0', b'idx0'], "expecting pnct, str0, idx0 chunks"
+data = chunks[0][1]
+strings = chunks[1][1]
+index = chunks[2][1]
+
+PNCT = struct.Struct('3f3f4B2f')
+assert PNCT.size == 36
+assert len(data) % PNCT.size == 0
+assert len(index) % 16 == 0
+
+#--- quantization ---
+
+def pack_snorm10(x):
+	x = max(-1.0, min(1.0, x))
+	return int(round(x * 511.0)) & 0x3ff
+
+def quantize(vertex):
+	px, py, pz, nx, ny, nz, r, g, b, a, u, v = vertex
+	normal = pack_snorm10(nx) | (pack_snorm10(ny) << 10) | (pack_snorm10(nz) << 20)
+	return struct.pack('3fI4B2e', px, py, pz, normal, r, g, b, a, u, v)
+
+assert len(quantize((0.0,)*6 + (0,)*4 + (0.0,)*2)) == 24
+
+#--- vertex cache optimization ---
+
+#vertex scoring constants from Forsyth's article:
+CACHE_SIZE = 32
+CACHE_DECAY_POWER = 1.5
+LAST_TRI_SCORE = 0.75
+VALENCE_BOOST_SCALE = 2.0
+VALENCE_BOOST_POWER = 0.5
+
+def optimize_triangles(indices, vertex_count):
+	tri_count = len(indices) // 3
+
+	#triangles using each vertex:
+	vertex_tris = [[] for _ in range(vertex_count)]
+	for t in range(tri_count):
+		for v in indices[3*t:3*t+3]:
+			vertex_tris[v].append(t)
+
+	cache_position = [-1] * vertex_count
+
+	def vertex_score(v):
+		remaining = len(vertex_tris[v])
+		if remaining == 0: return -1.0
+		score = 0.0
+		p = cache_position[v]
+		if p >= 0:
+			if p < 3:
+				score = LAST_TRI_SCORE #(vertices of the triangle just added)
+			else:
+				score = (1.0 - (p - 3) / (CACHE_SIZE - 3)) ** CACHE_DECAY_POWER
+		score += VALENCE_BOOST_SCALE * remaining ** -VALENCE_BOOST_POWER
+		return score
+
+	v_score = [vertex_score(v) for v in range(vertex_count)]
+	def triangle_score(t):
+		return sum(v_score[v] for v in indices[3*t:3*t+3])
+	t_score = [triangle_score(t) for t in range(tri_count)]
+	added = [False] * tri_count
+
+	cache = []
+	out = []
+	best = max(range(tri_count), key=lambda t: t_score[t]) if tri_count > 0 else -1
+	while len(out) < len(indices):
+		if best < 0:
+			#nothing in the cache touches a remaining triangle, so start over from the best remaining one:
+			best = max((t for t in range(tri_count) if not added[t]), key=lambda t: t_score[t])
+
+		tri = indices[3*best:3*best+3]
+		added[best] = True
+		out.extend(tri)
+		for v in tri:
+			vertex_tris[v].remove(best)
+
+		#move the triangle's vertices to the front of the (LRU) cache:
+		tri_vertices = list(dict.fromkeys(tri))
+		new_cache = tri_vertices + [v for v in cache if v not in tri_vertices]
+		evicted = new_cache[CACHE_SIZE:]
+		cache = new_cache[:CACHE_SIZE]
+		for v in evicted:
+			cache_position[v] = -1
+		for i, v in enumerate(cache):
+			cache_position[v] = i
+
+		#rescore, and pick the best triangle touching the cache:
+		for v in cache + evicted:
+			v_score[v] = vertex_score(v)
+		for v in evicted:
+			for t in vertex_tris[v]:
+				t_score[t] = triangle_score(t)
+		best = -1
+		best_score = -1.0
+		for v in cache:
+			for t in vertex_tris[v]:
+				t_score[t] = triangle_score(t)
+				if t_score[t] > best_score:
+					best = t
+					best_score = t_score[t]
+
+	return out
+
+#average post-transform cache misses per triangle (for a FIFO cache, as most hardware has):
+def acmr(indices, fifo_size=16):
+	if len(indices) == 0: return 0.0
+	fifo = []
+	misses = 0
+	for v in indices:
+		if v not in fifo:
+			misses += 1
+			fifo.append(v)
+			if len(fifo) > fifo_size: fifo.pop(0)
+	return misses / (len(indices) // 3)
+
+#--- convert each mesh ---
+
+vertices = [] #quantized vertex bytes
+indices = []
+out_index = b''
+indexed_misses = 0.0
+
+for entry in range(len(index) // 16):
+	name_begin, name_end, vertex_begin, vertex_end = struct.unpack_from('4I', index, 16 * entry)
+	assert vertex_begin <= vertex_end and vertex_end * PNCT.size <= len(data)
+	assert (vertex_end - vertex_begin) % 3 == 0, "expecting triangles"
+
+	#de-duplicate (after quantization, so vertices that only differed by rounding merge too):
+	local_vertices = []
+	local_lookup = dict()
+	local_indices = []
+	for i in range(vertex_begin, vertex_end):
+		q = quantize(PNCT.unpack_from(data, i * PNCT.size))
+		if q not in local_lookup:
+			local_lookup[q] = len(local_vertices)
+			local_vertices.append(q)
+		local_indices.append(local_lookup[q])
+
+	local_indices = optimize_triangles(local_indices, len(local_vertices))
+	indexed_misses += acmr(local_indices) * (len(local_indices) // 3)
+
+	#renumber vertices in order of first use:
+	remap = dict()
+	for v in local_indices:
+		if v not in remap:
+			remap[v] = len(remap)
+	first = len(vertices)
+	ordered = [None] * len(remap)
+	for old, new in remap.items():
+		ordered[new] = local_vertices[old]
+	vertices.extend(ordered)
+
+	index_begin = len(indices)
+	indices.extend(first + remap[v] for v in local_indices)
+	index_end = len(indices)
+
+	out_index += struct.pack('6I', name_begin, name_end, index_begin, index_end, first, len(vertices))
+
+#--- write the output ---
+
+wide = len(vertices) > 65536
+vertex_data = b''.join(vertices)
+index_data = struct.pack(('I' if wide else 'H') * len(indices), *indices)
+
+blob = open(outfile, 'wb')
+blob.write(struct.pack('4s',b'pnq0'))
+blob.write(struct.pack('I', len(vertex_data)))
+blob.write(vertex_data)
+blob.write(struct.pack('4s',b'ix32' if wide else b'ix16'))
+blob.write(struct.pack('I', len(index_data)))
+blob.write(index_data)
+blob.write(struct.pack('4s',b'str0'))
+blob.write(struct.pack('I', len(strings)))
+blob.write(strings)
+blob.write(struct.pack('4s',b'idx1'))
+blob.write(struct.pack('I', len(out_index)))
+blob.write(out_index)
+wrote = blob.tell()
+blob.close()
+
+triangles = len(indices) // 3
+print("Wrote " + str(wrote) + " bytes to '" + outfile + "' (from " + str(len(data) + len(strings) + len(index) + 3*8) + " bytes of '" + infile + "').")
+print("  " + str(len(data) // PNCT.size) + " vertices -> " + str(len(vertices)) + " unique vertices + " + str(len(indices)) + " indices.")
+if triangles > 0:
+	print("  vertex shader runs per triangle: " + "3.0 (unindexed) -> " + ("%.2f" % (indexed_misses / triangles)) + " (16-entry FIFO cache).")
@@ -1,5 +1,6 @@
 //@ChatGPT used
 #include "Connection.hpp"
+#include "ShardedServer.hpp"
 #include "hex_dump.hpp"
 #include "Game.hpp"
 
@@ -8,24 +9,13 @@
 #include <iostream>
 #include <cassert>
 #include <unordered_map>
+#include <algorithm>
+#include <cstdlib>
 
 #ifdef _WIN32
 extern "C" { uint32_t GetACP(); }
 #endif
 
-// tiny helper: try to parse our C2S_Action frame from recv_buffer
-static bool try_recv_action(Connection* c, uint8_t& out_mask) {
-	auto& buf = c->recv_buffer;
-	if (buf.size() < 4) return false;
-	if (buf[0] != uint8_t(Message::C2S_Action)) return false;
-	uint32_t size = (uint32_t(buf[3]) << 16) | (uint32_t(buf[2]) << 8) | uint32_t(buf[1]);
-	if (size != 1) throw std::runtime_error("C2S_Action with unexpected size");
-	if (buf.size() < 4 + size) return false; // wait for full payload
-	out_mask = buf[4];
-	buf.erase(buf.begin(), buf.begin() + 5);
-	return true;
-}
-
 int main(int argc, char **argv) {
 #ifdef _WIN32
 	{ //when compiled on windows, check that code page is forced to utf-8 (makes file loading/saving work right):
@@ -39,12 +29,17 @@ int main(int argc, char **argv) {
 	try {
 #endif
 
-	if (argc != 2) {
-		std::cerr << "Usage:\n\t./server <port>" << std::endl;
+	if (argc != 2 && argc != 3) {
+		std::cerr << "Usage:\n\t./server <port> [io-threads]" << std::endl;
 		return 1;
 	}
 
-	Server server(argv[1]);
+	//sockets are serviced by I/O threads; the simulation below only sees complete frames:
+	uint32_t io_threads = 1;
+	if (argc == 3) {
+		io_threads = uint32_t(std::max(1, std::atoi(argv[2])));
+	}
+	ShardedServer server(argv[1], io_threads);
 
 	std::unordered_map< Connection *, Player * > connection_to_player;
 	Game game;
@@ -89,39 +84,39 @@ int main(int argc, char **argv) {
 					Player &player = *f->second;
 
 					try {
-						bool progressed;
-						do {
-							progressed = false;
-
-							// existing controls:
-							if (player.controls.recv_controls_message(c)) {
-								progressed = true;
-								// debug print for controls (only when there was a 'downs'):
-								if (player.controls.left.downs || player.controls.right.downs ||
-									player.controls.up.downs || player.controls.down.downs ||
-									player.controls.jump.downs) {
-									std::cout << "[Controls] player=" << player.name
-										<< " L:" << int(player.controls.left.downs)
-										<< " R:" << int(player.controls.right.downs)
-										<< " U:" << int(player.controls.up.downs)
-										<< " D:" << int(player.controls.down.downs)
-										<< " JUMP:" << int(player.controls.jump.downs)
-										<< std::endl;
-								}
-							}
-
-							// new action frame:
-							uint8_t mask = 0;
-							while (try_recv_action(c, mask)) {
-								progressed = true;
-								player.pending_action |= mask; // let Game::update consume/clear it
-								std::cout << "[Action] player=" << player.name
-									<< " attack=" << ((mask & 0x1) ? 1 : 0)
-									<< " defend=" << ((mask & 0x2) ? 1 : 0)
-									<< " parry="  << ((mask & 0x4) ? 1 : 0)
+						// controls + actions (one C2S_Input frame per client send interval):
+						uint8_t mask = 0;
+						while (player.controls.recv_controls_message(c, &mask, &player.input_tick)) {
+							// debug print for controls (only when there was a 'downs'):
+							if (player.controls.left.downs || player.controls.right.downs ||
+								player.controls.up.downs || player.controls.down.downs ||
+								player.controls.jump.downs) {
+								std::cout << "[Controls] player=" << player.name
+									<< " tick=" << player.input_tick
+									<< " L:" << int(player.controls.left.downs)
+									<< " R:" << int(player.controls.right.downs)
+									<< " U:" << int(player.controls.up.downs)
+									<< " D:" << int(player.controls.down.downs)
+									<< " JUMP:" << int(player.controls.jump.downs)
 									<< std::endl;
 							}
-						} while (progressed);
+						}
+						if (mask) {
+							player.pending_action |= mask; // let Game::update consume/clear it
+							std::cout << "[Action] player=" << player.name
+								<< " attack=" << ((mask & 0x1) ? 1 : 0)
+								<< " defend=" << ((mask & 0x2) ? 1 : 0)
+								<< " parry="  << ((mask & 0x4) ? 1 : 0)
+								<< std::endl;
+						}
+
+						// anything left at the front must be an incomplete frame of a known type:
+						uint8_t type = 0;
+						uint32_t size = 0;
+						if (peek_frame(c->recv_buffer.data(), c->recv_buffer.size(), &type, &size)
+						 && type != uint8_t(Message::C2S_Input)) {
+							throw std::runtime_error("Unknown message type " + std::to_string(int(type)));
+						}
 					} catch (std::exception const &e) {
 						std::cout << "Disconnecting client:" << e.what() << std::endl;
 						c->close();
@@ -136,6 +131,25 @@ int main(int argc, char **argv) {
 		for (auto &[c, player] : connection_to_player) {
 			game.send_state_message(c, player);
 		}
+
+		{ //every few seconds, report on send queues if any connection has been falling behind:
+			static auto next_report = std::chrono::steady_clock::now();
+			static Server::Stats reported;
+			auto now = std::chrono::steady_clock::now();
+			if (now >= next_report) {
+				next_report = now + std::chrono::seconds(5);
+				Server::Stats const &stats = server.stats;
+				if (stats.dropped_frames != reported.dropped_frames || stats.limit_disconnects != reported.limit_disconnects) {
+					std::cout << "[Send queues] queued=" << stats.queued_bytes
+						<< " peak=" << stats.peak_queued_bytes
+						<< " dropped=" << (stats.dropped_frames - reported.dropped_frames) << " frames/"
+						<< (stats.dropped_bytes - reported.dropped_bytes) << " bytes"
+						<< " limit_disconnects=" << (stats.limit_disconnects - reported.limit_disconnects)
+						<< std::endl;
+				}
+				reported = stats;
+			}
+		}
 	}
 
 	return 0;
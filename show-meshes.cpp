@@ -100,7 +100,7 @@ int main(int argc, char **argv) {
 		usage = true;
 	}
 	if (usage) {
-		std::cerr << "Usage:\n\t" << argv[0] << " [path/to/meshes.pnct]" << std::endl;
+		std::cerr << "Usage:\n\t" << argv[0] << " [path/to/meshes.pnct|.pnci]" << std::endl;
 		return 1;
 	}
 
@@ -123,6 +123,10 @@ int main(int argc, char **argv) {
 				drawable.pipeline.type = mesh.type;
 				drawable.pipeline.start = mesh.start;
 				drawable.pipeline.count = mesh.count;
+				drawable.pipeline.index_type = mesh.index_type;
+
+				drawable.bounds_min = mesh.min;
+				drawable.bounds_max = mesh.max;
 
 			});
 		} catch (std::exception &e) {
@@ -135,14 +139,14 @@ int main(int argc, char **argv) {
 		usage = true;
 	}
 	if (usage) {
-		std::cerr << "Usage:\n\t" << argv[0] << " <path/to/scene.scene> [path/to/meshes.pnct]" << std::endl;
+		std::cerr << "Usage:\n\t" << argv[0] << " <path/to/scene.scene> [path/to/meshes.pnct|.pnci]" << std::endl;
 		return 1;
 	}
 	std::cout << "Showing scene from '" << scene_file << "' with";
 	if (meshes_file != "") {
 		std::cout << " meshes from '" << meshes_file << "'" << std::endl;
 	} else {
-		std::cout << " no meshes -- consider passing a '.pnct' file as the second argument." << std::endl;
+		std::cout << " no meshes -- consider passing a '.pnct' or '.pnci' file as the second argument." << std::endl;
 	}
 	Mode::set_current(std::make_shared< ShowSceneMode >(*scene));
 